@@ -292,6 +292,7 @@ export class ClipboardWatcher {
             strip_box_chars: this.settings.get_boolean('strip-box-chars'),
             trim_prompts: this.settings.get_boolean('trim-prompts'),
             max_lines: this.settings.get_int('max-lines'),
+            large_snippets: this.settings.get_boolean('large-snippets'),
         };
     }
 
@@ -35,6 +35,7 @@ export default class TrimmehPreferences extends ExtensionPreferences {
         maxLinesRow.add_suffix(spin);
         maxLinesRow.set_activatable_widget(spin);
         toggles.add(maxLinesRow);
+        toggles.add(this.switchRow('Flatten long continuation chains', settings, 'large-snippets'));
 
         const hotkeys = new Adw.PreferencesGroup({title: 'Hotkeys'});
         hotkeys.add(this.keybindingRow(
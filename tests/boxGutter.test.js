@@ -0,0 +1,62 @@
+import Gio from 'gi://Gio';
+
+import {stripBoxDrawingCharacters, stripBoxRegex} from './dist/gutter.js';
+
+function readTextFile(path) {
+    const file = Gio.File.new_for_path(path);
+    const [, contents] = file.load_contents(null);
+    const bytes = contents instanceof Uint8Array ? contents : Uint8Array.from(contents);
+    return new TextDecoder('utf-8').decode(bytes);
+}
+
+function assertSameStrip(text) {
+    const actual = JSON.stringify(stripBoxDrawingCharacters(text));
+    const expected = JSON.stringify(stripBoxRegex(text));
+    if (actual !== expected) {
+        throw new Error(`box strip differs for ${JSON.stringify(text)}: expected ${expected}, got ${actual}`);
+    }
+}
+
+// Box characters next to pipes, paths, tokens, line ends, other box
+// characters and whitespace that \s treats differently from ASCII.
+const PIECES = [
+    '│', '┃', '╎', '╿', '｜', '￨', '│ │', '|', ':', '/', '~', 'a', 'Z',
+    '0', '-', '\u00e9', '$', ' ', '  ', '\t', '\n', '\n\n', '\u00a0', '\u0085', '\u2028', '\u3000', '\ufeff',
+    '│ ', ' │', '│\n', '\n│', 'ls', 'git status', 'https://x', '\ud835\udd18',
+];
+
+function run() {
+    const vectors = JSON.parse(readTextFile('tests/trim-vectors.json'));
+    for (const v of vectors) {
+        assertSameStrip(v.input);
+    }
+    print(`ok - ${vectors.length} vectors`);
+
+    // Deterministic xorshift32 so failures reproduce.
+    let state = 0x9e3779b9;
+    const next = () => {
+        state ^= state << 13;
+        state ^= state >>> 17;
+        state ^= state << 5;
+        return state >>> 0;
+    };
+    const cases = 50000;
+    for (let n = 0; n < cases; n += 1) {
+        const len = next() % 16;
+        let text = '';
+        for (let i = 0; i < len; i += 1) {
+            text += PIECES[next() % PIECES.length];
+        }
+        assertSameStrip(text);
+    }
+    print(`ok - ${cases} generated inputs`);
+
+    print('all box gutter tests passed');
+}
+
+try {
+    run();
+} catch (e) {
+    logError(e);
+    imports.system.exit(1);
+}
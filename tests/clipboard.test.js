@@ -13,6 +13,7 @@ class FakeSettings {
             ['strip-box-chars', true],
             ['trim-prompts', true],
             ['max-lines', 10],
+            ['large-snippets', false],
         ]);
     }
     get_boolean(key) { return Boolean(this.values.get(key)); }
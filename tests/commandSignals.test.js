@@ -0,0 +1,70 @@
+import Gio from 'gi://Gio';
+
+import {commandSignals, commandSignalsRegex, extraPrefixTrie} from './dist/signals.js';
+
+function readTextFile(path) {
+    const file = Gio.File.new_for_path(path);
+    const [, contents] = file.load_contents(null);
+    const bytes = contents instanceof Uint8Array ? contents : Uint8Array.from(contents);
+    return new TextDecoder('utf-8').decode(bytes);
+}
+
+// Padded and mixed case to exercise normalisation; 'é' needs the non-ASCII path.
+const EXTRA_PREFIXES = [' Helmfile ', 'kub', '\u00e9', ''];
+
+function assertSameSignals(text, extraPrefixes = []) {
+    const actual = JSON.stringify(commandSignals(text, extraPrefixTrie(extraPrefixes)));
+    const expected = JSON.stringify(commandSignalsRegex(text, extraPrefixes));
+    if (actual !== expected) {
+        throw new Error(`signals differ for ${JSON.stringify(text)}: expected ${expected}, got ${actual}`);
+    }
+}
+
+// Pieces that hit every signal plus the places where the scanner could drift
+// from RegExp semantics: extra multiline terminators (\r, U+2028, U+2029),
+// Unicode whitespace, U+0085 (not \s in JS), and case folding (Kelvin sign,
+// dotted capital I).
+const PIECES = [
+    'a', 'Z', '0', '_', '.', '/', '~', '-', '=', ':', '$', '#', '|', '&', '||', '&&', '|||', ';',
+    '\\', '{', '}', '[[', '(', ')', '*', '•', '1.', '2)', ' ', '  ', '\t', '\n', '\n\n', '\r',
+    '\u2028', '\u2029', '\u0085', '\u00a0', '\u3000', '\ufeff', '\u00e9', '\u0301', '\u212a', '\u0130',
+    'sudo ', 'ls ', 'git ', 'Kubectl', 'import ', 'fn', 'let', 'letter', 'if(', 'BEGIN', 'begbegin',
+    'path/to', 'word.', 'item', 'abcd', 'echo hi', 'x\\\n', 'helmfile ', 'HELM', '\u00c9cho',
+];
+
+function run() {
+    const vectors = JSON.parse(readTextFile('tests/trim-vectors.json'));
+    for (const v of vectors) {
+        assertSameSignals(v.input.replace(/\r\n/g, '\n').replace(/\r/g, '\n'));
+    }
+    print(`ok - ${vectors.length} vectors`);
+
+    // Deterministic xorshift32 so failures reproduce.
+    let state = 0x9e3779b9;
+    const next = () => {
+        state ^= state << 13;
+        state ^= state >>> 17;
+        state ^= state << 5;
+        return state >>> 0;
+    };
+    const cases = 50000;
+    for (let n = 0; n < cases; n += 1) {
+        const len = next() % 24;
+        let text = '';
+        for (let i = 0; i < len; i += 1) {
+            text += PIECES[next() % PIECES.length];
+        }
+        assertSameSignals(text);
+        assertSameSignals(text, EXTRA_PREFIXES);
+    }
+    print(`ok - ${cases} generated inputs`);
+
+    print('all command signal tests passed');
+}
+
+try {
+    run();
+} catch (e) {
+    logError(e);
+    imports.system.exit(1);
+}
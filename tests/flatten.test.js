@@ -0,0 +1,65 @@
+import Gio from 'gi://Gio';
+
+import {flatten, flattenRegex} from './dist/flatten.js';
+
+function readTextFile(path) {
+    const file = Gio.File.new_for_path(path);
+    const [, contents] = file.load_contents(null);
+    const bytes = contents instanceof Uint8Array ? contents : Uint8Array.from(contents);
+    return new TextDecoder('utf-8').decode(bytes);
+}
+
+function assertSameFlatten(text, keepBlankLines) {
+    const actual = JSON.stringify(flatten(text, keepBlankLines));
+    const expected = JSON.stringify(flattenRegex(text, keepBlankLines));
+    if (actual !== expected) {
+        throw new Error(`flatten differs for ${JSON.stringify(text)} (keep_blank_lines=${keepBlankLines}): ` +
+            `expected ${expected}, got ${actual}`);
+    }
+}
+
+// Every join character class, runs with one or several newlines, and
+// whitespace that \s treats differently from ASCII (U+0085 is not \s in JS).
+const PIECES = [
+    'a', 'z', 'A', 'Z', '0', '_', '.', '-', '--', '~', '/', ':', '\\', '|', '&', '$', '\u00e9',
+    ' ', '  ', '\t', '\n', '\n\n', ' \n ', '\n \n', '\u00a0', '\u0085', '\u2028', '\u3000', '\ufeff',
+    'x-', '-\n', '\\\n', '/\n', 'A\n', '__', 'git', 'echo', 'PLACE',
+];
+
+function run() {
+    const vectors = JSON.parse(readTextFile('tests/trim-vectors.json'));
+    for (const v of vectors) {
+        assertSameFlatten(v.input, false);
+        assertSameFlatten(v.input, true);
+    }
+    print(`ok - ${vectors.length} vectors`);
+
+    // Deterministic xorshift32 so failures reproduce.
+    let state = 0x2545f491;
+    const next = () => {
+        state ^= state << 13;
+        state ^= state >>> 17;
+        state ^= state << 5;
+        return state >>> 0;
+    };
+    const cases = 50000;
+    for (let n = 0; n < cases; n += 1) {
+        const len = next() % 20;
+        let text = '';
+        for (let i = 0; i < len; i += 1) {
+            text += PIECES[next() % PIECES.length];
+        }
+        assertSameFlatten(text, false);
+        assertSameFlatten(text, true);
+    }
+    print(`ok - ${cases} generated inputs`);
+
+    print('all flatten tests passed');
+}
+
+try {
+    run();
+} catch (e) {
+    logError(e);
+    imports.system.exit(1);
+}
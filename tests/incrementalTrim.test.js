@@ -0,0 +1,110 @@
+import Gio from 'gi://Gio';
+
+import {IncrementalTrimmer, trim} from './dist/trimCore.js';
+
+function readTextFile(path) {
+    const file = Gio.File.new_for_path(path);
+    const [, contents] = file.load_contents(null);
+    const bytes = contents instanceof Uint8Array ? contents : Uint8Array.from(contents);
+    return new TextDecoder('utf-8').decode(bytes);
+}
+
+function assertSameTrim(trimmer, text, aggressiveness, options) {
+    const actual = JSON.stringify(trimmer.trim(text, aggressiveness, options));
+    const expected = JSON.stringify(trim(text, aggressiveness, options));
+    if (actual !== expected) {
+        throw new Error(`incremental trim differs for ${JSON.stringify(text)} (${aggressiveness}, ` +
+            `${JSON.stringify(options)}): expected ${expected}, got ${actual}`);
+    }
+}
+
+// Command lines, joiners, wrapped words and paths, blank lines and prompt
+// marks, so growing selections cross every kind of line boundary.
+const PIECES = [
+    'kubectl get pods', ' -n kube-system', ' \\', ' |', ' &&', '\n', '\n', '\n\n', '\n  ', '  | grep Running',
+    'echo one', 'FOO_', 'BAR', 'some-', 'thing', '/usr/', 'local/bin', '$ ', '# ', '- item', 'begin',
+    'let x = 1;', '{', '}', ' ', '\t', '\u00a0', '\r', 'sudo ', 'helmfile apply', 'https://example.com/a',
+    '-', 'A', '_', '.', '/', '\\',
+];
+const EXTRA_PREFIXES = ['helmfile'];
+
+// Joins whose outcome depends on state carried over a line break: the
+// blank-line placeholder as a hyphen join's $1, and a word or hyphen join
+// whose $2 the next join may not reuse.
+const CARRIED = [
+    'echo a\n\n-\nb',
+    'echo A\nB\nC\nD',
+    'ls x-\ny-\nz',
+    'cat /usr/\nlocal/\nbin',
+    'git \\\n  log \\\n  -n 1',
+];
+
+function run() {
+    const vectors = JSON.parse(readTextFile('tests/trim-vectors.json'));
+    for (const v of vectors) {
+        const trimmer = new IncrementalTrimmer();
+        for (let end = 0; end <= v.input.length; end += 1) {
+            assertSameTrim(trimmer, v.input.slice(0, end), v.aggressiveness, v.options);
+        }
+    }
+    print(`ok - ${vectors.length} vectors, every prefix`);
+
+    for (const text of CARRIED) {
+        for (const keepBlankLines of [false, true]) {
+            const trimmer = new IncrementalTrimmer();
+            for (let end = 0; end <= text.length; end += 1) {
+                assertSameTrim(trimmer, text.slice(0, end), 'high', {keep_blank_lines: keepBlankLines});
+            }
+        }
+    }
+    print(`ok - ${CARRIED.length} carried joins, every prefix`);
+
+    // Deterministic xorshift32 so failures reproduce.
+    let state = 0x6b43a9b5;
+    const next = () => {
+        state ^= state << 13;
+        state ^= state >>> 17;
+        state ^= state << 5;
+        return state >>> 0;
+    };
+    const levels = ['low', 'normal', 'high'];
+    const selections = 3000;
+    let reusedLines = 0;
+    for (let n = 0; n < selections; n += 1) {
+        let full = '';
+        const pieces = 4 + next() % 24;
+        for (let i = 0; i < pieces; i += 1) {
+            full += PIECES[next() % PIECES.length];
+        }
+        const trimmer = new IncrementalTrimmer();
+        const aggressiveness = levels[next() % levels.length];
+        const options = {keep_blank_lines: next() % 2 === 0, extra_prefixes: EXTRA_PREFIXES};
+        // A selection grows by a few code units per step, and now and then
+        // shrinks back or changes under the cursor.
+        let end = 0;
+        let text = '';
+        while (end < full.length) {
+            end = Math.min(full.length, end + 1 + next() % 6);
+            text = full.slice(0, end);
+            if (next() % 8 === 0) {
+                const at = next() % text.length;
+                text = `${text.slice(0, at)}${PIECES[next() % PIECES.length]}${text.slice(at + 1)}`;
+            }
+            assertSameTrim(trimmer, text, aggressiveness, options);
+            reusedLines += trimmer.cache.reusedLines;
+        }
+    }
+    if (reusedLines === 0) {
+        throw new Error('growing selections never resumed from a checkpoint');
+    }
+    print(`ok - ${selections} growing selections (${reusedLines} lines reused)`);
+
+    print('all incremental trim tests passed');
+}
+
+try {
+    run();
+} catch (e) {
+    logError(e);
+    imports.system.exit(1);
+}
@@ -0,0 +1,67 @@
+import GLib from 'gi://GLib';
+
+import {DEFAULT_TRIM_OPTIONS, trim} from './dist/trimCore.js';
+
+// Mirrors trimmeh-core/benches/large_snippet.rs: a `docker run` chain of
+// about `size` bytes, each line wrapped in `left` and `right`.
+function chain(size, left, right) {
+    const lines = [`${left}docker run --rm \\${right}`];
+    let length = lines[0].length + 1;
+    for (let i = 0; length < size; i += 1) {
+        const line = `${left}  -e TRIMMEH_VAR_${i}=/srv/data/${i} \\${right}`;
+        lines.push(line);
+        length += line.length + 1;
+    }
+    lines.push(`${left}  registry.example.com/app:latest${right}`);
+    return lines.join('\n');
+}
+
+const OPTIONS = Object.assign({}, DEFAULT_TRIM_OPTIONS, {
+    max_lines: Number.MAX_SAFE_INTEGER,
+    large_snippets: true,
+});
+
+// Best of a few runs, in microseconds per KiB.
+function usPerKiB(text) {
+    let best = Infinity;
+    for (let run = 0; run < 3; run += 1) {
+        const start = GLib.get_monotonic_time();
+        const res = trim(text, 'normal', OPTIONS);
+        const elapsed = GLib.get_monotonic_time() - start;
+        if (!res.changed) {
+            throw new Error(`chain of ${text.length} chars was not flattened`);
+        }
+        best = Math.min(best, elapsed);
+    }
+    return best / (text.length / 1024);
+}
+
+// 16x the input must cost well under 16x per byte; a quadratic pass would
+// push the ratio to about 16.
+const SMALL = 64 << 10;
+const LARGE = 1 << 20;
+const MAX_RATIO = 4;
+
+function run() {
+    for (const [shape, left, right] of [['plain', '', ''], ['framed', '│ ', ' │']]) {
+        const small = chain(SMALL, left, right);
+        const large = chain(LARGE, left, right);
+        trim(small, 'normal', OPTIONS);
+        const smallCost = usPerKiB(small);
+        const largeCost = usPerKiB(large);
+        const ratio = largeCost / Math.max(smallCost, 1e-3);
+        if (ratio > MAX_RATIO) {
+            throw new Error(`${shape}: ${largeCost.toFixed(1)} us/KiB at 1 MiB vs ${smallCost.toFixed(1)} us/KiB at 64 KiB`);
+        }
+        print(`ok - ${shape}: ${smallCost.toFixed(1)} us/KiB at 64 KiB, ${largeCost.toFixed(1)} us/KiB at 1 MiB`);
+    }
+
+    print('all large snippet tests passed');
+}
+
+try {
+    run();
+} catch (e) {
+    logError(e);
+    imports.system.exit(1);
+}
@@ -0,0 +1,45 @@
+import Gio from 'gi://Gio';
+
+import {KNOWN_PREFIXES, SOURCE_KEYWORDS} from './dist/vocab.js';
+
+function readTextFile(path) {
+    const file = Gio.File.new_for_path(path);
+    const [, contents] = file.load_contents(null);
+    const bytes = contents instanceof Uint8Array ? contents : Uint8Array.from(contents);
+    return new TextDecoder('utf-8').decode(bytes);
+}
+
+// Same rules as read_words() in trimmeh-core/build.rs.
+function readWords(path) {
+    return readTextFile(path)
+        .split('\n')
+        .map(line => line.trim())
+        .filter(line => line.length > 0 && !line.startsWith('#'));
+}
+
+function assertSameWords(name, path, actual) {
+    const expected = readWords(path);
+    const missing = expected.filter(word => !actual.includes(word));
+    const extra = actual.filter(word => !expected.includes(word));
+    if (missing.length > 0 || extra.length > 0) {
+        throw new Error(`${name} differs from ${path}: missing ${JSON.stringify(missing)}, extra ${JSON.stringify(extra)}`);
+    }
+    if (JSON.stringify(actual) !== JSON.stringify(expected)) {
+        throw new Error(`${name} lists the words of ${path} in another order`);
+    }
+    print(`ok - ${name}: ${actual.length} words`);
+}
+
+function run() {
+    assertSameWords('KNOWN_PREFIXES', 'trimmeh-core/vocab/known-prefixes.txt', KNOWN_PREFIXES);
+    assertSameWords('SOURCE_KEYWORDS', 'trimmeh-core/vocab/source-keywords.txt', SOURCE_KEYWORDS);
+
+    print('all vocab tests passed');
+}
+
+try {
+    run();
+} catch (e) {
+    logError(e);
+    imports.system.exit(1);
+}
@@ -5,7 +5,7 @@ use anyhow::Result;
 use clap::{ArgAction, Args, Parser, Subcommand, ValueEnum};
 use similar::TextDiff;
 use serde::Serialize;
-use trimmeh_core::{trim, Aggressiveness, Options};
+use trimmeh_core::{trim_borrowed, Aggressiveness, Options, PrefixSet};
 
 #[derive(Parser)]
 #[command(name = "trimmeh-cli")]
@@ -52,6 +52,12 @@ struct TrimArgs {
     /// Maximum number of lines; above this we skip trimming
     #[arg(long, default_value_t = 10)]
     max_lines: usize,
+    /// Extra first words that mark a line as a command (repeatable)
+    #[arg(long = "prefix", value_name = "WORD")]
+    prefixes: Vec<String>,
+    /// Flatten backslash continuation chains longer than 10 lines (up to --max-lines)
+    #[arg(long = "large-snippets", action = ArgAction::SetTrue)]
+    large_snippets: bool,
 }
 
 #[derive(ValueEnum, Clone, Copy)]
@@ -87,7 +93,7 @@ fn run_trim(args: TrimArgs) -> Result<()> {
     } else {
         args.aggressiveness.into()
     };
-    let result = trim(&input, aggr, opts);
+    let result = trim_borrowed(&input, aggr, &opts);
 
     if args.json {
         #[derive(Serialize)]
@@ -131,12 +137,12 @@ fn run_diff(args: TrimArgs) -> Result<()> {
     } else {
         args.aggressiveness.into()
     };
-    let result = trim(&input, aggr, opts);
+    let result = trim_borrowed(&input, aggr, &opts);
     if !result.changed {
         eprintln!("(no change)");
         return Ok(());
     }
-    let diff = TextDiff::from_lines(&input, &result.output);
+    let diff = TextDiff::from_lines(input.as_str(), result.output.as_ref());
     let formatted = diff
         .unified_diff()
         .context_radius(3)
@@ -169,5 +175,7 @@ fn options_from(args: &TrimArgs) -> Options {
         strip_box_chars: if args.remove_box_drawing { true } else { args.strip_box_chars },
         trim_prompts: args.trim_prompts,
         max_lines: args.max_lines,
+        extra_prefixes: PrefixSet::new(&args.prefixes),
+        large_snippets: args.large_snippets,
     }
 }
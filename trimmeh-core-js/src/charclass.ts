@@ -0,0 +1,122 @@
+/**
+ * Character classes used by the trim heuristics, as one lookup table.
+ *
+ * Every class is one bit of a mask, looked up per UTF-16 code unit the same
+ * way non-unicode RegExps see the text. The table has two levels: the high
+ * byte of a code unit selects a block of 256 masks, and blocks without
+ * members all share block 0. It mirrors trimmeh-core/src/charclass.rs, whose
+ * tables are built at compile time; here they are built once at module load.
+ * SPACE follows RegExp \s, which includes U+FEFF and not U+0085.
+ */
+
+/** RegExp \s, which is also what trim() removes. */
+export const SPACE = 1 << 0;
+/** Box-drawing gutter characters. */
+export const BOX = 1 << 1;
+/** [A-Za-z0-9] */
+export const ALNUM = 1 << 2;
+/** [A-Za-z0-9_], RegExp \w and what \b tests against. */
+export const WORD = 1 << 3;
+/** [A-Za-z0-9._~-]: path components and hyphen-join neighbours. */
+export const PATH = 1 << 4;
+/** [A-Za-z0-9./~_-]: a command-like first token. */
+export const TOKEN = 1 << 5;
+/** [A-Z0-9_.-]: neighbours of a wrapped identifier or constant. */
+export const WORD_JOIN = 1 << 6;
+/** [/:~]: the character before a wrapped path. */
+export const PATH_HEAD = 1 << 7;
+/** [A-Za-z0-9._-]: the character after a wrapped path. */
+export const PATH_TAIL = 1 << 8;
+/** [./~_=:-]: punctuation typical of commands. */
+export const PUNCT = 1 << 9;
+
+export const BOX_CHARS = '│┃╎╏┆┇┊┋╽╿￨｜';
+
+// The only non-ASCII members of any class.
+const SPACE_RANGES: readonly [number, number][] = [
+    [0x09, 0x0d], [0x20, 0x20], [0xa0, 0xa0], [0x1680, 0x1680], [0x2000, 0x200a],
+    [0x2028, 0x2029], [0x202f, 0x202f], [0x205f, 0x205f], [0x3000, 0x3000], [0xfeff, 0xfeff],
+];
+
+function asciiClass(c: number): number {
+    const ch = String.fromCharCode(c);
+    const upper = c >= 0x41 && c <= 0x5a;
+    const digit = c >= 0x30 && c <= 0x39;
+    const alnum = upper || digit || (c >= 0x61 && c <= 0x7a);
+    let mask = 0;
+    if (alnum) {
+        mask |= ALNUM;
+    }
+    if (alnum || ch === '_') {
+        mask |= WORD;
+    }
+    if (alnum || '._~-'.includes(ch)) {
+        mask |= PATH;
+    }
+    if (alnum || './~_-'.includes(ch)) {
+        mask |= TOKEN;
+    }
+    if (upper || digit || '_.-'.includes(ch)) {
+        mask |= WORD_JOIN;
+    }
+    if ('/:~'.includes(ch)) {
+        mask |= PATH_HEAD;
+    }
+    if (alnum || '._-'.includes(ch)) {
+        mask |= PATH_TAIL;
+    }
+    if ('./~_=:-'.includes(ch)) {
+        mask |= PUNCT;
+    }
+    return mask;
+}
+
+function buildTables(): {index: Uint8Array; blocks: Uint16Array} {
+    const members = new Map<number, number[]>();
+    const add = (c: number, mask: number) => {
+        const block = members.get(c >> 8) ?? [];
+        block.push(c, mask);
+        members.set(c >> 8, block);
+    };
+    for (let c = 0; c < 0x80; c += 1) {
+        add(c, asciiClass(c));
+    }
+    for (const [first, last] of SPACE_RANGES) {
+        for (let c = first; c <= last; c += 1) {
+            add(c, SPACE);
+        }
+    }
+    for (let i = 0; i < BOX_CHARS.length; i += 1) {
+        add(BOX_CHARS.charCodeAt(i), BOX);
+    }
+
+    const index = new Uint8Array(0x100);
+    const blocks = new Uint16Array((members.size + 1) << 8);
+    let next = 1;
+    for (const [block, entries] of members) {
+        index[block] = next;
+        for (let i = 0; i < entries.length; i += 2) {
+            blocks[next << 8 | (entries[i] & 0xff)] |= entries[i + 1];
+        }
+        next += 1;
+    }
+    return {index, blocks};
+}
+
+const {index: INDEX, blocks: BLOCKS} = buildTables();
+
+/**
+ * The class mask of a UTF-16 code unit. Anything else, like -1 or the NaN
+ * charCodeAt() returns past the end, has no class.
+ */
+export function classOf(c: number): number {
+    return BLOCKS[INDEX[c >> 8] << 8 | (c & 0xff)];
+}
+
+export function hasClass(c: number, mask: number): boolean {
+    return (classOf(c) & mask) !== 0;
+}
+
+export function isSpace(c: number): boolean {
+    return (classOf(c) & SPACE) !== 0;
+}
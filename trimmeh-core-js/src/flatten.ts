@@ -0,0 +1,205 @@
+/**
+ * Single-pass flattening of a multi-line command into one line.
+ *
+ * flatten() rewrites every whitespace run in one left-to-right pass and
+ * produces exactly what the original chain of RegExp replacements
+ * (flattenRegex) produced: blank-line placeholder, hyphen join, word join,
+ * path join, backslash merge, whitespace collapse, trim. Each pattern spans
+ * one whitespace run plus its neighbours, so a run is decided from those
+ * alone; the only state carried between runs is which neighbour the previous
+ * join of each kind consumed, since replace() never overlaps matches.
+ */
+import {hasClass, isSpace, PATH, PATH_HEAD, PATH_TAIL, WORD_JOIN} from './charclass.js';
+
+const CH_LF = 0x0a;
+const CH_MINUS = 0x2d;
+const CH_BACKSLASH = 0x5c;
+// The placeholder ends in '_', which the hyphen join accepts as $1.
+const CH_PLACEHOLDER_TAIL = 0x5f;
+
+/**
+ * The flattener state after a whitespace run that holds a '\n'. A run is
+ * decided by its own code units and the one after it, so a text that starts
+ * with the same `offset` + 1 code units can resume from here and reuse
+ * `output`.
+ */
+export interface FlattenCheckpoint {
+    offset: number;
+    output: string;
+    pending: string;
+    mergedBackslash: boolean;
+    // The code unit at `offset` shifts prev into prev2 before prev2 is read.
+    prev: number;
+    prevPos: number;
+    hyphenConsumed: number;
+    wordConsumed: number;
+}
+
+export function flatten(text: string, preserveBlankLines: boolean): {output: string; mergedBackslash: boolean} {
+    return flattenFrom(text, preserveBlankLines, null, null);
+}
+
+/**
+ * flatten() starting from `resume`, which must have been taken on a text
+ * with the same prefix and the same preserveBlankLines. When `checkpoints`
+ * is given, one is appended after every run with a '\n' that is not at the
+ * end of the text.
+ */
+export function flattenFrom(
+    text: string,
+    preserveBlankLines: boolean,
+    resume: FlattenCheckpoint | null,
+    checkpoints: FlattenCheckpoint[] | null,
+): {output: string; mergedBackslash: boolean} {
+    let output = resume ? resume.output : '';
+    // Separator owed before the next copied text. It is dropped at either
+    // end, which is what the final trim() did.
+    let pending = resume ? resume.pending : '';
+    let mergedBackslash = resume ? resume.mergedBackslash : false;
+    // Start of the text not yet copied; whitespace runs are never copied.
+    let copyFrom = resume ? resume.offset : 0;
+    // The two code units before the current position as the joins see them,
+    // with their offsets; a whitespace run or placeholder counts as one.
+    let prev = resume ? resume.prev : -1;
+    let prevPos = resume ? resume.prevPos : -1;
+    let prev2 = -1;
+    let prev2Pos = -1;
+    // Offsets of the $2 last consumed by the hyphen and word joins.
+    let hyphenConsumed = resume ? resume.hyphenConsumed : -1;
+    let wordConsumed = resume ? resume.wordConsumed : -1;
+
+    const copy = (end: number): void => {
+        if (end > copyFrom) {
+            if (output.length > 0) {
+                output += pending;
+            }
+            output += text.slice(copyFrom, end);
+            pending = '';
+        }
+    };
+    const space = (): void => {
+        if (!pending.endsWith(' ')) {
+            pending += ' ';
+        }
+    };
+
+    let i = copyFrom;
+    while (i < text.length) {
+        const c = text.charCodeAt(i);
+        if (!isSpace(c)) {
+            prev2 = prev;
+            prev2Pos = prevPos;
+            prev = c;
+            prevPos = i;
+            i += 1;
+            continue;
+        }
+
+        const start = i;
+        let newlines = 0;
+        while (i < text.length && isSpace(text.charCodeAt(i))) {
+            if (text.charCodeAt(i) === CH_LF) {
+                newlines += 1;
+            }
+            i += 1;
+        }
+        const last = text.charCodeAt(i - 1);
+        const next = i < text.length ? text.charCodeAt(i) : -1;
+        const before = prev;
+        const beforePos = prevPos;
+        const before2 = prev2;
+        const before2Pos = prev2Pos;
+        prev2 = prev;
+        prev2Pos = prevPos;
+        prev = last;
+        prevPos = start;
+
+        if (newlines === 0) {
+            copy(start);
+            space();
+        } else if (preserveBlankLines && newlines >= 2) {
+            copy(start);
+            if (c !== CH_LF) {
+                space();
+            }
+            pending += '\n\n';
+            if (last !== CH_LF) {
+                space();
+            } else {
+                prev = CH_PLACEHOLDER_TAIL;
+            }
+        } else if (before === CH_MINUS && hasClass(next, PATH) && hasClass(before2, PATH) &&
+            before2Pos !== hyphenConsumed) {
+            copy(start);
+            hyphenConsumed = i;
+        } else if (hasClass(before, WORD_JOIN) && hasClass(next, WORD_JOIN) && beforePos !== wordConsumed) {
+            copy(start);
+            wordConsumed = i;
+        } else if (hasClass(before, PATH_HEAD) && hasClass(next, PATH_TAIL)) {
+            copy(start);
+        } else if (before === CH_BACKSLASH) {
+            copy(start - 1);
+            mergedBackslash = true;
+            space();
+        } else {
+            copy(start);
+            space();
+        }
+        copyFrom = i;
+        if (checkpoints && newlines > 0 && i < text.length) {
+            checkpoints.push({
+                offset: i,
+                output,
+                pending,
+                mergedBackslash,
+                prev,
+                prevPos,
+                hyphenConsumed,
+                wordConsumed,
+            });
+        }
+    }
+    copy(text.length);
+    return {output, mergedBackslash};
+}
+
+// ---------- RegExp reference ----------
+
+const RE_BLANK_PLACEHOLDER = /\n\s*\n/g;
+const RE_HYPHEN_JOIN = /([A-Za-z0-9._~-])-\s*\n\s*([A-Za-z0-9._~-])/gm;
+const RE_ADJ_WORD_JOIN = /([A-Z0-9_.-])\s*\n\s*([A-Z0-9_.-])/gm;
+const RE_PATH_JOIN = /([/:~])\s*\n\s*([A-Za-z0-9._-])/gm;
+const RE_BACKSLASH_NEWLINE = /\\\s*\n/g;
+const RE_BACKSLASH_NEWLINE_TEST = /\\\s*\n/;
+const RE_NEWLINES_TO_SPACE = /\n+/g;
+const RE_SPACES = /\s+/g;
+
+/**
+ * The replacement chain flatten() replaced. Input that already contains the
+ * placeholder text is turned into blank lines here but not there.
+ */
+export function flattenRegex(text: string, preserveBlankLines: boolean): {output: string; mergedBackslash: boolean} {
+    let result = text;
+    if (preserveBlankLines) {
+        result = result.replace(RE_BLANK_PLACEHOLDER, '__TRIMMEH_BLANK__PLACEHOLDER__');
+    }
+
+    result = result.replace(RE_HYPHEN_JOIN, '$1-$2');
+    result = result.replace(RE_ADJ_WORD_JOIN, '$1$2');
+    result = result.replace(RE_PATH_JOIN, '$1$2');
+
+    let mergedBackslash = false;
+    if (RE_BACKSLASH_NEWLINE_TEST.test(result)) {
+        mergedBackslash = true;
+        result = result.replace(RE_BACKSLASH_NEWLINE, ' ');
+    }
+
+    result = result.replace(RE_NEWLINES_TO_SPACE, ' ');
+    result = result.replace(RE_SPACES, ' ');
+
+    if (preserveBlankLines) {
+        result = result.split('__TRIMMEH_BLANK__PLACEHOLDER__').join('\n\n');
+    }
+
+    return {output: result.trim(), mergedBackslash};
+}
@@ -0,0 +1,295 @@
+/**
+ * Removal of box-drawing gutters around copied terminal output.
+ *
+ * stripBoxDrawingCharacters() classifies code units through the charclass
+ * table and produces exactly what the original chain of RegExp replacements
+ * (stripBoxRegex) produced, with B standing for a box character:
+ *
+ * 1. `│ │` becomes a space;
+ * 2. when most non-empty lines start (end) with B, `^\s*B+ ?` (` ?B+\s*$`)
+ *    is removed from every line;
+ * 3. `\|\s*B+\s*` becomes `| `;
+ * 4. `([:/])\s*B+\s*([A-Za-z0-9])` becomes `$1$2`;
+ * 5. `(\S)\s*B+\s*(\S)` becomes `$1 $2`;
+ * 6. `\s*B+\s*` becomes a space, runs of spaces collapse, and the result is
+ *    trimmed.
+ *
+ * Whitespace and box characters are disjoint classes, so every greedy run in
+ * these patterns ends at the first code unit outside its class and each
+ * pattern reduces to one left-to-right walk.
+ */
+import {ALNUM, BOX, BOX_CHARS, classOf, hasClass, SPACE} from './charclass.js';
+
+const CH_SPACE = 0x20;
+const CH_SLASH = 0x2f;
+const CH_COLON = 0x3a;
+
+/** End of the run of `mask` code units starting at i, at most `end`. */
+function runEnd(text: string, i: number, mask: number, end = text.length): number {
+    while (i < end && hasClass(text.charCodeAt(i), mask)) {
+        i += 1;
+    }
+    return i;
+}
+
+/** \s*B+\s* at i: the end of the match, or -1 without box characters. */
+function gutterEnd(text: string, i: number): number {
+    const boxes = runEnd(text, i, SPACE);
+    const end = runEnd(text, boxes, BOX);
+    return end > boxes ? runEnd(text, end, SPACE) : -1;
+}
+
+function hasBox(text: string): boolean {
+    for (let i = 0; i < text.length; i += 1) {
+        if (hasClass(text.charCodeAt(i), BOX)) {
+            return true;
+        }
+    }
+    return false;
+}
+
+export function stripBoxDrawingCharacters(text: string): string | null {
+    if (!hasBox(text)) {
+        return null;
+    }
+
+    let result = text;
+    if (result.includes('│ │')) {
+        result = result.split('│ │').join(' ');
+    }
+
+    result = stripLineGutters(result) ?? result;
+    result = joinBoxAfterPipe(result);
+    result = joinBoxInPath(result);
+    result = joinBoxMidToken(result);
+    const trimmed = replaceRemainingBoxes(result).trim();
+    return trimmed === text ? null : trimmed;
+}
+
+/** Step 2. Lines are split on '\n', so the '\n' itself is never removed. */
+function stripLineGutters(text: string): string | null {
+    let nonEmpty = 0;
+    let leading = 0;
+    let trailing = 0;
+    for (let start = 0; start <= text.length;) {
+        let end = text.indexOf('\n', start);
+        end = end < 0 ? text.length : end;
+        const first = runEnd(text, start, SPACE, end);
+        if (first < end) {
+            let last = end - 1;
+            while (hasClass(text.charCodeAt(last), SPACE)) {
+                last -= 1;
+            }
+            nonEmpty += 1;
+            leading += hasClass(text.charCodeAt(first), BOX) ? 1 : 0;
+            trailing += hasClass(text.charCodeAt(last), BOX) ? 1 : 0;
+        }
+        start = end + 1;
+    }
+    const majority = Math.floor(nonEmpty / 2) + 1;
+    const stripLeading = nonEmpty > 0 && leading >= majority;
+    const stripTrailing = nonEmpty > 0 && trailing >= majority;
+    if (!stripLeading && !stripTrailing) {
+        return null;
+    }
+
+    let out = '';
+    for (let start = 0; start <= text.length;) {
+        let end = text.indexOf('\n', start);
+        end = end < 0 ? text.length : end;
+        let from = start;
+        if (stripLeading) {
+            const boxes = runEnd(text, start, SPACE, end);
+            const boxesEnd = runEnd(text, boxes, BOX, end);
+            if (boxesEnd > boxes) {
+                from = boxesEnd < end && text.charCodeAt(boxesEnd) === CH_SPACE ? boxesEnd + 1 : boxesEnd;
+            }
+        }
+        let to = end;
+        if (stripTrailing) {
+            let content = end;
+            while (content > from && hasClass(text.charCodeAt(content - 1), SPACE)) {
+                content -= 1;
+            }
+            let boxes = content;
+            while (boxes > from && hasClass(text.charCodeAt(boxes - 1), BOX)) {
+                boxes -= 1;
+            }
+            if (boxes < content) {
+                to = boxes > from && text.charCodeAt(boxes - 1) === CH_SPACE ? boxes - 1 : boxes;
+            }
+        }
+        out += text.slice(from, to);
+        if (end < text.length) {
+            out += '\n';
+        }
+        start = end + 1;
+    }
+    return out;
+}
+
+/** Step 3. */
+function joinBoxAfterPipe(text: string): string {
+    let out = '';
+    let copied = 0;
+    for (let i = text.indexOf('|'); i >= 0; i = text.indexOf('|', i + 1)) {
+        if (i < copied) {
+            continue;
+        }
+        const end = gutterEnd(text, i + 1);
+        if (end >= 0) {
+            out += `${text.slice(copied, i)}| `;
+            copied = end;
+        }
+    }
+    return copied === 0 ? text : out + text.slice(copied);
+}
+
+/** Step 4. */
+function joinBoxInPath(text: string): string {
+    let out = '';
+    let copied = 0;
+    for (let i = 0; i < text.length; i += 1) {
+        const c = text.charCodeAt(i);
+        if (i < copied || (c !== CH_COLON && c !== CH_SLASH)) {
+            continue;
+        }
+        const end = gutterEnd(text, i + 1);
+        if (end >= 0 && hasClass(text.charCodeAt(end), ALNUM)) {
+            out += text.slice(copied, i + 1) + text[end];
+            copied = end + 1;
+        }
+    }
+    return copied === 0 ? text : out + text.slice(copied);
+}
+
+/**
+ * Step 5. Without a non-space code unit after the gutter the match backs off
+ * and takes the last box character as $2.
+ */
+function joinBoxMidToken(text: string): string {
+    let out = '';
+    let copied = 0;
+    for (let i = 0; i < text.length; i += 1) {
+        if (i < copied || hasClass(text.charCodeAt(i), SPACE)) {
+            continue;
+        }
+        const boxes = runEnd(text, i + 1, SPACE);
+        const boxesEnd = runEnd(text, boxes, BOX);
+        if (boxesEnd === boxes) {
+            continue;
+        }
+        const tail = runEnd(text, boxesEnd, SPACE);
+        let end: number;
+        if (tail < text.length) {
+            end = tail + 1;
+        } else if (boxesEnd - boxes > 1) {
+            end = boxesEnd;
+        } else {
+            continue;
+        }
+        out += `${text.slice(copied, i + 1)} ${text[end - 1]}`;
+        copied = end;
+    }
+    return copied === 0 ? text : out + text.slice(copied);
+}
+
+/**
+ * Step 6, minus the final trim: the remaining gutters become one space and
+ * space runs collapse. Whether `out` ends in a space is tracked rather than
+ * read back, which would flatten the growing string on every append.
+ */
+function replaceRemainingBoxes(text: string): string {
+    let out = '';
+    let spaced = false;
+    let copied = 0;
+    let i = 0;
+    while (i < text.length) {
+        const c = classOf(text.charCodeAt(i));
+        if ((c & (SPACE | BOX)) === 0) {
+            i += 1;
+            continue;
+        }
+        if (i > copied) {
+            out += text.slice(copied, i);
+            spaced = false;
+        }
+        const boxes = runEnd(text, i, SPACE);
+        const end = runEnd(text, boxes, BOX);
+        if (end > boxes) {
+            out += spaced ? '' : ' ';
+            spaced = true;
+            i = runEnd(text, end, SPACE);
+        } else {
+            // No match can start anywhere in whitespace that a box does not follow.
+            for (; i < boxes; i += 1) {
+                const space = text.charCodeAt(i) === CH_SPACE;
+                out += space && spaced ? '' : text[i];
+                spaced = space;
+            }
+        }
+        copied = i;
+    }
+    return out + text.slice(copied);
+}
+
+/** The replacement chain stripBoxDrawingCharacters() replaced. */
+export function stripBoxRegex(text: string): string | null {
+    const boxAny = new RegExp(`[${BOX_CHARS}]`);
+    if (!boxAny.test(text)) {
+        return null;
+    }
+
+    let result = text;
+    if (result.includes('│ │')) {
+        result = result.split('│ │').join(' ');
+    }
+
+    const lines = result.split('\n');
+    const nonEmpty = lines.map(l => l.trim()).filter(l => l.length > 0);
+
+    const leadingPattern = new RegExp(`^\\s*[${BOX_CHARS}]+ ?`);
+    const trailingPattern = new RegExp(` ?[${BOX_CHARS}]+\\s*$`);
+
+    let stripLeading = false;
+    let stripTrailing = false;
+    if (nonEmpty.length > 0) {
+        const majority = Math.floor(nonEmpty.length / 2) + 1;
+        const leadingMatches = nonEmpty.filter(line => leadingPattern.test(line)).length;
+        const trailingMatches = nonEmpty.filter(line => trailingPattern.test(line)).length;
+        stripLeading = leadingMatches >= majority;
+        stripTrailing = trailingMatches >= majority;
+    }
+
+    if (stripLeading || stripTrailing) {
+        const rebuilt: string[] = [];
+        rebuilt.length = lines.length;
+        for (let i = 0; i < lines.length; i += 1) {
+            let line = lines[i];
+            if (stripLeading) {
+                line = line.replace(leadingPattern, '');
+            }
+            if (stripTrailing) {
+                line = line.replace(trailingPattern, '');
+            }
+            rebuilt[i] = line;
+        }
+        result = rebuilt.join('\n');
+    }
+
+    const boxAfterPipe = new RegExp(`\\|\\s*[${BOX_CHARS}]+\\s*`, 'g');
+    result = result.replace(boxAfterPipe, '| ');
+
+    const boxPathJoin = new RegExp(`([:/])\\s*[${BOX_CHARS}]+\\s*([A-Za-z0-9])`, 'g');
+    result = result.replace(boxPathJoin, '$1$2');
+
+    const boxMidToken = new RegExp(`(\\S)\\s*[${BOX_CHARS}]+\\s*(\\S)`, 'g');
+    result = result.replace(boxMidToken, '$1 $2');
+
+    const boxAnywhere = new RegExp(`\\s*[${BOX_CHARS}]+\\s*`, 'g');
+    result = result.replace(boxAnywhere, ' ');
+
+    result = result.replace(/ {2,}/g, ' ');
+    const trimmed = result.trim();
+    return trimmed === text ? null : trimmed;
+}
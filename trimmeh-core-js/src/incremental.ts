@@ -0,0 +1,77 @@
+/**
+ * Line-level analysis kept between trims of texts that share a prefix.
+ *
+ * Selecting text in a terminal or browser can publish a clipboard value per
+ * mouse move, each extending the one before. AnalysisCache keeps the
+ * checkpoints commandSignalsFrom() and flattenFrom() take at line breaks for
+ * the last text each of them saw; a new text resumes from the last
+ * checkpoint inside the prefix it shares with that text, so only the lines
+ * after it are scanned again. Results are identical to a scan from scratch.
+ */
+import {flattenFrom} from './flatten.js';
+import type {FlattenCheckpoint} from './flatten.js';
+import {commandSignalsFrom} from './signals.js';
+import type {CommandSignals, SignalsCheckpoint} from './signals.js';
+import type {PrefixTrie} from './vocab.js';
+
+function commonPrefixLength(a: string, b: string): number {
+    const limit = Math.min(a.length, b.length);
+    let i = 0;
+    while (i < limit && a.charCodeAt(i) === b.charCodeAt(i)) {
+        i += 1;
+    }
+    return i;
+}
+
+/** Index of the last checkpoint whose offset is below `limit`, or -1. */
+function lastBelow(checkpoints: readonly {offset: number}[], limit: number): number {
+    let found = checkpoints.length - 1;
+    while (found >= 0 && checkpoints[found].offset >= limit) {
+        found -= 1;
+    }
+    return found;
+}
+
+export class AnalysisCache {
+    private signalsText = '';
+    private signalsPrefixes: PrefixTrie | null = null;
+    private signalsCheckpoints: SignalsCheckpoint[] = [];
+
+    private flattenText = '';
+    private flattenBlankLines = false;
+    private flattenCheckpoints: FlattenCheckpoint[] = [];
+
+    /** Lines the last commandSignals() call resumed past instead of scanning. */
+    reusedLines = 0;
+
+    commandSignals(text: string, extraPrefixes: PrefixTrie): CommandSignals {
+        let kept = -1;
+        if (extraPrefixes === this.signalsPrefixes) {
+            // A checkpoint at offset n only needs the first n code units.
+            kept = lastBelow(this.signalsCheckpoints, commonPrefixLength(this.signalsText, text) + 1);
+        }
+        const checkpoints = this.signalsCheckpoints.slice(0, kept + 1);
+        const resume = kept >= 0 ? checkpoints[kept] : null;
+        this.reusedLines = resume ? resume.signals.lines : 0;
+        const signals = commandSignalsFrom(text, extraPrefixes, resume, checkpoints);
+        this.signalsText = text;
+        this.signalsPrefixes = extraPrefixes;
+        this.signalsCheckpoints = checkpoints;
+        return signals;
+    }
+
+    flatten(text: string, preserveBlankLines: boolean): {output: string; mergedBackslash: boolean} {
+        let kept = -1;
+        if (preserveBlankLines === this.flattenBlankLines) {
+            // A checkpoint at offset n also needs the code unit at n.
+            kept = lastBelow(this.flattenCheckpoints, commonPrefixLength(this.flattenText, text));
+        }
+        const checkpoints = this.flattenCheckpoints.slice(0, kept + 1);
+        const resume = kept >= 0 ? checkpoints[kept] : null;
+        const result = flattenFrom(text, preserveBlankLines, resume, checkpoints);
+        this.flattenText = text;
+        this.flattenBlankLines = preserveBlankLines;
+        this.flattenCheckpoints = checkpoints;
+        return result;
+    }
+}
@@ -1,3 +1,12 @@
+import {isSpace} from './charclass.js';
+import {flatten} from './flatten.js';
+import {stripBoxDrawingCharacters} from './gutter.js';
+import {AnalysisCache} from './incremental.js';
+import {commandSignals, isLikelyCommandLine} from './signals.js';
+import {extraPrefixTrie, isKnownCommandPrefix, PrefixTrie} from './vocab.js';
+
+const CH_BACKSLASH = 0x5c;
+
 export type Aggressiveness = 'low' | 'normal' | 'high';
 
 export interface TrimOptions {
@@ -5,6 +14,17 @@ export interface TrimOptions {
     strip_box_chars: boolean;
     trim_prompts: boolean;
     max_lines: number;
+    /**
+     * First words that mark a line as a command, on top of the built-in list.
+     * The lookup trie is cached per array, so pass the same array each time.
+     */
+    extra_prefixes?: readonly string[];
+    /**
+     * Flatten explicit continuation chains (every line but the last ends in
+     * `\`) of any length up to max_lines, instead of only those of at most
+     * 10 lines, or 5 below 'high'.
+     */
+    large_snippets: boolean;
 }
 
 export type TrimReason =
@@ -25,6 +45,7 @@ export const DEFAULT_TRIM_OPTIONS: TrimOptions = {
     strip_box_chars: true,
     trim_prompts: true,
     max_lines: 10,
+    large_snippets: false,
 };
 
 /**
@@ -33,6 +54,29 @@ export const DEFAULT_TRIM_OPTIONS: TrimOptions = {
  * Ported from upstream Trimmy's TextCleaner.swift via Trimmeh's Rust port.
  */
 export function trim(input: string, aggressiveness: Aggressiveness, options?: Partial<TrimOptions>): TrimResult {
+    return trimWith(input, aggressiveness, options, null);
+}
+
+/**
+ * trim() for a caller that keeps trimming related texts, such as the growing
+ * selection a terminal publishes while the mouse moves. The command signals
+ * and the flattened output of the lines a text shares with the previous one
+ * are reused; results are always those of trim().
+ */
+export class IncrementalTrimmer {
+    readonly cache = new AnalysisCache();
+
+    trim(input: string, aggressiveness: Aggressiveness, options?: Partial<TrimOptions>): TrimResult {
+        return trimWith(input, aggressiveness, options, this.cache);
+    }
+}
+
+function trimWith(
+    input: string,
+    aggressiveness: Aggressiveness,
+    options: Partial<TrimOptions> | undefined,
+    cache: AnalysisCache | null,
+): TrimResult {
     const opts: TrimOptions = Object.assign({}, DEFAULT_TRIM_OPTIONS, options || {});
 
     const normalizedInput = normalizeNewlines(input);
@@ -58,8 +102,10 @@ export function trim(input: string, aggressiveness: Aggressiveness, options?: Pa
         }
     }
 
+    const extraPrefixes = extraPrefixTrie(opts.extra_prefixes);
+
     if (opts.trim_prompts) {
-        const stripped = stripPromptPrefixes(current);
+        const stripped = stripPromptPrefixes(current, extraPrefixes);
         if (stripped !== null) {
             didPromptStrip = true;
             current = stripped;
@@ -71,7 +117,7 @@ export function trim(input: string, aggressiveness: Aggressiveness, options?: Pa
         current = repaired;
     }
 
-    const cmd = transformIfCommand(current, aggressiveness, opts);
+    const cmd = transformIfCommand(current, aggressiveness, opts, extraPrefixes, cache);
     if (cmd !== null) {
         current = cmd.output;
         didBackslashMerge = cmd.mergedBackslash;
@@ -97,35 +143,7 @@ function normalizeNewlines(input: string): string {
 
 // ---------- Trimmy-parity helpers ----------
 
-const BOX_CLASS = '│┃╎╏┆┇┊┋╽╿￨｜';
-
-const KNOWN_PREFIXES = [
-    'sudo', './', '~/', 'apt', 'brew', 'git', 'python', 'pip', 'pnpm', 'npm', 'yarn',
-    'cargo', 'bundle', 'rails', 'go', 'make', 'xcodebuild', 'swift', 'kubectl', 'docker',
-    'podman', 'aws', 'gcloud', 'az', 'ls', 'cd', 'cat', 'echo', 'env', 'export', 'open',
-    'node', 'java', 'ruby', 'perl', 'bash', 'zsh', 'fish', 'pwsh', 'sh',
-];
-
-const RE_BLANK_PLACEHOLDER = /\n\s*\n/g;
-const RE_HYPHEN_JOIN = /([A-Za-z0-9._~-])-\s*\n\s*([A-Za-z0-9._~-])/gm;
-const RE_ADJ_WORD_JOIN = /([A-Z0-9_.-])\s*\n\s*([A-Z0-9_.-])/gm;
-const RE_PATH_JOIN = /([/:~])\s*\n\s*([A-Za-z0-9._-])/gm;
-const RE_BACKSLASH_NEWLINE = /\\\s*\n/g;
-const RE_BACKSLASH_NEWLINE_TEST = /\\\s*\n/;
-const RE_NEWLINES_TO_SPACE = /\n+/g;
-const RE_SPACES = /\s+/g;
-
-const RE_PIPE_OR_OP = /[|&]{1,2}/;
-const RE_PROMPT_MARK = /(^|\n)\s*\$/m;
-const RE_SUDO_CMD = /^\s*(sudo\s+)?[A-Za-z0-9./~_-]+\b/m;
-const RE_PATH_TOKEN = /[A-Za-z0-9._~-]+\/[A-Za-z0-9._~-]+/;
-const RE_LIST_BULLET = /^[-*•]\s+\S/;
-const RE_LIST_NUMBERED = /^[0-9]+[.)]\s+\S/;
-const RE_LIST_BARETOKEN = /^[A-Za-z0-9]{4,}$/;
-const RE_SOURCE_KEYWORD =
-    /^\s*(import|package|namespace|using|template|class|struct|enum|extension|protocol|interface|func|def|fn|let|var|public|private|internal|open|protected|if|for|while)\b/m;
-
-function stripPromptPrefixes(text: string): string | null {
+function stripPromptPrefixes(text: string, extraPrefixes: PrefixTrie): string | null {
     const lines = text.split('\n');
     const nonEmpty = lines.filter(l => l.trim().length > 0);
     if (nonEmpty.length === 0) {
@@ -138,7 +156,7 @@ function stripPromptPrefixes(text: string): string | null {
 
     for (let i = 0; i < lines.length; i += 1) {
         const line = lines[i];
-        const stripped = stripPromptLine(line);
+        const stripped = stripPromptLine(line, extraPrefixes);
         if (stripped !== null) {
             strippedCount += 1;
             rebuilt[i] = stripped;
@@ -157,7 +175,7 @@ function stripPromptPrefixes(text: string): string | null {
     return result === text ? null : result;
 }
 
-function stripPromptLine(line: string): string | null {
+function stripPromptLine(line: string, extraPrefixes: PrefixTrie): string | null {
     const leadingMatch = line.match(/^\s*/);
     const leading = leadingMatch ? leadingMatch[0] : '';
     const remainder = line.slice(leading.length);
@@ -169,13 +187,13 @@ function stripPromptLine(line: string): string | null {
         return null;
     }
     const afterPrompt = remainder.slice(1).trimStart();
-    if (!isLikelyPromptCommand(afterPrompt)) {
+    if (!isLikelyPromptCommand(afterPrompt, extraPrefixes)) {
         return null;
     }
     return `${leading}${afterPrompt}`;
 }
 
-function isLikelyPromptCommand(content: string): boolean {
+function isLikelyPromptCommand(content: string, extraPrefixes: PrefixTrie): boolean {
     const trimmed = content.trim();
     if (trimmed.length === 0) {
         return false;
@@ -186,72 +204,12 @@ function isLikelyPromptCommand(content: string): boolean {
     }
 
     const hasPunct = /[-./~$]/.test(trimmed) || /\d/.test(trimmed);
-    const firstToken = ((trimmed.split(/\s+/)[0] || '') as string).toLowerCase();
-    const startsWithKnown = KNOWN_PREFIXES.some(p => firstToken.startsWith(p));
+    const first = trimmed.split(/\s+/)[0] || '';
+    const startsWithKnown = isKnownCommandPrefix(first, 0, first.length, extraPrefixes);
 
     return (hasPunct || startsWithKnown) && isLikelyCommandLine(trimmed);
 }
 
-function stripBoxDrawingCharacters(text: string): string | null {
-    const boxAny = new RegExp(`[${BOX_CLASS}]`);
-    if (!boxAny.test(text)) {
-        return null;
-    }
-
-    let result = text;
-    if (result.includes('│ │')) {
-        result = result.split('│ │').join(' ');
-    }
-
-    const lines = result.split('\n');
-    const nonEmpty = lines.map(l => l.trim()).filter(l => l.length > 0);
-
-    const leadingPattern = new RegExp(`^\\s*[${BOX_CLASS}]+ ?`);
-    const trailingPattern = new RegExp(` ?[${BOX_CLASS}]+\\s*$`);
-
-    let stripLeading = false;
-    let stripTrailing = false;
-    if (nonEmpty.length > 0) {
-        const majority = Math.floor(nonEmpty.length / 2) + 1;
-        const leadingMatches = nonEmpty.filter(line => leadingPattern.test(line)).length;
-        const trailingMatches = nonEmpty.filter(line => trailingPattern.test(line)).length;
-        stripLeading = leadingMatches >= majority;
-        stripTrailing = trailingMatches >= majority;
-    }
-
-    if (stripLeading || stripTrailing) {
-        const rebuilt: string[] = [];
-        rebuilt.length = lines.length;
-        for (let i = 0; i < lines.length; i += 1) {
-            let line = lines[i];
-            if (stripLeading) {
-                line = line.replace(leadingPattern, '');
-            }
-            if (stripTrailing) {
-                line = line.replace(trailingPattern, '');
-            }
-            rebuilt[i] = line;
-        }
-        result = rebuilt.join('\n');
-    }
-
-    const boxAfterPipe = new RegExp(`\\|\\s*[${BOX_CLASS}]+\\s*`, 'g');
-    result = result.replace(boxAfterPipe, '| ');
-
-    const boxPathJoin = new RegExp(`([:/])\\s*[${BOX_CLASS}]+\\s*([A-Za-z0-9])`, 'g');
-    result = result.replace(boxPathJoin, '$1$2');
-
-    const boxMidToken = new RegExp(`(\\S)\\s*[${BOX_CLASS}]+\\s*(\\S)`, 'g');
-    result = result.replace(boxMidToken, '$1 $2');
-
-    const boxAnywhere = new RegExp(`\\s*[${BOX_CLASS}]+\\s*`, 'g');
-    result = result.replace(boxAnywhere, ' ');
-
-    result = result.replace(/ {2,}/g, ' ');
-    const trimmed = result.trim();
-    return trimmed === text ? null : trimmed;
-}
-
 function repairWrappedUrl(text: string): string | null {
     const trimmed = text.trim();
     const lower = trimmed.toLowerCase();
@@ -293,181 +251,77 @@ function transformIfCommand(
     text: string,
     aggressiveness: Aggressiveness,
     opts: TrimOptions,
+    extraPrefixes: PrefixTrie,
+    cache: AnalysisCache | null,
 ): {output: string; mergedBackslash: boolean} | null {
-    if (!text.includes('\n')) {
-        return null;
+    let newlineCount = 0;
+    for (let idx = text.indexOf('\n'); idx !== -1; idx = text.indexOf('\n', idx + 1)) {
+        newlineCount += 1;
     }
-
-    const lines = text.split('\n');
-    if (lines.length < 2) {
+    if (newlineCount === 0) {
         return null;
     }
-    if (lines.length > 10) {
+    const uncapped = opts.large_snippets && isContinuationChain(text);
+    if (!uncapped && newlineCount + 1 > 10) {
         return null;
     }
-
-    const newlineCount = lines.length - 1;
     const overrideHigh = aggressiveness === 'high';
-    if (!overrideHigh && newlineCount > 4) {
+    if (!uncapped && !overrideHigh && newlineCount > 4) {
         return null;
     }
 
-    const nonEmpty = lines.filter(l => l.trim().length > 0);
-    if (!overrideHigh && isLikelyList(nonEmpty)) {
+    const s = cache ? cache.commandSignals(text, extraPrefixes) : commandSignals(text, extraPrefixes);
+    const isLikelyList = s.nonEmpty > 0 && s.listish >= Math.floor(s.nonEmpty / 2) + 1;
+    if (!overrideHigh && isLikelyList) {
         return null;
     }
 
-    const hasLineContinuation = text.includes('\\\n');
-    const hasLineJoinerAtEol = /(\\|[|&]{1,2}|;)\s*$/m.test(text);
-    const hasIndentedPipeline = /^\s*[|&]{1,2}\s+\S/m.test(text);
-    const hasExplicitJoin = hasLineContinuation || hasLineJoinerAtEol || hasIndentedPipeline;
-
-    const cmdLineCount = commandLineCount(nonEmpty);
-    if (!overrideHigh && !hasExplicitJoin && cmdLineCount === nonEmpty.length && nonEmpty.length >= 3) {
+    const hasExplicitJoin = s.lineContinuation || s.joinerAtEol || s.indentedPipeline;
+    if (!overrideHigh && !hasExplicitJoin && s.commandLines === s.nonEmpty && s.nonEmpty >= 3) {
         return null;
     }
 
-    const strongSignals =
-        hasLineContinuation ||
-        RE_PIPE_OR_OP.test(text) ||
-        RE_PROMPT_MARK.test(text) ||
-        RE_PATH_TOKEN.test(text);
-
-    const hasKnownPrefix = containsKnownCommandPrefix(nonEmpty);
-    if (!overrideHigh && !strongSignals && !hasKnownPrefix && !hasCommandPunctuation(text)) {
+    const strongSignals = s.lineContinuation || s.pipeOrOp || s.promptMark || s.pathToken;
+    if (!overrideHigh && !strongSignals && !s.knownPrefix && !s.commandPunctuation) {
         return null;
     }
 
-    if (!overrideHigh && isLikelySourceCode(text) && !strongSignals) {
+    const isLikelySourceCode = s.bracesOrBegin && s.sourceKeyword;
+    if (!overrideHigh && isLikelySourceCode && !strongSignals) {
         return null;
     }
 
-    let score = 0;
-    if (hasLineContinuation) {
-        score += 1;
-    }
-    if (RE_PIPE_OR_OP.test(text)) {
-        score += 1;
-    }
-    if (RE_PROMPT_MARK.test(text)) {
-        score += 1;
-    }
-    if (nonEmpty.length > 0 && nonEmpty.every(l => isLikelyCommandLine(l))) {
-        score += 1;
-    }
-    if (RE_SUDO_CMD.test(text)) {
-        score += 1;
-    }
-    if (RE_PATH_TOKEN.test(text)) {
-        score += 1;
-    }
+    const allCommandLines = s.nonEmpty > 0 && s.commandLines === s.nonEmpty;
+    const score = [s.lineContinuation, s.pipeOrOp, s.promptMark, allCommandLines, s.sudoCommand, s.pathToken]
+        .filter(Boolean).length;
 
     const threshold = aggressiveness === 'low' ? 3 : aggressiveness === 'normal' ? 2 : 1;
     if (score < threshold) {
         return null;
     }
 
-    const flattened = flatten(text, opts.keep_blank_lines);
+    const flattened = cache ? cache.flatten(text, opts.keep_blank_lines) : flatten(text, opts.keep_blank_lines);
     if (flattened.output === text) {
         return null;
     }
     return flattened;
 }
 
-function isLikelyCommandLine(line: string): boolean {
-    const trimmed = line.trim();
-    if (trimmed.length === 0) {
-        return false;
-    }
-    if (trimmed.startsWith('[[')) {
-        return true;
-    }
-    if (trimmed.endsWith('.')) {
-        return false;
-    }
-    return /^(sudo\s+)?[A-Za-z0-9./~_-]+(?:\s+|$)/.test(trimmed);
-}
-
-function containsKnownCommandPrefix(lines: string[]): boolean {
-    return lines.some(line => {
-        const trimmed = line.trim();
-        if (trimmed.length === 0) {
-            return false;
+/**
+ * Every line but the last ends in `\` before any trailing whitespace, so
+ * flatten() merges each line break as a continuation.
+ */
+function isContinuationChain(text: string): boolean {
+    let lineStart = 0;
+    for (let lineEnd = text.indexOf('\n'); lineEnd !== -1; lineEnd = text.indexOf('\n', lineStart)) {
+        let last = lineEnd - 1;
+        while (last >= lineStart && isSpace(text.charCodeAt(last))) {
+            last -= 1;
         }
-        const first = trimmed.split(/\s+/)[0] || '';
-        const lower = first.toLowerCase();
-        return KNOWN_PREFIXES.some(p => lower.startsWith(p));
-    });
-}
-
-function hasCommandPunctuation(text: string): boolean {
-    return /[./~_=:-]/.test(text);
-}
-
-function isLikelyList(lines: string[]): boolean {
-    if (lines.length === 0) {
-        return false;
-    }
-
-    const listish = lines.filter(line => {
-        const trimmed = line.trim();
-        if (trimmed.length === 0) {
+        if (last < lineStart || text.charCodeAt(last) !== CH_BACKSLASH) {
             return false;
         }
-        const hasSpaces = /\s/.test(trimmed);
-        if (RE_LIST_BULLET.test(trimmed)) {
-            return true;
-        }
-        if (RE_LIST_NUMBERED.test(trimmed)) {
-            return true;
-        }
-        if (
-            !hasSpaces &&
-            RE_LIST_BARETOKEN.test(trimmed) &&
-            !trimmed.includes('.') &&
-            !trimmed.includes('/') &&
-            !trimmed.includes('$')
-        ) {
-            return true;
-        }
-        return false;
-    }).length;
-
-    return listish >= (Math.floor(lines.length / 2) + 1);
-}
-
-function isLikelySourceCode(text: string): boolean {
-    const hasBraces = text.includes('{') || text.includes('}') || text.toLowerCase().includes('begin');
-    const hasKeywords = RE_SOURCE_KEYWORD.test(text);
-    return hasBraces && hasKeywords;
-}
-
-function commandLineCount(lines: string[]): number {
-    return lines.filter(isLikelyCommandLine).length;
-}
-
-function flatten(text: string, preserveBlankLines: boolean): {output: string; mergedBackslash: boolean} {
-    let result = text;
-    if (preserveBlankLines) {
-        result = result.replace(RE_BLANK_PLACEHOLDER, '__TRIMMEH_BLANK__PLACEHOLDER__');
-    }
-
-    result = result.replace(RE_HYPHEN_JOIN, '$1-$2');
-    result = result.replace(RE_ADJ_WORD_JOIN, '$1$2');
-    result = result.replace(RE_PATH_JOIN, '$1$2');
-
-    let mergedBackslash = false;
-    if (RE_BACKSLASH_NEWLINE_TEST.test(result)) {
-        mergedBackslash = true;
-        result = result.replace(RE_BACKSLASH_NEWLINE, ' ');
+        lineStart = lineEnd + 1;
     }
-
-    result = result.replace(RE_NEWLINES_TO_SPACE, ' ');
-    result = result.replace(RE_SPACES, ' ');
-
-    if (preserveBlankLines) {
-        result = result.split('__TRIMMEH_BLANK__PLACEHOLDER__').join('\n\n');
-    }
-
-    return {output: result.trim(), mergedBackslash};
+    return true;
 }
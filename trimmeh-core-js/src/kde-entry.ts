@@ -1,7 +1,14 @@
-import { trim, DEFAULT_TRIM_OPTIONS } from './index';
+import { trim, DEFAULT_TRIM_OPTIONS, IncrementalTrimmer } from './index';
 
 // Expose a stable global for the KDE QJSEngine integration.
-(globalThis as unknown as { TrimmehCore: { trim: typeof trim; DEFAULT_TRIM_OPTIONS: typeof DEFAULT_TRIM_OPTIONS } }).TrimmehCore = {
+(globalThis as unknown as {
+    TrimmehCore: {
+        trim: typeof trim;
+        DEFAULT_TRIM_OPTIONS: typeof DEFAULT_TRIM_OPTIONS;
+        IncrementalTrimmer: typeof IncrementalTrimmer;
+    };
+}).TrimmehCore = {
     trim,
     DEFAULT_TRIM_OPTIONS,
+    IncrementalTrimmer,
 };
@@ -0,0 +1,382 @@
+/**
+ * Single-pass scoring signals for transformIfCommand.
+ *
+ * commandSignals() walks the text once instead of running a dozen RegExp
+ * scans over it. commandSignalsRegex() keeps the original RegExp formulation
+ * as the reference the scanner is tested against.
+ */
+
+import {ALNUM, hasClass, isSpace, PATH, PUNCT, TOKEN, WORD} from './charclass.js';
+import {
+    extraPrefixTrie,
+    isKnownCommandPrefix,
+    KNOWN_PREFIXES,
+    PrefixTrie,
+    startsWithSourceKeyword,
+} from './vocab.js';
+
+export {extraPrefixTrie};
+
+export interface CommandSignals {
+    /** Lines split on '\n', including empty ones. */
+    lines: number;
+    /** Lines with any non-whitespace. */
+    nonEmpty: number;
+    /** Non-empty lines that look like bullets, numbered items or bare tokens. */
+    listish: number;
+    /** Non-empty lines that start like a shell command. */
+    commandLines: number;
+    lineContinuation: boolean;
+    joinerAtEol: boolean;
+    indentedPipeline: boolean;
+    pipeOrOp: boolean;
+    promptMark: boolean;
+    sudoCommand: boolean;
+    pathToken: boolean;
+    knownPrefix: boolean;
+    commandPunctuation: boolean;
+    sourceKeyword: boolean;
+    bracesOrBegin: boolean;
+}
+
+const CH_LF = 0x0a;
+const CH_CR = 0x0d;
+const CH_DOLLAR = 0x24;
+const CH_AMP = 0x26;
+const CH_RPAREN = 0x29;
+const CH_STAR = 0x2a;
+const CH_MINUS = 0x2d;
+const CH_DOT = 0x2e;
+const CH_SLASH = 0x2f;
+const CH_0 = 0x30;
+const CH_9 = 0x39;
+const CH_SEMI = 0x3b;
+const CH_BACKSLASH = 0x5c;
+const CH_LBRACE = 0x7b;
+const CH_PIPE = 0x7c;
+const CH_RBRACE = 0x7d;
+const CH_BULLET = 0x2022;
+
+// Where ^ and $ match in multiline RegExps.
+function isLineTerminator(c: number): boolean {
+    return c === CH_LF || c === CH_CR || c === 0x2028 || c === 0x2029;
+}
+
+/**
+ * The scanner state right after a '\n'. Nothing but the signals and a
+ * pending pipeline carries over a line break, so a text that starts with
+ * the same `offset` code units can resume the scan from here.
+ */
+export interface SignalsCheckpoint {
+    offset: number;
+    signals: CommandSignals;
+    pendingPipeline: boolean;
+}
+
+/** extraPrefixes extends the known command prefixes, see extraPrefixTrie(). */
+export function commandSignals(text: string, extraPrefixes: PrefixTrie = extraPrefixTrie([])): CommandSignals {
+    return commandSignalsFrom(text, extraPrefixes, null, null);
+}
+
+/**
+ * commandSignals() starting from `resume`, which must have been taken on a
+ * text with the same prefix and the same extraPrefixes. When `checkpoints`
+ * is given, one is appended after every '\n' scanned.
+ */
+export function commandSignalsFrom(
+    text: string,
+    extraPrefixes: PrefixTrie,
+    resume: SignalsCheckpoint | null,
+    checkpoints: SignalsCheckpoint[] | null,
+): CommandSignals {
+    const s: CommandSignals = resume ? {...resume.signals} : {
+        lines: 0,
+        nonEmpty: 0,
+        listish: 0,
+        commandLines: 0,
+        lineContinuation: false,
+        joinerAtEol: false,
+        indentedPipeline: false,
+        pipeOrOp: false,
+        promptMark: false,
+        sudoCommand: false,
+        pathToken: false,
+        knownPrefix: false,
+        commandPunctuation: false,
+        sourceKeyword: false,
+        bracesOrBegin: false,
+    };
+
+    const start = resume ? resume.offset : 0;
+    let beginMatched = 0;
+    let slashAfterPath = false;
+    let prevIsPath = false;
+    let lineStart = start;
+    // Line-anchored RegExp signals see \r, U+2028 and U+2029 as line breaks
+    // too, so they are evaluated per segment rather than per '\n' line.
+    let segmentStart = start;
+    const pendingPipeline = {value: resume ? resume.pendingPipeline : false};
+
+    for (let i = start; i < text.length; i += 1) {
+        const c = text.charCodeAt(i);
+        if (isLineTerminator(c)) {
+            scanSegment(text, segmentStart, i, s, pendingPipeline);
+            segmentStart = i + 1;
+            if (c === CH_LF) {
+                if (i > lineStart && text.charCodeAt(i - 1) === CH_BACKSLASH) {
+                    s.lineContinuation = true;
+                }
+                scanLine(text, lineStart, i, s, extraPrefixes);
+                lineStart = i + 1;
+                if (checkpoints) {
+                    checkpoints.push({offset: lineStart, signals: {...s}, pendingPipeline: pendingPipeline.value});
+                }
+            }
+        } else if (c === CH_PIPE || c === CH_AMP) {
+            s.pipeOrOp = true;
+        } else if (c === CH_LBRACE || c === CH_RBRACE) {
+            s.bracesOrBegin = true;
+        } else if (hasClass(c, PUNCT)) {
+            s.commandPunctuation = true;
+        }
+
+        const lower = c < 0x80 ? c | 0x20 : c;
+        if (beginMatched > 0 || lower === 0x62) {
+            beginMatched = lower === 'begin'.charCodeAt(beginMatched) ? beginMatched + 1 : lower === 0x62 ? 1 : 0;
+            if (beginMatched === 5) {
+                s.bracesOrBegin = true;
+                beginMatched = 0;
+            }
+        }
+
+        const isPath = hasClass(c, PATH);
+        if (slashAfterPath && isPath) {
+            s.pathToken = true;
+        }
+        slashAfterPath = c === CH_SLASH && prevIsPath;
+        prevIsPath = isPath;
+    }
+    scanSegment(text, segmentStart, text.length, s, pendingPipeline);
+    scanLine(text, lineStart, text.length, s, extraPrefixes);
+    return s;
+}
+
+// One '\n'-delimited line: the per-line counts that use trim().
+function scanLine(
+    text: string,
+    start: number,
+    end: number,
+    s: CommandSignals,
+    extraPrefixes: PrefixTrie,
+): void {
+    s.lines += 1;
+    let ts = start;
+    let te = end;
+    while (ts < te && isSpace(text.charCodeAt(ts))) {
+        ts += 1;
+    }
+    while (te > ts && isSpace(text.charCodeAt(te - 1))) {
+        te -= 1;
+    }
+    if (ts === te) {
+        return;
+    }
+    s.nonEmpty += 1;
+    if (isCommandLineRange(text, ts, te)) {
+        s.commandLines += 1;
+    }
+    if (isListishRange(text, ts, te)) {
+        s.listish += 1;
+    }
+    if (!s.knownPrefix) {
+        let wordEnd = ts;
+        while (wordEnd < te && !isSpace(text.charCodeAt(wordEnd))) {
+            wordEnd += 1;
+        }
+        s.knownPrefix = isKnownCommandPrefix(text, ts, wordEnd, extraPrefixes);
+    }
+}
+
+// One segment between RegExp line terminators: the ^/$ anchored signals.
+function scanSegment(
+    text: string,
+    start: number,
+    end: number,
+    s: CommandSignals,
+    pendingPipeline: {value: boolean},
+): void {
+    let first = start;
+    while (first < end && isSpace(text.charCodeAt(first))) {
+        first += 1;
+    }
+    if (first === end) {
+        return;
+    }
+    let last = end - 1;
+    while (isSpace(text.charCodeAt(last))) {
+        last -= 1;
+    }
+    // /^\s*[|&]{1,2}\s+\S/m may find its \S in a later segment.
+    if (pendingPipeline.value) {
+        s.indentedPipeline = true;
+        pendingPipeline.value = false;
+    }
+
+    const c = text.charCodeAt(first);
+    if (c === CH_DOLLAR) {
+        s.promptMark = true;
+    }
+
+    let ops = first;
+    while (ops < end && (text.charCodeAt(ops) === CH_PIPE || text.charCodeAt(ops) === CH_AMP)) {
+        ops += 1;
+    }
+    const opCount = ops - first;
+    if ((opCount === 1 || opCount === 2) && ops < text.length && isSpace(text.charCodeAt(ops))) {
+        if (last >= ops) {
+            s.indentedPipeline = true;
+        } else {
+            pendingPipeline.value = true;
+        }
+    }
+
+    const tail = text.charCodeAt(last);
+    if (tail === CH_BACKSLASH || tail === CH_PIPE || tail === CH_AMP || tail === CH_SEMI) {
+        s.joinerAtEol = true;
+    }
+
+    if (!s.sudoCommand) {
+        // /^\s*(sudo\s+)?[A-Za-z0-9./~_-]+\b/m: with an ASCII \b this holds
+        // whenever the leading token has a word character.
+        for (let i = first; i < end && hasClass(text.charCodeAt(i), TOKEN); i += 1) {
+            if (hasClass(text.charCodeAt(i), WORD)) {
+                s.sudoCommand = true;
+                break;
+            }
+        }
+    }
+
+    if (!s.sourceKeyword) {
+        s.sourceKeyword = startsWithSourceKeyword(text, first);
+    }
+}
+
+function isCommandLineRange(text: string, ts: number, te: number): boolean {
+    if (te - ts >= 2 && text.charCodeAt(ts) === 0x5b && text.charCodeAt(ts + 1) === 0x5b) {
+        return true;
+    }
+    if (text.charCodeAt(te - 1) === CH_DOT) {
+        return false;
+    }
+    let run = ts;
+    while (run < te && hasClass(text.charCodeAt(run), TOKEN)) {
+        run += 1;
+    }
+    return run > ts && (run === te || isSpace(text.charCodeAt(run)));
+}
+
+function isListishRange(text: string, ts: number, te: number): boolean {
+    const c = text.charCodeAt(ts);
+    if ((c === CH_MINUS || c === CH_STAR || c === CH_BULLET) && ts + 1 < te && isSpace(text.charCodeAt(ts + 1))) {
+        return true;
+    }
+
+    let digits = ts;
+    while (digits < te && text.charCodeAt(digits) >= CH_0 && text.charCodeAt(digits) <= CH_9) {
+        digits += 1;
+    }
+    if (digits > ts && digits + 1 < te) {
+        const mark = text.charCodeAt(digits);
+        if ((mark === CH_DOT || mark === CH_RPAREN) && isSpace(text.charCodeAt(digits + 1))) {
+            return true;
+        }
+    }
+
+    if (te - ts < 4) {
+        return false;
+    }
+    for (let i = ts; i < te; i += 1) {
+        if (!hasClass(text.charCodeAt(i), ALNUM)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+export function isLikelyCommandLine(line: string): boolean {
+    const trimmed = line.trim();
+    return trimmed.length > 0 && isCommandLineRange(trimmed, 0, trimmed.length);
+}
+
+// ---------- RegExp reference ----------
+
+const RE_JOINER_AT_EOL = /(\\|[|&]{1,2}|;)\s*$/m;
+const RE_INDENTED_PIPELINE = /^\s*[|&]{1,2}\s+\S/m;
+const RE_PIPE_OR_OP = /[|&]{1,2}/;
+const RE_PROMPT_MARK = /(^|\n)\s*\$/m;
+const RE_SUDO_CMD = /^\s*(sudo\s+)?[A-Za-z0-9./~_-]+\b/m;
+const RE_PATH_TOKEN = /[A-Za-z0-9._~-]+\/[A-Za-z0-9._~-]+/;
+const RE_LIST_BULLET = /^[-*•]\s+\S/;
+const RE_LIST_NUMBERED = /^[0-9]+[.)]\s+\S/;
+const RE_LIST_BARETOKEN = /^[A-Za-z0-9]{4,}$/;
+const RE_SOURCE_KEYWORD =
+    /^\s*(import|package|namespace|using|template|class|struct|enum|extension|protocol|interface|func|def|fn|let|var|public|private|internal|open|protected|if|for|while)\b/m;
+const RE_COMMAND_LINE = /^(sudo\s+)?[A-Za-z0-9./~_-]+(?:\s+|$)/;
+const RE_COMMAND_PUNCTUATION = /[./~_=:-]/;
+
+/** The RegExp formulation commandSignals() replaced, one scan per signal. */
+export function commandSignalsRegex(text: string, extraPrefixes: readonly string[] = []): CommandSignals {
+    const prefixes = KNOWN_PREFIXES.concat(extraPrefixes.map(p => p.trim().toLowerCase()).filter(p => p.length > 0));
+    const lines = text.split('\n');
+    const nonEmpty = lines.filter(l => l.trim().length > 0);
+    return {
+        lines: lines.length,
+        nonEmpty: nonEmpty.length,
+        listish: nonEmpty.filter(isListishRegex).length,
+        commandLines: nonEmpty.filter(isLikelyCommandLineRegex).length,
+        lineContinuation: text.includes('\\\n'),
+        joinerAtEol: RE_JOINER_AT_EOL.test(text),
+        indentedPipeline: RE_INDENTED_PIPELINE.test(text),
+        pipeOrOp: RE_PIPE_OR_OP.test(text),
+        promptMark: RE_PROMPT_MARK.test(text),
+        sudoCommand: RE_SUDO_CMD.test(text),
+        pathToken: RE_PATH_TOKEN.test(text),
+        knownPrefix: nonEmpty.some(line => {
+            const first = line.trim().split(/\s+/)[0] || '';
+            const lower = first.toLowerCase();
+            return prefixes.some(p => lower.startsWith(p));
+        }),
+        commandPunctuation: RE_COMMAND_PUNCTUATION.test(text),
+        sourceKeyword: RE_SOURCE_KEYWORD.test(text),
+        bracesOrBegin: text.includes('{') || text.includes('}') || text.toLowerCase().includes('begin'),
+    };
+}
+
+function isLikelyCommandLineRegex(line: string): boolean {
+    const trimmed = line.trim();
+    if (trimmed.length === 0) {
+        return false;
+    }
+    if (trimmed.startsWith('[[')) {
+        return true;
+    }
+    if (trimmed.endsWith('.')) {
+        return false;
+    }
+    return RE_COMMAND_LINE.test(trimmed);
+}
+
+function isListishRegex(line: string): boolean {
+    const trimmed = line.trim();
+    if (trimmed.length === 0) {
+        return false;
+    }
+    const hasSpaces = /\s/.test(trimmed);
+    return RE_LIST_BULLET.test(trimmed) ||
+        RE_LIST_NUMBERED.test(trimmed) ||
+        (!hasSpaces &&
+            RE_LIST_BARETOKEN.test(trimmed) &&
+            !trimmed.includes('.') &&
+            !trimmed.includes('/') &&
+            !trimmed.includes('$'));
+}
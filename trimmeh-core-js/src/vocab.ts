@@ -0,0 +1,175 @@
+/**
+ * Command vocabulary as flat tries.
+ *
+ * The built-in lists mirror trimmeh-core/vocab/*.txt, which the Rust build
+ * compiles into static tables; here the tries are built once at module load.
+ * tests/vocab.test.js checks that the lists match the files word for word.
+ * A lookup walks one edge per code unit of the input, so its cost does not
+ * depend on how many words a trie holds.
+ */
+
+import {hasClass, WORD} from './charclass.js';
+
+export const KNOWN_PREFIXES: readonly string[] = [
+    'sudo', './', '~/', 'apt', 'brew', 'git', 'python', 'pip', 'pnpm', 'npm', 'yarn',
+    'cargo', 'bundle', 'rails', 'go', 'make', 'xcodebuild', 'swift', 'kubectl', 'docker',
+    'podman', 'aws', 'gcloud', 'az', 'ls', 'cd', 'cat', 'echo', 'env', 'export', 'open',
+    'node', 'java', 'ruby', 'perl', 'bash', 'zsh', 'fish', 'pwsh', 'sh',
+];
+
+export const SOURCE_KEYWORDS: readonly string[] = [
+    'import', 'package', 'namespace', 'using', 'template', 'class', 'struct', 'enum',
+    'extension', 'protocol', 'interface', 'func', 'def', 'fn', 'let', 'var', 'public',
+    'private', 'internal', 'open', 'protected', 'if', 'for', 'while',
+];
+
+export class PrefixTrie {
+    // Node i owns edges firstEdge[i] .. firstEdge[i + 1], sorted by unit.
+    private readonly terminal: Uint8Array;
+    private readonly firstEdge: Uint32Array;
+    private readonly edgeUnit: Uint16Array;
+    private readonly edgeTarget: Uint32Array;
+
+    /** Empty words are ignored; words are matched as given. */
+    constructor(words: readonly string[]) {
+        const children: Map<number, number>[] = [new Map()];
+        const terminal = [false];
+        for (const word of words) {
+            if (word.length === 0) {
+                continue;
+            }
+            let node = 0;
+            for (let i = 0; i < word.length; i += 1) {
+                const unit = word.charCodeAt(i);
+                let child = children[node].get(unit);
+                if (child === undefined) {
+                    child = children.length;
+                    children[node].set(unit, child);
+                    children.push(new Map());
+                    terminal.push(false);
+                }
+                node = child;
+            }
+            terminal[node] = true;
+        }
+
+        this.terminal = Uint8Array.from(terminal, t => (t ? 1 : 0));
+        this.firstEdge = new Uint32Array(children.length + 1);
+        this.edgeUnit = new Uint16Array(children.length - 1);
+        this.edgeTarget = new Uint32Array(children.length - 1);
+        let edge = 0;
+        children.forEach((edges, node) => {
+            this.firstEdge[node] = edge;
+            for (const unit of [...edges.keys()].sort((a, b) => a - b)) {
+                this.edgeUnit[edge] = unit;
+                this.edgeTarget[edge] = edges.get(unit) as number;
+                edge += 1;
+            }
+        });
+        this.firstEdge[children.length] = edge;
+    }
+
+    get isEmpty(): boolean {
+        return this.edgeUnit.length === 0;
+    }
+
+    /**
+     * Walks text[start, end), with A-Z folded to lowercase when foldAscii is
+     * set, and returns the length of the shortest word that prefixes it and
+     * satisfies accept, or -1.
+     */
+    matchPrefix(
+        text: string,
+        start: number,
+        end: number,
+        foldAscii: boolean,
+        accept: (length: number) => boolean = () => true,
+    ): number {
+        let node = 0;
+        for (let i = start; i < end; i += 1) {
+            let unit = text.charCodeAt(i);
+            if (foldAscii && unit >= 0x41 && unit <= 0x5a) {
+                unit |= 0x20;
+            }
+            node = this.step(node, unit);
+            if (node < 0) {
+                return -1;
+            }
+            if (this.terminal[node] === 1 && accept(i + 1 - start)) {
+                return i + 1 - start;
+            }
+        }
+        return -1;
+    }
+
+    private step(node: number, unit: number): number {
+        const last = this.firstEdge[node + 1];
+        for (let e = this.firstEdge[node]; e < last; e += 1) {
+            if (this.edgeUnit[e] === unit) {
+                return this.edgeTarget[e];
+            }
+        }
+        return -1;
+    }
+}
+
+const KNOWN_PREFIX_TRIE = new PrefixTrie(KNOWN_PREFIXES);
+const SOURCE_KEYWORD_TRIE = new PrefixTrie(SOURCE_KEYWORDS);
+
+const EMPTY_TRIE = new PrefixTrie([]);
+const extraTries = new WeakMap<readonly string[], PrefixTrie>();
+
+/**
+ * The trie for user-supplied prefixes. Words are trimmed and lowercased like
+ * the token they are compared with. Tries are cached per array, so callers
+ * that keep passing the same array build it once.
+ */
+export function extraPrefixTrie(words: readonly string[] | undefined): PrefixTrie {
+    if (!words || words.length === 0) {
+        return EMPTY_TRIE;
+    }
+    let trie = extraTries.get(words);
+    if (!trie) {
+        trie = new PrefixTrie(words.map(w => String(w).trim().toLowerCase()));
+        extraTries.set(words, trie);
+    }
+    return trie;
+}
+
+function isAscii(text: string, start: number, end: number): boolean {
+    for (let i = start; i < end; i += 1) {
+        if (text.charCodeAt(i) >= 0x80) {
+            return false;
+        }
+    }
+    return true;
+}
+
+/**
+ * Same as text.slice(start, end).toLowerCase() starting with a built-in or
+ * extra prefix; only tokens with non-ASCII characters are copied.
+ */
+export function isKnownCommandPrefix(
+    text: string,
+    start: number,
+    end: number,
+    extra: PrefixTrie = EMPTY_TRIE,
+): boolean {
+    if (isAscii(text, start, end)) {
+        return anyKnownPrefix(text, start, end, extra);
+    }
+    // Some non-ASCII characters lowercase to ASCII (the Kelvin sign to k).
+    const lower = text.slice(start, end).toLowerCase();
+    return anyKnownPrefix(lower, 0, lower.length, extra);
+}
+
+function anyKnownPrefix(text: string, start: number, end: number, extra: PrefixTrie): boolean {
+    return KNOWN_PREFIX_TRIE.matchPrefix(text, start, end, true) > 0 ||
+        (!extra.isEmpty && extra.matchPrefix(text, start, end, true) > 0);
+}
+
+/** text starts at `at` with a source keyword followed by a \b boundary. */
+export function startsWithSourceKeyword(text: string, at: number): boolean {
+    return SOURCE_KEYWORD_TRIE.matchPrefix(text, at, text.length, false, length =>
+        !(at + length < text.length && hasClass(text.charCodeAt(at + length), WORD))) > 0;
+}
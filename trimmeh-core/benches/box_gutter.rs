@@ -0,0 +1,28 @@
+//! Table-driven gutter removal against the regex chain it replaced.
+//!
+//! Run with `cargo bench -p trimmeh-core --features internals`.
+use criterion::{black_box, criterion_group, criterion_main, BenchmarkId, Criterion};
+use trimmeh_core::internals::{strip_box_drawing_characters, strip_box_regex};
+
+const INPUTS: &[(&str, &str)] = &[
+    ("framed", "│ kubectl get pods \\ │\n│   -n kube-system  │\n│   | wc -l         │"),
+    ("gutter", "┃ cargo build --release\n┃ ./target/release/app --port 8080"),
+    ("path", "cd /usr/│\nlocal/bin │ ls"),
+    ("none", "echo one | grep two"),
+];
+
+fn bench_box_gutter(c: &mut Criterion) {
+    let mut group = c.benchmark_group("box_gutter");
+    for (name, input) in INPUTS {
+        group.bench_with_input(BenchmarkId::new("tables", name), input, |b, text| {
+            b.iter(|| strip_box_drawing_characters(black_box(text)))
+        });
+        group.bench_with_input(BenchmarkId::new("regex", name), input, |b, text| {
+            b.iter(|| strip_box_regex(black_box(text)))
+        });
+    }
+    group.finish();
+}
+
+criterion_group!(benches, bench_box_gutter);
+criterion_main!(benches);
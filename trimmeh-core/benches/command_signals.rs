@@ -0,0 +1,30 @@
+//! Single-pass signal scan against the per-signal regex scans it replaced.
+//!
+//! Run with `cargo bench -p trimmeh-core --features internals`.
+use criterion::{black_box, criterion_group, criterion_main, BenchmarkId, Criterion};
+use trimmeh_core::internals::{command_signals, command_signals_regex};
+use trimmeh_core::PrefixSet;
+
+const INPUTS: &[(&str, &str)] = &[
+    ("pipeline", "kubectl get pods -n kube-system \\\n  | grep Running \\\n  | wc -l"),
+    ("prompt", "$ sudo dnf install foo\n$ systemctl restart bar"),
+    ("prose", "This is a normal sentence that\nwraps onto a second line for no reason."),
+    ("list", "- apples\n- oranges\n- pears\n- plums"),
+    ("source", "fn main() {\n    let x = 1;\n    println!(\"{}\", x);\n}"),
+];
+
+fn bench_signals(c: &mut Criterion) {
+    let mut group = c.benchmark_group("command_signals");
+    for (name, input) in INPUTS {
+        group.bench_with_input(BenchmarkId::new("scan", name), input, |b, text| {
+            b.iter(|| command_signals(black_box(text), &PrefixSet::default()))
+        });
+        group.bench_with_input(BenchmarkId::new("regex", name), input, |b, text| {
+            b.iter(|| command_signals_regex(black_box(text)))
+        });
+    }
+    group.finish();
+}
+
+criterion_group!(benches, bench_signals);
+criterion_main!(benches);
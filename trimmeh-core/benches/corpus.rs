@@ -0,0 +1,80 @@
+//! Per-pass costs over the kinds of clipboard text the desktop watchers see.
+//!
+//! Each pass of `trim` runs on every corpus class on its own, followed by
+//! whole `trim` calls. Run with `cargo bench -p trimmeh-core --features
+//! internals --bench corpus`, or compare against a saved baseline with
+//! `just bench-save` / `just bench-compare`.
+use criterion::{black_box, criterion_group, criterion_main, BenchmarkId, Criterion};
+use trimmeh_core::internals::{flatten, strip_box_drawing_characters, strip_prompt_prefixes, transform_if_command};
+use trimmeh_core::{trim_borrowed, Aggressiveness, Options};
+
+fn corpus() -> Vec<(&'static str, String)> {
+    vec![
+        ("single_line", "git commit -m \"Fix flaky clipboard test\"".to_string()),
+        ("short_command", "kubectl get pods -n kube-system \\\n  | grep Running \\\n  | wc -l".to_string()),
+        (
+            "box_gutter",
+            "│ sudo dnf upgrade --refresh && \\ │\n│   sudo systemctl reboot         │".to_string(),
+        ),
+        (
+            "prompt_transcript",
+            "$ cd ~/src/trimmeh\n$ cargo build --release\n$ ./target/release/trimmeh-cli --help".to_string(),
+        ),
+        ("wrapped_url", "https://github.com/example/trimmeh/blob/main/docs/\ncore-api.md#rewrite-pipeline".to_string()),
+        (
+            "source_code",
+            "fn main() {\n    let args: Vec<String> = std::env::args().collect();\n    println!(\"{args:?}\");\n}"
+                .to_string(),
+        ),
+        ("list", "- install the extension\n- log out and back in\n- enable it in Extensions".to_string()),
+        ("oversized_log", "2025-01-01T00:00:00Z INFO served /healthz in 3ms\n".repeat(500)),
+    ]
+}
+
+fn bench_corpus(c: &mut Criterion) {
+    let opts = Options::default();
+    let corpus = corpus();
+
+    let mut group = c.benchmark_group("strip_box_drawing_characters");
+    for (name, text) in &corpus {
+        group.bench_with_input(BenchmarkId::from_parameter(name), text, |b, text| {
+            b.iter(|| strip_box_drawing_characters(black_box(text)))
+        });
+    }
+    group.finish();
+
+    let mut group = c.benchmark_group("strip_prompt_prefixes");
+    for (name, text) in &corpus {
+        group.bench_with_input(BenchmarkId::from_parameter(name), text, |b, text| {
+            b.iter(|| strip_prompt_prefixes(black_box(text), &opts.extra_prefixes))
+        });
+    }
+    group.finish();
+
+    let mut group = c.benchmark_group("transform_if_command");
+    for (name, text) in &corpus {
+        group.bench_with_input(BenchmarkId::from_parameter(name), text, |b, text| {
+            b.iter(|| transform_if_command(black_box(text), Aggressiveness::High, &opts))
+        });
+    }
+    group.finish();
+
+    let mut group = c.benchmark_group("flatten");
+    for (name, text) in &corpus {
+        group.bench_with_input(BenchmarkId::from_parameter(name), text, |b, text| {
+            b.iter(|| flatten(black_box(text), opts.keep_blank_lines))
+        });
+    }
+    group.finish();
+
+    let mut group = c.benchmark_group("trim");
+    for (name, text) in &corpus {
+        group.bench_with_input(BenchmarkId::from_parameter(name), text, |b, text| {
+            b.iter(|| trim_borrowed(black_box(text), Aggressiveness::Normal, &opts))
+        });
+    }
+    group.finish();
+}
+
+criterion_group!(benches, bench_corpus);
+criterion_main!(benches);
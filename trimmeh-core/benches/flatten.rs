@@ -0,0 +1,30 @@
+//! One-pass flatten against the chain of regex replacements it replaced.
+//!
+//! Run with `cargo bench -p trimmeh-core --features internals`.
+use criterion::{black_box, criterion_group, criterion_main, BenchmarkId, Criterion};
+use trimmeh_core::internals::{flatten, flatten_regex};
+
+const INPUTS: &[(&str, &str)] = &[
+    ("pipeline", "kubectl get pods -n kube-system \\\n  | grep Running \\\n  | wc -l"),
+    ("hyphen", "python -m pip install --upgrade-\n  strategy eager numpy scipy"),
+    ("blank", "echo one\n\n\necho two\n  \n echo three"),
+];
+
+fn bench_flatten(c: &mut Criterion) {
+    let mut group = c.benchmark_group("flatten");
+    for (name, input) in INPUTS {
+        for keep_blank_lines in [false, true] {
+            let id = format!("{name}/keep_blank_lines={keep_blank_lines}");
+            group.bench_with_input(BenchmarkId::new("one_pass", &id), input, |b, text| {
+                b.iter(|| flatten(black_box(text), keep_blank_lines))
+            });
+            group.bench_with_input(BenchmarkId::new("regex", &id), input, |b, text| {
+                b.iter(|| flatten_regex(black_box(text), keep_blank_lines))
+            });
+        }
+    }
+    group.finish();
+}
+
+criterion_group!(benches, bench_flatten);
+criterion_main!(benches);
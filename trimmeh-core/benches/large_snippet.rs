@@ -0,0 +1,41 @@
+//! Whole `trim` calls on continuation chains up to 1 MiB in large-snippet
+//! mode. Time per byte should stay flat as the input grows.
+//!
+//! Run with `cargo bench -p trimmeh-core --bench large_snippet`.
+use criterion::{black_box, criterion_group, criterion_main, BenchmarkId, Criterion, Throughput};
+use trimmeh_core::{trim, Aggressiveness, Options};
+
+const SIZES: &[(&str, usize)] = &[("64KiB", 64 << 10), ("256KiB", 256 << 10), ("1MiB", 1 << 20)];
+
+/// A `docker run` continuation chain of about `size` bytes, each line
+/// wrapped in `left` and `right`.
+fn chain(size: usize, left: &str, right: &str) -> String {
+    let mut text = format!("{left}docker run --rm \\{right}\n");
+    let mut i = 0;
+    while text.len() < size {
+        text.push_str(&format!("{left}  -e TRIMMEH_VAR_{i}=/srv/data/{i} \\{right}\n"));
+        i += 1;
+    }
+    text.push_str(&format!("{left}  registry.example.com/app:latest{right}"));
+    text
+}
+
+fn bench_large_snippet(c: &mut Criterion) {
+    let opts = Options { max_lines: usize::MAX, large_snippets: true, ..Options::default() };
+    let mut group = c.benchmark_group("large_snippet");
+    group.sample_size(20);
+    for (name, size) in SIZES {
+        for (shape, left, right) in [("plain", "", ""), ("framed", "│ ", " │")] {
+            let input = chain(*size, left, right);
+            assert!(trim(&input, Aggressiveness::Normal, opts.clone()).changed, "{shape}/{name}");
+            group.throughput(Throughput::Bytes(input.len() as u64));
+            group.bench_with_input(BenchmarkId::new(shape, name), &input, |b, text| {
+                b.iter(|| trim(black_box(text), Aggressiveness::Normal, opts.clone()))
+            });
+        }
+    }
+    group.finish();
+}
+
+criterion_group!(benches, bench_large_snippet);
+criterion_main!(benches);
@@ -0,0 +1,34 @@
+//! `trim` against `trim_borrowed`, which skips the output copy on unchanged
+//! and skipped input, the content hash, and newline normalization without
+//! a `\r`.
+//!
+//! Run with `cargo bench -p trimmeh-core --bench trim_borrowed`.
+use criterion::{black_box, criterion_group, criterion_main, BenchmarkId, Criterion};
+use trimmeh_core::{trim, trim_borrowed, Aggressiveness, Options};
+
+fn inputs() -> Vec<(&'static str, String)> {
+    vec![
+        ("flat", "kubectl get pods -n kube-system | grep Running".to_string()),
+        ("list", "- apples\n- oranges\n- pears\n- plums".to_string()),
+        ("list_crlf", "- apples\r\n- oranges\r\n- pears\r\n- plums".to_string()),
+        ("oversized_log", "2025-01-01T00:00:00Z INFO request served in 3ms\n".repeat(2000)),
+        ("command", "kubectl get pods -n kube-system \\\n  | grep Running \\\n  | wc -l".to_string()),
+    ]
+}
+
+fn bench_trim_borrowed(c: &mut Criterion) {
+    let opts = Options::default();
+    let mut group = c.benchmark_group("trim_borrowed");
+    for (name, input) in inputs() {
+        group.bench_with_input(BenchmarkId::new("trim", name), &input, |b, text| {
+            b.iter(|| trim(black_box(text), Aggressiveness::Normal, opts.clone()))
+        });
+        group.bench_with_input(BenchmarkId::new("trim_borrowed", name), &input, |b, text| {
+            b.iter(|| trim_borrowed(black_box(text), Aggressiveness::Normal, &opts))
+        });
+    }
+    group.finish();
+}
+
+criterion_group!(benches, bench_trim_borrowed);
+criterion_main!(benches);
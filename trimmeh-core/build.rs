@@ -0,0 +1,59 @@
+//! Compiles the vocabulary lists under `vocab/` into static tries.
+use std::fmt::Write as _;
+use std::path::Path;
+
+#[allow(dead_code)]
+#[path = "src/trie.rs"]
+mod trie;
+
+fn read_words(path: &str) -> Vec<String> {
+    println!("cargo:rerun-if-changed={path}");
+    let text = std::fs::read_to_string(path).unwrap_or_else(|e| panic!("read {path}: {e}"));
+    text.lines()
+        .map(str::trim)
+        .filter(|line| !line.is_empty() && !line.starts_with('#'))
+        .map(str::to_string)
+        .collect()
+}
+
+fn emit(out: &mut String, name: &str, words: &[String]) {
+    let (nodes, edges) = trie::build(words.iter().map(|word| word.as_bytes()));
+    // The word lists only back the regex reference and tests.
+    writeln!(out, "#[allow(dead_code)]\npub(crate) static {name}: &[&str] = &{words:?};").unwrap();
+    writeln!(out, "pub(crate) static {name}_TRIE: Trie<'static> = Trie {{").unwrap();
+    writeln!(out, "    nodes: &[").unwrap();
+    for node in &nodes {
+        writeln!(
+            out,
+            "        Node {{ terminal: {}, first_edge: {}, edge_count: {} }},",
+            node.terminal, node.first_edge, node.edge_count
+        )
+        .unwrap();
+    }
+    writeln!(out, "    ],\n    edges: &[").unwrap();
+    for edge in &edges {
+        writeln!(out, "        Edge {{ byte: {}, target: {} }},", edge.byte, edge.target).unwrap();
+    }
+    writeln!(out, "    ],\n}};").unwrap();
+}
+
+fn main() {
+    let prefixes = read_words("vocab/known-prefixes.txt");
+    for prefix in &prefixes {
+        // Prefixes are matched against the lowercased first word.
+        assert_eq!(*prefix, prefix.to_lowercase(), "known prefix {prefix:?} must be lowercase");
+    }
+    let keywords = read_words("vocab/source-keywords.txt");
+    for keyword in &keywords {
+        assert!(
+            keyword.bytes().all(|b| b.is_ascii_alphanumeric() || b == b'_'),
+            "source keyword {keyword:?} must be a single ASCII word"
+        );
+    }
+
+    let mut out = String::new();
+    emit(&mut out, "KNOWN_PREFIXES", &prefixes);
+    emit(&mut out, "SOURCE_KEYWORDS", &keywords);
+    let dest = Path::new(&std::env::var("OUT_DIR").expect("OUT_DIR")).join("vocab.rs");
+    std::fs::write(&dest, out).unwrap_or_else(|e| panic!("write {}: {e}", dest.display()));
+}
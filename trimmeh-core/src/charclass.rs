@@ -0,0 +1,233 @@
+//! Character classes used by the trim heuristics, as lookup tables.
+//!
+//! Every class is one bit of a `Class` mask. Both tables are built at compile
+//! time: `BYTES` classifies UTF-8 bytes (only ASCII bytes belong to a class,
+//! so scanning bytes never matches inside a multi-byte sequence), and a
+//! two-level table classifies characters of the Basic Multilingual Plane,
+//! outside of which no class has members.
+
+pub(crate) type Class = u16;
+
+/// `char::is_whitespace`, which is also the regex `\s`.
+pub(crate) const SPACE: Class = 1 << 0;
+/// Box-drawing gutter characters.
+pub(crate) const BOX: Class = 1 << 1;
+/// `[A-Za-z0-9]`
+pub(crate) const ALNUM: Class = 1 << 2;
+/// `[A-Za-z0-9_]`, the ASCII part of `\w`.
+pub(crate) const WORD: Class = 1 << 3;
+/// `[A-Za-z0-9._~-]`: path components and hyphen-join neighbours.
+pub(crate) const PATH: Class = 1 << 4;
+/// `[A-Za-z0-9./~_-]`: a command-like first token.
+pub(crate) const TOKEN: Class = 1 << 5;
+/// `[A-Z0-9_.-]`: neighbours of a wrapped identifier or constant.
+pub(crate) const WORD_JOIN: Class = 1 << 6;
+/// `[/:~]`: the character before a wrapped path.
+pub(crate) const PATH_HEAD: Class = 1 << 7;
+/// `[A-Za-z0-9._-]`: the character after a wrapped path.
+pub(crate) const PATH_TAIL: Class = 1 << 8;
+/// `[./~_=:-]`: punctuation typical of commands.
+pub(crate) const PUNCT: Class = 1 << 9;
+
+// The only non-ASCII members of any class.
+const SPACE_RANGES: [(u32, u32); 10] = [
+    (0x09, 0x0d),
+    (0x20, 0x20),
+    (0x85, 0x85),
+    (0xa0, 0xa0),
+    (0x1680, 0x1680),
+    (0x2000, 0x200a),
+    (0x2028, 0x2029),
+    (0x202f, 0x202f),
+    (0x205f, 0x205f),
+    (0x3000, 0x3000),
+];
+pub(crate) const BOX_CHARS: [char; 12] = ['│', '┃', '╎', '╏', '┆', '┇', '┊', '┋', '╽', '╿', '￨', '｜'];
+
+const fn classify(c: u32) -> Class {
+    let mut class = 0;
+    let mut i = 0;
+    while i < SPACE_RANGES.len() {
+        if c >= SPACE_RANGES[i].0 && c <= SPACE_RANGES[i].1 {
+            class |= SPACE;
+        }
+        i += 1;
+    }
+    i = 0;
+    while i < BOX_CHARS.len() {
+        if BOX_CHARS[i] as u32 == c {
+            class |= BOX;
+        }
+        i += 1;
+    }
+    if c >= 0x80 {
+        return class;
+    }
+
+    let b = c as u8;
+    let upper = b.is_ascii_uppercase();
+    let alnum = b.is_ascii_alphanumeric();
+    if alnum {
+        class |= ALNUM;
+    }
+    if alnum || b == b'_' {
+        class |= WORD;
+    }
+    if alnum || matches!(b, b'.' | b'_' | b'~' | b'-') {
+        class |= PATH;
+    }
+    if alnum || matches!(b, b'.' | b'/' | b'~' | b'_' | b'-') {
+        class |= TOKEN;
+    }
+    if upper || b.is_ascii_digit() || matches!(b, b'_' | b'.' | b'-') {
+        class |= WORD_JOIN;
+    }
+    if matches!(b, b'/' | b':' | b'~') {
+        class |= PATH_HEAD;
+    }
+    if alnum || matches!(b, b'.' | b'_' | b'-') {
+        class |= PATH_TAIL;
+    }
+    if matches!(b, b'.' | b'/' | b'~' | b'_' | b'=' | b':' | b'-') {
+        class |= PUNCT;
+    }
+    class
+}
+
+// Blocks of 256 code points that hold a member of some class.
+const fn member_blocks() -> [bool; 0x100] {
+    let mut blocks = [false; 0x100];
+    blocks[0] = true;
+    let mut i = 0;
+    while i < SPACE_RANGES.len() {
+        let mut block = SPACE_RANGES[i].0 >> 8;
+        while block <= SPACE_RANGES[i].1 >> 8 {
+            blocks[block as usize] = true;
+            block += 1;
+        }
+        i += 1;
+    }
+    i = 0;
+    while i < BOX_CHARS.len() {
+        blocks[(BOX_CHARS[i] as u32 >> 8) as usize] = true;
+        i += 1;
+    }
+    blocks
+}
+
+const fn count_blocks() -> usize {
+    let blocks = member_blocks();
+    let mut count = 0;
+    let mut block = 0;
+    while block < blocks.len() {
+        if blocks[block] {
+            count += 1;
+        }
+        block += 1;
+    }
+    count
+}
+
+// Block 0 is all zeroes and backs every block without members.
+const BLOCK_COUNT: usize = count_blocks() + 1;
+
+struct Tables {
+    index: [u8; 0x100],
+    blocks: [[Class; 0x100]; BLOCK_COUNT],
+}
+
+const fn build() -> Tables {
+    let mut tables = Tables {
+        index: [0; 0x100],
+        blocks: [[0; 0x100]; BLOCK_COUNT],
+    };
+    let members = member_blocks();
+    let mut next = 1;
+    let mut block = 0;
+    while block < 0x100 {
+        if members[block] {
+            tables.index[block] = next as u8;
+            let mut low = 0;
+            while low < 0x100 {
+                tables.blocks[next][low] = classify((block << 8 | low) as u32);
+                low += 1;
+            }
+            next += 1;
+        }
+        block += 1;
+    }
+    tables
+}
+
+const fn build_bytes() -> [Class; 0x100] {
+    let mut bytes = [0; 0x100];
+    let mut b = 0;
+    while b < 0x80 {
+        bytes[b] = classify(b as u32);
+        b += 1;
+    }
+    bytes
+}
+
+static TABLES: Tables = build();
+static BYTES: [Class; 0x100] = build_bytes();
+
+#[inline]
+pub(crate) fn class_of(c: char) -> Class {
+    let c = c as u32;
+    if c > 0xffff {
+        return 0;
+    }
+    TABLES.blocks[TABLES.index[(c >> 8) as usize] as usize][(c & 0xff) as usize]
+}
+
+#[inline]
+pub(crate) fn is(c: char, class: Class) -> bool {
+    class_of(c) & class != 0
+}
+
+#[inline]
+pub(crate) fn byte_is(b: u8, class: Class) -> bool {
+    BYTES[b as usize] & class != 0
+}
+
+#[cfg(test)]
+mod tests {
+    use super::*;
+
+    #[test]
+    fn space_matches_char_is_whitespace() {
+        for c in (0..=0x10ffff).filter_map(char::from_u32) {
+            assert_eq!(is(c, SPACE), c.is_whitespace(), "{c:?}");
+        }
+    }
+
+    #[test]
+    fn classes_match_their_definitions() {
+        let cases: [(Class, fn(char) -> bool); 10] = [
+            (SPACE, char::is_whitespace),
+            (BOX, |c| BOX_CHARS.contains(&c)),
+            (ALNUM, |c| c.is_ascii_alphanumeric()),
+            (WORD, |c| c.is_ascii_alphanumeric() || c == '_'),
+            (PATH, |c| c.is_ascii_alphanumeric() || "._~-".contains(c)),
+            (TOKEN, |c| c.is_ascii_alphanumeric() || "./~_-".contains(c)),
+            (WORD_JOIN, |c| c.is_ascii_uppercase() || c.is_ascii_digit() || "_.-".contains(c)),
+            (PATH_HEAD, |c| "/:~".contains(c)),
+            (PATH_TAIL, |c| c.is_ascii_alphanumeric() || "._-".contains(c)),
+            (PUNCT, |c| "./~_=:-".contains(c)),
+        ];
+        for (class, expected) in cases {
+            for c in (0..=0xffff).filter_map(char::from_u32) {
+                assert_eq!(is(c, class), expected(c), "class {class:#x} {c:?}");
+            }
+        }
+    }
+
+    #[test]
+    fn bytes_only_classify_ascii() {
+        for b in 0..=u8::MAX {
+            let expected = if b.is_ascii() { class_of(b as char) } else { 0 };
+            assert_eq!(BYTES[b as usize], expected, "{b:#x}");
+        }
+    }
+}
@@ -0,0 +1,194 @@
+//! Single-pass flattening of a multi-line command into one line.
+//!
+//! `flatten` rewrites every whitespace run in one left-to-right pass into a
+//! single output buffer. It produces exactly what the original chain of regex
+//! replacements (`flatten_regex`) produced:
+//!
+//! 1. with `preserve_blank_lines`, `\n\s*\n` becomes a placeholder;
+//! 2. `([A-Za-z0-9._~-])-\s*\n\s*([A-Za-z0-9._~-])` becomes `$1-$2`;
+//! 3. `([A-Z0-9_.-])\s*\n\s*([A-Z0-9_.-])` becomes `$1$2`;
+//! 4. `([/:~])\s*\n\s*([A-Za-z0-9._-])` becomes `$1$2`;
+//! 5. `\\\s*\n` becomes a space;
+//! 6. remaining whitespace collapses to one space, the placeholder becomes
+//!    `\n\n`, and the result is trimmed.
+//!
+//! Every pattern spans one maximal whitespace run plus the characters next to
+//! it, so each run is decided from its neighbours. The only state carried
+//! between runs is which neighbour the previous join of each kind consumed,
+//! because `replace_all` never lets matches overlap.
+
+use crate::charclass::{self, PATH, PATH_HEAD, PATH_TAIL, SPACE, WORD_JOIN};
+
+// The placeholder ends in `_`, which rule 2 accepts as `$1`.
+const PLACEHOLDER_TAIL: char = '_';
+
+fn push_space(out: &mut String) {
+    if !out.is_empty() && !out.ends_with(' ') {
+        out.push(' ');
+    }
+}
+
+pub fn flatten(text: &str, preserve_blank_lines: bool) -> (String, bool) {
+    let mut out = String::with_capacity(text.len());
+    let mut merged_backslash = false;
+    // The two characters before the current position as the join rules see
+    // them, with byte offsets. Whitespace runs and the placeholder count as
+    // one character each.
+    let mut prev: Option<(usize, char)> = None;
+    let mut prev2: Option<(usize, char)> = None;
+    // Offsets of the `$2` last consumed by rules 2 and 3.
+    let mut hyphen_consumed = usize::MAX;
+    let mut word_consumed = usize::MAX;
+
+    let mut chars = text.char_indices().peekable();
+    while let Some((start, c)) = chars.next() {
+        if !charclass::is(c, SPACE) {
+            out.push(c);
+            prev2 = prev;
+            prev = Some((start, c));
+            continue;
+        }
+
+        let mut newlines = usize::from(c == '\n');
+        let mut last = c;
+        while let Some(&(_, d)) = chars.peek() {
+            if !charclass::is(d, SPACE) {
+                break;
+            }
+            newlines += usize::from(d == '\n');
+            last = d;
+            chars.next();
+        }
+        let next = chars.peek().copied();
+        let (before, before2) = (prev, prev2);
+        prev2 = prev;
+        prev = Some((start, last));
+
+        if newlines == 0 {
+            push_space(&mut out);
+            continue;
+        }
+
+        if preserve_blank_lines && newlines >= 2 {
+            if c != '\n' {
+                push_space(&mut out);
+            }
+            if !out.is_empty() {
+                out.push_str("\n\n");
+            }
+            if last != '\n' {
+                push_space(&mut out);
+            } else {
+                prev = Some((start, PLACEHOLDER_TAIL));
+            }
+            continue;
+        }
+
+        if let (Some((a_pos, a)), Some((b_pos, b))) = (before, next) {
+            let (a_class, b_class) = (charclass::class_of(a), charclass::class_of(b));
+            let hyphen_join = a == '-'
+                && b_class & PATH != 0
+                && before2.is_some_and(|(pos, c)| pos != hyphen_consumed && charclass::is(c, PATH));
+            if hyphen_join {
+                hyphen_consumed = b_pos;
+                continue;
+            }
+            if a_class & b_class & WORD_JOIN != 0 && a_pos != word_consumed {
+                word_consumed = b_pos;
+                continue;
+            }
+            if a_class & PATH_HEAD != 0 && b_class & PATH_TAIL != 0 {
+                continue;
+            }
+        }
+        if before.is_some_and(|(_, a)| a == '\\') {
+            out.pop();
+            merged_backslash = true;
+        }
+        push_space(&mut out);
+    }
+
+    while out.ends_with([' ', '\n']) {
+        out.pop();
+    }
+    (out, merged_backslash)
+}
+
+#[cfg(any(test, feature = "internals"))]
+pub use reference::flatten_regex;
+
+#[cfg(any(test, feature = "internals"))]
+mod reference {
+    use once_cell::sync::Lazy;
+    use regex::Regex;
+
+    static RE_BLANK_PLACEHOLDER: Lazy<Regex> =
+        Lazy::new(|| Regex::new(r"\n\s*\n").expect("blank placeholder regex"));
+    static RE_HYPHEN_JOIN: Lazy<Regex> = Lazy::new(|| {
+        Regex::new(r"(?m)([A-Za-z0-9._~-])-\s*\n\s*([A-Za-z0-9._~-])").expect("hyphen join")
+    });
+    static RE_ADJ_WORD_JOIN: Lazy<Regex> = Lazy::new(|| {
+        Regex::new(r"(?m)([A-Z0-9_.-])\s*\n\s*([A-Z0-9_.-])").expect("adj word join")
+    });
+    static RE_PATH_JOIN: Lazy<Regex> = Lazy::new(|| {
+        Regex::new(r"(?m)([/:~])\s*\n\s*([A-Za-z0-9._-])").expect("path join")
+    });
+    static RE_BACKSLASH_NEWLINE: Lazy<Regex> =
+        Lazy::new(|| Regex::new(r"\\\s*\n").expect("backslash newline"));
+    static RE_NEWLINES_TO_SPACE: Lazy<Regex> =
+        Lazy::new(|| Regex::new(r"\n+").expect("newline collapse"));
+    static RE_SPACES: Lazy<Regex> = Lazy::new(|| Regex::new(r"\s+").expect("space collapse"));
+
+    /// The replacement chain `flatten` replaced. Input that already contains
+    /// the placeholder text is turned into blank lines here but not there.
+    pub fn flatten_regex(text: &str, preserve_blank_lines: bool) -> (String, bool) {
+        let mut result = text.to_string();
+        if preserve_blank_lines {
+            result = RE_BLANK_PLACEHOLDER
+                .replace_all(&result, "__TRIMMEH_BLANK__PLACEHOLDER__")
+                .into_owned();
+        }
+
+        result = RE_HYPHEN_JOIN.replace_all(&result, "$1-$2").into_owned();
+        result = RE_ADJ_WORD_JOIN.replace_all(&result, "$1$2").into_owned();
+        result = RE_PATH_JOIN.replace_all(&result, "$1$2").into_owned();
+
+        let mut merged_backslash = false;
+        if RE_BACKSLASH_NEWLINE.is_match(&result) {
+            merged_backslash = true;
+            result = RE_BACKSLASH_NEWLINE.replace_all(&result, " ").into_owned();
+        }
+
+        result = RE_NEWLINES_TO_SPACE.replace_all(&result, " ").into_owned();
+        result = RE_SPACES.replace_all(&result, " ").into_owned();
+
+        if preserve_blank_lines {
+            result = result.replace("__TRIMMEH_BLANK__PLACEHOLDER__", "\n\n");
+        }
+
+        (result.trim().to_string(), merged_backslash)
+    }
+}
+
+#[cfg(test)]
+mod tests {
+    use super::*;
+    use crate::test_support::{check_vectors_and_generated, Rng};
+
+    // Every join character class, runs with one or several newlines, and
+    // non-ASCII whitespace on either side of a newline.
+    const PIECES: &[&str] = &[
+        "a", "z", "A", "Z", "0", "_", ".", "-", "--", "~", "/", ":", "\\", "|", "&", "$", "é",
+        " ", "  ", "\t", "\n", "\n\n", " \n ", "\n \n", "\u{a0}", "\u{85}", "\u{2028}",
+        "\u{3000}", "x-", "-\n", "\\\n", "/\n", "A\n", "__", "git", "echo", "PLACE",
+    ];
+
+    #[test]
+    fn flatten_matches_regex_reference() {
+        check_vectors_and_generated(Rng(0x2545_f491_4f6c_dd1d), PIECES, 20, 50_000, |text| {
+            for preserve in [false, true] {
+                assert_eq!(flatten(text, preserve), flatten_regex(text, preserve), "input {:?}", text);
+            }
+        });
+    }
+}
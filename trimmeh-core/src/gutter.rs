@@ -0,0 +1,316 @@
+//! Removal of box-drawing gutters around copied terminal output.
+//!
+//! `strip_box_drawing_characters` classifies characters through the
+//! `charclass` tables and produces exactly what the original regex chain
+//! (`strip_box_regex`) produced, with `B` standing for a box character:
+//!
+//! 1. `│ │` becomes a space;
+//! 2. when most non-empty lines start (end) with `B`, `^\s*B+ ?`
+//!    (` ?B+\s*$`) is removed from every line;
+//! 3. `\|\s*B+\s*` becomes `| `;
+//! 4. `([:/])\s*B+\s*([A-Za-z0-9])` becomes `$1$2`;
+//! 5. `(\S)\s*B+\s*(\S)` becomes `$1 $2`;
+//! 6. `\s*B+\s*` becomes a space, runs of spaces collapse, and the result is
+//!    trimmed.
+//!
+//! Whitespace and box characters are disjoint classes, so every greedy run
+//! in these patterns ends at the first character outside its class and each
+//! pattern reduces to one left-to-right walk.
+use crate::charclass::{self, ALNUM, BOX, SPACE};
+
+fn is_space(c: char) -> bool {
+    charclass::is(c, SPACE)
+}
+
+fn is_box(c: char) -> bool {
+    charclass::is(c, BOX)
+}
+
+/// End of the run of `class` characters starting at `i`.
+fn run_end(text: &str, i: usize, class: charclass::Class) -> usize {
+    text[i..]
+        .char_indices()
+        .find(|&(_, c)| !charclass::is(c, class))
+        .map_or(text.len(), |(offset, _)| i + offset)
+}
+
+/// `\s*B+\s*` at `i`: the end of the match, or `None` without box characters.
+fn gutter_end(text: &str, i: usize) -> Option<usize> {
+    let boxes = run_end(text, i, SPACE);
+    let end = run_end(text, boxes, BOX);
+    (end > boxes).then(|| run_end(text, end, SPACE))
+}
+
+pub fn strip_box_drawing_characters(text: &str) -> Option<String> {
+    if !text.chars().any(is_box) {
+        return None;
+    }
+
+    let joined;
+    let mut result = text;
+    if result.contains("│ │") {
+        joined = result.replace("│ │", " ");
+        result = &joined;
+    }
+
+    let stripped = strip_line_gutters(result);
+    let mut result = stripped.as_deref().unwrap_or(result).to_string();
+    result = join_box_after_pipe(&result);
+    result = join_box_in_path(&result);
+    result = join_box_mid_token(&result);
+    result = replace_remaining_boxes(&result);
+
+    let trimmed = result.trim();
+    if trimmed == text { None } else { Some(trimmed.to_string()) }
+}
+
+/// Step 2. Lines keep their `\n`, so a trailing gutter takes it along.
+fn strip_line_gutters(text: &str) -> Option<String> {
+    let mut non_empty = 0usize;
+    let mut leading = 0usize;
+    let mut trailing = 0usize;
+    for line in text.split_inclusive('\n') {
+        let t = line.trim();
+        if let (Some(first), Some(last)) = (t.chars().next(), t.chars().next_back()) {
+            non_empty += 1;
+            leading += usize::from(is_box(first));
+            trailing += usize::from(is_box(last));
+        }
+    }
+    let majority = non_empty / 2 + 1;
+    let strip_leading = non_empty > 0 && leading >= majority;
+    let strip_trailing = non_empty > 0 && trailing >= majority;
+    if !strip_leading && !strip_trailing {
+        return None;
+    }
+
+    let mut out = String::with_capacity(text.len());
+    for line in text.split_inclusive('\n') {
+        let mut start = 0;
+        if strip_leading {
+            let boxes = run_end(line, 0, SPACE);
+            let end = run_end(line, boxes, BOX);
+            if end > boxes {
+                start = if line[end..].starts_with(' ') { end + 1 } else { end };
+            }
+        }
+        let mut end = line.len();
+        if strip_trailing {
+            let rest = &line[start..];
+            let content = rest.trim_end_matches(is_space);
+            if content.ends_with(is_box) {
+                let boxes = content.trim_end_matches(is_box);
+                let cut = boxes.strip_suffix(' ').unwrap_or(boxes);
+                end = start + cut.len();
+            }
+        }
+        out.push_str(&line[start..end]);
+    }
+    Some(out)
+}
+
+/// Step 3.
+fn join_box_after_pipe(text: &str) -> String {
+    let mut out = String::with_capacity(text.len());
+    let mut copied = 0;
+    for (i, _) in text.match_indices('|') {
+        if i < copied {
+            continue;
+        }
+        if let Some(end) = gutter_end(text, i + 1) {
+            out.push_str(&text[copied..i]);
+            out.push_str("| ");
+            copied = end;
+        }
+    }
+    out.push_str(&text[copied..]);
+    out
+}
+
+/// Step 4.
+fn join_box_in_path(text: &str) -> String {
+    let mut out = String::with_capacity(text.len());
+    let mut copied = 0;
+    for (i, c) in text.char_indices() {
+        if i < copied || !matches!(c, ':' | '/') {
+            continue;
+        }
+        let Some(end) = gutter_end(text, i + 1) else {
+            continue;
+        };
+        if let Some(next) = text[end..].chars().next().filter(|&n| charclass::is(n, ALNUM)) {
+            out.push_str(&text[copied..=i]);
+            out.push(next);
+            copied = end + next.len_utf8();
+        }
+    }
+    out.push_str(&text[copied..]);
+    out
+}
+
+/// Step 5. Without a non-space character after the gutter the match backs
+/// off and takes the last box character as `$2`.
+fn join_box_mid_token(text: &str) -> String {
+    let mut out = String::with_capacity(text.len());
+    let mut copied = 0;
+    for (i, c) in text.char_indices() {
+        if i < copied || is_space(c) {
+            continue;
+        }
+        let after = i + c.len_utf8();
+        let boxes = run_end(text, after, SPACE);
+        let boxes_end = run_end(text, boxes, BOX);
+        if boxes_end == boxes {
+            continue;
+        }
+        let tail = run_end(text, boxes_end, SPACE);
+        let (next, end) = match text[tail..].chars().next() {
+            Some(next) => (next, tail + next.len_utf8()),
+            None => match text[boxes..boxes_end].chars().next_back() {
+                Some(last) if boxes_end - boxes > last.len_utf8() => (last, boxes_end),
+                _ => continue,
+            },
+        };
+        out.push_str(&text[copied..after]);
+        out.push(' ');
+        out.push(next);
+        copied = end;
+    }
+    out.push_str(&text[copied..]);
+    out
+}
+
+/// Step 6, minus the final trim: the remaining gutters become one space and
+/// space runs collapse.
+fn replace_remaining_boxes(text: &str) -> String {
+    let mut out = String::with_capacity(text.len());
+    let mut i = 0;
+    while let Some(c) = text[i..].chars().next() {
+        if !is_space(c) && !is_box(c) {
+            out.push(c);
+            i += c.len_utf8();
+            continue;
+        }
+        let boxes = run_end(text, i, SPACE);
+        let end = run_end(text, boxes, BOX);
+        if end > boxes {
+            push_space(&mut out);
+            i = run_end(text, end, SPACE);
+            continue;
+        }
+        // No match can start anywhere in whitespace that a box does not follow.
+        for c in text[i..boxes].chars() {
+            if c == ' ' {
+                push_space(&mut out);
+            } else {
+                out.push(c);
+            }
+        }
+        i = boxes;
+    }
+    out
+}
+
+fn push_space(out: &mut String) {
+    if !out.ends_with(' ') {
+        out.push(' ');
+    }
+}
+
+#[cfg(any(test, feature = "internals"))]
+pub use reference::strip_box_regex;
+
+#[cfg(any(test, feature = "internals"))]
+mod reference {
+    use once_cell::sync::Lazy;
+    use regex::Regex;
+
+    const BOX_CLASS: &str = "│┃╎╏┆┇┊┋╽╿￨｜";
+
+    fn box_regex(pattern: &str) -> Regex {
+        Regex::new(&pattern.replace('B', &format!("[{BOX_CLASS}]"))).expect("box regex")
+    }
+
+    static RE_BOX: Lazy<Regex> = Lazy::new(|| box_regex("B"));
+    static RE_LEADING: Lazy<Regex> = Lazy::new(|| box_regex(r"^\s*B+ ?"));
+    static RE_TRAILING: Lazy<Regex> = Lazy::new(|| box_regex(r" ?B+\s*$"));
+    static RE_AFTER_PIPE: Lazy<Regex> = Lazy::new(|| box_regex(r"\|\s*B+\s*"));
+    static RE_PATH_JOIN: Lazy<Regex> = Lazy::new(|| box_regex(r"([:/])\s*B+\s*([A-Za-z0-9])"));
+    static RE_MID_TOKEN: Lazy<Regex> = Lazy::new(|| box_regex(r"(\S)\s*B+\s*(\S)"));
+    static RE_ANYWHERE: Lazy<Regex> = Lazy::new(|| box_regex(r"\s*B+\s*"));
+    static RE_SPACES: Lazy<Regex> = Lazy::new(|| Regex::new(r" {2,}").expect("space runs"));
+
+    /// The replacement chain `strip_box_drawing_characters` replaced.
+    pub fn strip_box_regex(text: &str) -> Option<String> {
+        if RE_BOX.find(text).is_none() {
+            return None;
+        }
+
+        let mut result = text.to_string();
+        if result.contains("│ │") {
+            result = result.replace("│ │", " ");
+        }
+
+        let lines: Vec<&str> = result.split_inclusive('\n').collect();
+        let non_empty: Vec<&str> = lines
+            .iter()
+            .map(|l| l.trim())
+            .filter(|l| !l.is_empty())
+            .collect();
+
+        let mut strip_leading = false;
+        let mut strip_trailing = false;
+        if !non_empty.is_empty() {
+            let majority = non_empty.len() / 2 + 1;
+            let leading_matches = non_empty.iter().filter(|line| RE_LEADING.is_match(line)).count();
+            let trailing_matches = non_empty.iter().filter(|line| RE_TRAILING.is_match(line)).count();
+            strip_leading = leading_matches >= majority;
+            strip_trailing = trailing_matches >= majority;
+        }
+
+        if strip_leading || strip_trailing {
+            let mut rebuilt: Vec<String> = Vec::with_capacity(lines.len());
+            for line in lines.iter() {
+                let mut l = line.to_string();
+                if strip_leading {
+                    l = RE_LEADING.replace(&l, "").into_owned();
+                }
+                if strip_trailing {
+                    l = RE_TRAILING.replace(&l, "").into_owned();
+                }
+                rebuilt.push(l);
+            }
+            result = rebuilt.concat();
+        }
+
+        result = RE_AFTER_PIPE.replace_all(&result, "| ").into_owned();
+        result = RE_PATH_JOIN.replace_all(&result, "$1$2").into_owned();
+        result = RE_MID_TOKEN.replace_all(&result, "$1 $2").into_owned();
+        result = RE_ANYWHERE.replace_all(&result, " ").into_owned();
+
+        let collapsed = RE_SPACES.replace_all(&result, " ").into_owned();
+        let trimmed = collapsed.trim().to_string();
+        if trimmed == text { None } else { Some(trimmed) }
+    }
+}
+
+#[cfg(test)]
+mod tests {
+    use super::*;
+    use crate::test_support::{check_vectors_and_generated, Rng};
+
+    // Box characters next to pipes, paths, tokens, line ends, other box
+    // characters and non-ASCII whitespace.
+    const PIECES: &[&str] = &[
+        "│", "┃", "╎", "╿", "｜", "￨", "│ │", "|", ":", "/", "~", "a", "Z", "0", "-", "é", "$",
+        " ", "  ", "\t", "\n", "\n\n", "\u{a0}", "\u{85}", "\u{2028}", "\u{3000}", "│ ", " │",
+        "│\n", "\n│", "ls", "git status", "https://x", "𝔘",
+    ];
+
+    #[test]
+    fn strip_matches_regex_reference() {
+        check_vectors_and_generated(Rng(0x9e37_79b9_7f4a_7c15), PIECES, 16, 50_000, |text| {
+            assert_eq!(strip_box_drawing_characters(text), strip_box_regex(text), "input {text:?}");
+        });
+    }
+}
@@ -2,6 +2,37 @@
 use blake3::Hash;
 use once_cell::sync::Lazy;
 use regex::Regex;
+use std::borrow::Cow;
+
+mod charclass;
+mod flatten;
+mod gutter;
+mod prescan;
+mod signals;
+#[cfg(test)]
+mod test_support;
+mod trie;
+mod vocab;
+
+pub use vocab::PrefixSet;
+
+/// Building blocks exposed for benchmarks; not a stable API.
+#[cfg(feature = "internals")]
+pub mod internals {
+    pub use crate::flatten::{flatten, flatten_regex};
+    pub use crate::gutter::{strip_box_drawing_characters, strip_box_regex};
+    pub use crate::signals::{scan as command_signals, scan_regex as command_signals_regex, CommandSignals};
+
+    use crate::{Aggressiveness, Options, PrefixSet};
+
+    pub fn strip_prompt_prefixes(text: &str, extra_prefixes: &PrefixSet) -> Option<String> {
+        crate::strip_prompt_prefixes(text, extra_prefixes)
+    }
+
+    pub fn transform_if_command(text: &str, aggressiveness: Aggressiveness, opts: &Options) -> Option<(String, bool)> {
+        crate::transform_if_command(text, aggressiveness, opts)
+    }
+}
 
 #[cfg(feature = "wasm")]
 use wasm_bindgen::prelude::*;
@@ -23,6 +54,15 @@ pub struct Options {
     pub strip_box_chars: bool,
     pub trim_prompts: bool,
     pub max_lines: usize,
+    /// First-word prefixes treated as commands in addition to the built-in
+    /// list (`sudo`, `git`, `kubectl`, ...).
+    #[cfg_attr(feature = "wasm", serde(default))]
+    pub extra_prefixes: PrefixSet,
+    /// Flatten explicit continuation chains (every line but the last ends in
+    /// `\`) of any length up to `max_lines`, instead of only those of at most
+    /// 10 lines, or 5 below `Aggressiveness::High`.
+    #[cfg_attr(feature = "wasm", serde(default))]
+    pub large_snippets: bool,
 }
 
 impl Default for Options {
@@ -32,6 +72,8 @@ impl Default for Options {
             strip_box_chars: true,
             trim_prompts: true,
             max_lines: 10,
+            extra_prefixes: PrefixSet::default(),
+            large_snippets: false,
         }
     }
 }
@@ -55,49 +97,85 @@ pub struct TrimResult {
     pub hash: u128,
 }
 
+/// [`trim_borrowed`]'s result. `output` borrows the input when trimming
+/// skipped it or left it unchanged (and it had no `\r` to normalize).
+#[derive(Debug, Clone, PartialEq, Eq)]
+pub struct Trimmed<'a> {
+    pub output: Cow<'a, str>,
+    pub changed: bool,
+    pub reason: Option<TrimReason>,
+}
+
 /// Trim multiline shell snippets into a single runnable line.
 pub fn trim(input: &str, aggressiveness: Aggressiveness, opts: Options) -> TrimResult {
+    let trimmed = trim_borrowed(input, aggressiveness, &opts);
+    TrimResult {
+        output: trimmed.output.into_owned(),
+        changed: trimmed.changed,
+        reason: trimmed.reason,
+        hash: content_hash(input),
+    }
+}
+
+/// [`trim`] without the copies: the output is only allocated when a pass
+/// rewrote the text, and no hash is computed; see [`content_hash`].
+pub fn trim_borrowed<'a>(input: &'a str, aggressiveness: Aggressiveness, opts: &Options) -> Trimmed<'a> {
     // Normalize line endings for processing.
     let normalized_input = normalize_newlines(input);
-    let line_count = normalized_input.split('\n').count();
-    if line_count > opts.max_lines {
-        return TrimResult {
-            output: input.to_string(),
+    // Only the first max_lines + 1 lines are counted.
+    if normalized_input.split('\n').nth(opts.max_lines).is_some() {
+        return Trimmed {
+            output: Cow::Borrowed(input),
             changed: false,
             reason: Some(TrimReason::SkippedTooLarge),
-            hash: hash_u128(blake3::hash(input.as_bytes())),
         };
     }
 
-    let mut current = normalized_input.clone();
+    // The latest rewrite, if any pass produced one, and what it contains.
+    let mut rewritten: Option<String> = None;
+    let mut features = prescan::scan(&normalized_input);
     let mut did_prompt_strip = false;
     let mut did_box_strip = false;
     let mut did_backslash_merge = false;
 
-    if opts.strip_box_chars {
-        if let Some(cleaned) = strip_box_drawing_characters(&current) {
+    if opts.strip_box_chars && features & prescan::BOX != 0 {
+        let current = rewritten.as_deref().unwrap_or(&normalized_input);
+        if let Some(cleaned) = gutter::strip_box_drawing_characters(current) {
             did_box_strip = true;
-            current = cleaned;
+            features = prescan::scan(&cleaned);
+            rewritten = Some(cleaned);
         }
     }
 
-    if opts.trim_prompts {
-        if let Some(stripped) = strip_prompt_prefixes(&current) {
+    if opts.trim_prompts && features & prescan::PROMPT != 0 {
+        let current = rewritten.as_deref().unwrap_or(&normalized_input);
+        if let Some(stripped) = strip_prompt_prefixes(current, &opts.extra_prefixes) {
             did_prompt_strip = true;
-            current = stripped;
+            features = prescan::scan(&stripped);
+            rewritten = Some(stripped);
         }
     }
 
-    if let Some(repaired) = repair_wrapped_url(&current) {
-        current = repaired;
+    if features & prescan::URL_SCHEME != 0 {
+        let current = rewritten.as_deref().unwrap_or(&normalized_input);
+        if let Some(repaired) = repair_wrapped_url(current) {
+            features = prescan::scan(&repaired);
+            rewritten = Some(repaired);
+        }
     }
 
-    if let Some((flattened, merged_backslash)) = transform_if_command(&current, aggressiveness, &opts) {
-        did_backslash_merge = merged_backslash;
-        current = flattened;
+    if features & prescan::NEWLINE != 0 {
+        let current = rewritten.as_deref().unwrap_or(&normalized_input);
+        if let Some((flattened, merged_backslash)) = transform_if_command(current, aggressiveness, opts) {
+            did_backslash_merge = merged_backslash;
+            rewritten = Some(flattened);
+        }
     }
 
-    let changed = current != normalized_input;
+    let (output, changed) = match rewritten {
+        Some(current) if current != *normalized_input => (Cow::Owned(current), true),
+        _ => (normalized_input, false),
+    };
     let reason = if !changed {
         None
     } else if did_backslash_merge {
@@ -110,65 +188,35 @@ pub fn trim(input: &str, aggressiveness: Aggressiveness, opts: Options) -> TrimR
         Some(TrimReason::Flattened)
     };
 
-    TrimResult {
-        output: current,
-        changed,
-        reason,
-        hash: hash_u128(blake3::hash(input.as_bytes())),
-    }
+    Trimmed { output, changed, reason }
 }
 
-fn normalize_newlines(input: &str) -> String {
-    input.replace("\r\n", "\n").replace('\r', "\n")
+/// The hash [`trim`] reports: the first 128 bits of the BLAKE3 hash of the
+/// untrimmed input.
+pub fn content_hash(input: &str) -> u128 {
+    hash_u128(blake3::hash(input.as_bytes()))
 }
 
-// ---------- Trimmy-parity helpers ----------
+/// `\r\n` and lone `\r` become `\n`. Borrows when there is no `\r`.
+fn normalize_newlines(input: &str) -> Cow<'_, str> {
+    if !input.contains('\r') {
+        return Cow::Borrowed(input);
+    }
+    let mut normalized = String::with_capacity(input.len());
+    let mut rest = input;
+    while let Some(cr) = rest.find('\r') {
+        normalized.push_str(&rest[..cr]);
+        normalized.push('\n');
+        rest = &rest[cr + 1..];
+        rest = rest.strip_prefix('\n').unwrap_or(rest);
+    }
+    normalized.push_str(rest);
+    Cow::Owned(normalized)
+}
 
-static BOX_CLASS: &str = "│┃╎╏┆┇┊┋╽╿￨｜";
-static KNOWN_PREFIXES: &[&str] = &[
-    "sudo", "./", "~/", "apt", "brew", "git", "python", "pip", "pnpm", "npm", "yarn",
-    "cargo", "bundle", "rails", "go", "make", "xcodebuild", "swift", "kubectl", "docker",
-    "podman", "aws", "gcloud", "az", "ls", "cd", "cat", "echo", "env", "export", "open",
-    "node", "java", "ruby", "perl", "bash", "zsh", "fish", "pwsh", "sh",
-];
-
-static RE_BLANK_PLACEHOLDER: Lazy<Regex> =
-    Lazy::new(|| Regex::new(r"\n\s*\n").expect("blank placeholder regex"));
-static RE_HYPHEN_JOIN: Lazy<Regex> = Lazy::new(|| {
-    Regex::new(r"(?m)([A-Za-z0-9._~-])-\s*\n\s*([A-Za-z0-9._~-])").expect("hyphen join")
-});
-static RE_ADJ_WORD_JOIN: Lazy<Regex> = Lazy::new(|| {
-    Regex::new(r"(?m)([A-Z0-9_.-])\s*\n\s*([A-Z0-9_.-])").expect("adj word join")
-});
-static RE_PATH_JOIN: Lazy<Regex> = Lazy::new(|| {
-    Regex::new(r"(?m)([/:~])\s*\n\s*([A-Za-z0-9._-])").expect("path join")
-});
-static RE_BACKSLASH_NEWLINE: Lazy<Regex> =
-    Lazy::new(|| Regex::new(r"\\\s*\n").expect("backslash newline"));
-static RE_NEWLINES_TO_SPACE: Lazy<Regex> =
-    Lazy::new(|| Regex::new(r"\n+").expect("newline collapse"));
-static RE_SPACES: Lazy<Regex> = Lazy::new(|| Regex::new(r"\s+").expect("space collapse"));
-
-static RE_PIPE_OR_OP: Lazy<Regex> = Lazy::new(|| Regex::new(r"[|&]{1,2}").expect("pipe/op"));
-static RE_PROMPT_MARK: Lazy<Regex> = Lazy::new(|| Regex::new(r"(?m)(^|\n)\s*\$").expect("prompt mark"));
-static RE_SUDO_CMD: Lazy<Regex> = Lazy::new(|| {
-    Regex::new(r"(?m)^\s*(sudo\s+)?[A-Za-z0-9./~_-]+\b").expect("sudo cmd")
-});
-static RE_PATH_TOKEN: Lazy<Regex> = Lazy::new(|| {
-    Regex::new(r"[A-Za-z0-9._~-]+/[A-Za-z0-9._~-]+").expect("path token")
-});
-static RE_LIST_BULLET: Lazy<Regex> =
-    Lazy::new(|| Regex::new(r"^[-*•]\s+\S").expect("list bullet"));
-static RE_LIST_NUMBERED: Lazy<Regex> =
-    Lazy::new(|| Regex::new(r"^[0-9]+[.)]\s+\S").expect("list numbered"));
-static RE_LIST_BARETOKEN: Lazy<Regex> =
-    Lazy::new(|| Regex::new(r"^[A-Za-z0-9]{4,}$").expect("list bare"));
-static RE_SOURCE_KEYWORD: Lazy<Regex> = Lazy::new(|| {
-    Regex::new(r"(?m)^\s*(import|package|namespace|using|template|class|struct|enum|extension|protocol|interface|func|def|fn|let|var|public|private|internal|open|protected|if|for|while)\b")
-        .expect("src keyword")
-});
+// ---------- Trimmy-parity helpers ----------
 
-fn strip_prompt_prefixes(text: &str) -> Option<String> {
+fn strip_prompt_prefixes(text: &str, extra_prefixes: &PrefixSet) -> Option<String> {
     let lines: Vec<&str> = text.split('\n').collect();
     let non_empty: Vec<&str> = lines
         .iter()
@@ -183,7 +231,7 @@ fn strip_prompt_prefixes(text: &str) -> Option<String> {
     let mut rebuilt: Vec<String> = Vec::with_capacity(lines.len());
 
     for line in lines.iter() {
-        if let Some(stripped) = strip_prompt_line(line) {
+        if let Some(stripped) = strip_prompt_line(line, extra_prefixes) {
             stripped_count += 1;
             rebuilt.push(stripped);
         } else {
@@ -206,22 +254,22 @@ fn strip_prompt_prefixes(text: &str) -> Option<String> {
     }
 }
 
-fn strip_prompt_line(line: &str) -> Option<String> {
-    let leading_ws_len = line.chars().take_while(|c| c.is_whitespace()).count();
-    let (leading, remainder) = line.split_at(leading_ws_len);
+fn strip_prompt_line(line: &str, extra_prefixes: &PrefixSet) -> Option<String> {
+    let remainder = line.trim_start();
+    let leading = &line[..line.len() - remainder.len()];
     let mut chars = remainder.chars();
     let first = chars.next()?;
     if first != '#' && first != '$' {
         return None;
     }
     let after_prompt = chars.as_str().trim_start();
-    if !is_likely_prompt_command(after_prompt) {
+    if !is_likely_prompt_command(after_prompt, extra_prefixes) {
         return None;
     }
     Some(format!("{}{}", leading, after_prompt))
 }
 
-fn is_likely_prompt_command(content: &str) -> bool {
+fn is_likely_prompt_command(content: &str, extra_prefixes: &PrefixSet) -> bool {
     let trimmed = content.trim();
     if trimmed.is_empty() {
         return false;
@@ -230,83 +278,15 @@ fn is_likely_prompt_command(content: &str) -> bool {
         return false;
     }
     let has_punct = trimmed.chars().any(|c| "-./~$".contains(c)) || trimmed.chars().any(|c| c.is_ascii_digit());
-    let first_token = trimmed.split_whitespace().next().unwrap_or("").to_lowercase();
-    let starts_with_known = KNOWN_PREFIXES.iter().any(|p| first_token.starts_with(p));
-    (has_punct || starts_with_known) && is_likely_command_line(trimmed)
+    let first_token = trimmed.split_whitespace().next().unwrap_or("");
+    let starts_with_known = vocab::is_known_command_prefix(first_token, extra_prefixes);
+    (has_punct || starts_with_known) && signals::is_likely_command_line(trimmed)
 }
 
-fn strip_box_drawing_characters(text: &str) -> Option<String> {
-    let box_class_re = Regex::new(&format!("[{}]", BOX_CLASS)).expect("box class");
-    if box_class_re.find(text).is_none() {
-        return None;
-    }
-
-    let mut result = text.to_string();
-    if result.contains("│ │") {
-        result = result.replace("│ │", " ");
-    }
-
-    let lines: Vec<&str> = result.split_inclusive('\n').collect();
-    let non_empty: Vec<&str> = lines
-        .iter()
-        .map(|l| l.trim())
-        .filter(|l| !l.is_empty())
-        .collect();
-
-    let leading_pattern = Regex::new(&format!(r"^\s*[{bc}]+ ?", bc = BOX_CLASS)).expect("leading box");
-    let trailing_pattern = Regex::new(&format!(r" ?[{bc}]+\s*$", bc = BOX_CLASS)).expect("trailing box");
-
-    let mut strip_leading = false;
-    let mut strip_trailing = false;
-    if !non_empty.is_empty() {
-        let majority = non_empty.len() / 2 + 1;
-        let leading_matches = non_empty
-            .iter()
-            .filter(|line| leading_pattern.is_match(line))
-            .count();
-        let trailing_matches = non_empty
-            .iter()
-            .filter(|line| trailing_pattern.is_match(line))
-            .count();
-        strip_leading = leading_matches >= majority;
-        strip_trailing = trailing_matches >= majority;
-    }
-
-    if strip_leading || strip_trailing {
-        let mut rebuilt: Vec<String> = Vec::with_capacity(lines.len());
-        for line in lines.iter() {
-            let mut l = line.to_string();
-            if strip_leading {
-                l = leading_pattern.replace(&l, "").into_owned();
-            }
-            if strip_trailing {
-                l = trailing_pattern.replace(&l, "").into_owned();
-            }
-            rebuilt.push(l);
-        }
-        result = rebuilt.concat();
-    }
-
-    let box_after_pipe = Regex::new(&format!(r"\|\s*[{bc}]+\s*", bc = BOX_CLASS)).expect("pipe box");
-    result = box_after_pipe.replace_all(&result, "| ").into_owned();
-
-    let box_path_join = Regex::new(&format!(r"([:/])\s*[{bc}]+\s*([A-Za-z0-9])", bc = BOX_CLASS)).expect("box path");
-    result = box_path_join.replace_all(&result, "$1$2").into_owned();
-
-    let box_mid_token = Regex::new(&format!(r"(\S)\s*[{bc}]+\s*(\S)", bc = BOX_CLASS)).expect("box mid");
-    result = box_mid_token.replace_all(&result, "$1 $2").into_owned();
-
-    let box_anywhere = Regex::new(&format!(r"\s*[{bc}]+\s*", bc = BOX_CLASS)).expect("box any");
-    result = box_anywhere.replace_all(&result, " ").into_owned();
-
-    let collapsed = Regex::new(r" {2,}").unwrap().replace_all(&result, " ").into_owned();
-    let trimmed = collapsed.trim().to_string();
-    if trimmed == text {
-        None
-    } else {
-        Some(trimmed)
-    }
-}
+static RE_SPACES: Lazy<Regex> = Lazy::new(|| Regex::new(r"\s+").expect("spaces"));
+static RE_VALID_URL: Lazy<Regex> = Lazy::new(|| {
+    Regex::new(r"^https?://[A-Za-z0-9._~:/?#\[\]@!$&'()*+,;=%-]+$").expect("valid url")
+});
 
 fn repair_wrapped_url(text: &str) -> Option<String> {
     let trimmed = text.trim();
@@ -318,12 +298,11 @@ fn repair_wrapped_url(text: &str) -> Option<String> {
     if !(lower.starts_with("http://") || lower.starts_with("https://")) {
         return None;
     }
-    let collapsed = Regex::new(r"\s+").unwrap().replace_all(trimmed, "").into_owned();
+    let collapsed = RE_SPACES.replace_all(trimmed, "").into_owned();
     if collapsed == trimmed {
         return None;
     }
-    let valid_url_re = Regex::new(r"^https?://[A-Za-z0-9._~:/?#\[\]@!$&'()*+,;=%-]+$").unwrap();
-    if valid_url_re.is_match(&collapsed) {
+    if RE_VALID_URL.is_match(&collapsed) {
         Some(collapsed)
     } else {
         None
@@ -335,84 +314,57 @@ fn transform_if_command(
     aggressiveness: Aggressiveness,
     opts: &Options,
 ) -> Option<(String, bool)> {
-    if !text.contains('\n') {
-        return None;
-    }
-
-    let lines: Vec<&str> = text.split('\n').collect();
-    if lines.len() < 2 {
+    let newline_count = text.bytes().filter(|&b| b == b'\n').count();
+    if newline_count == 0 {
         return None;
     }
-    if lines.len() > 10 {
+    let uncapped = opts.large_snippets && is_continuation_chain(text);
+    if !uncapped && newline_count + 1 > 10 {
         return None;
     }
-    let newline_count = text.matches('\n').count();
     let aggr_override_high = matches!(aggressiveness, Aggressiveness::High);
-    if !aggr_override_high && newline_count > 4 {
+    if !uncapped && !aggr_override_high && newline_count > 4 {
         return None;
     }
 
-    let non_empty: Vec<&str> = lines
-        .iter()
-        .copied()
-        .filter(|l| !l.trim().is_empty())
-        .collect();
+    let signals = signals::scan(text, &opts.extra_prefixes);
 
-    if !aggr_override_high && is_likely_list(&non_empty) {
+    if !aggr_override_high && signals.is_likely_list() {
         return None;
     }
 
-    let has_line_continuation = text.contains("\\\n");
-    let has_line_joiner_at_eol = Regex::new(r"(?m)(\\|[|&]{1,2}|;)\s*$").unwrap().is_match(text);
-    let has_indented_pipeline = Regex::new(r"(?m)^\s*[|&]{1,2}\s+\S").unwrap().is_match(text);
-    let has_explicit_join = has_line_continuation || has_line_joiner_at_eol || has_indented_pipeline;
-
-    let cmd_line_count = command_line_count(&non_empty);
     if !aggr_override_high
-        && !has_explicit_join
-        && cmd_line_count == non_empty.len()
-        && non_empty.len() >= 3
+        && !signals.has_explicit_join()
+        && signals.all_command_lines()
+        && signals.non_empty >= 3
     {
         return None;
     }
 
-    let strong_signals = has_line_continuation
-        || RE_PIPE_OR_OP.is_match(text)
-        || RE_PROMPT_MARK.is_match(text)
-        || RE_PATH_TOKEN.is_match(text);
-
-    let has_known_prefix = contains_known_command_prefix(&non_empty);
+    let strong_signals = signals.has_strong_signals();
     if !aggr_override_high
         && !strong_signals
-        && !has_known_prefix
-        && !has_command_punctuation(text)
+        && !signals.known_prefix
+        && !signals.command_punctuation
     {
         return None;
     }
 
-    if !aggr_override_high && is_likely_source_code(text) && !strong_signals {
+    if !aggr_override_high && signals.is_likely_source_code() && !strong_signals {
         return None;
     }
 
-    let mut score = 0;
-    if has_line_continuation {
-        score += 1;
-    }
-    if RE_PIPE_OR_OP.is_match(text) {
-        score += 1;
-    }
-    if RE_PROMPT_MARK.is_match(text) {
-        score += 1;
-    }
-    if non_empty.iter().all(|l| is_likely_command_line(l)) {
-        score += 1;
-    }
-    if RE_SUDO_CMD.is_match(text) {
-        score += 1;
-    }
-    if RE_PATH_TOKEN.is_match(text) {
-        score += 1;
-    }
+    let score = [
+        signals.line_continuation,
+        signals.pipe_or_op,
+        signals.prompt_mark,
+        signals.all_command_lines(),
+        signals.sudo_command,
+        signals.path_token,
+    ]
+    .iter()
+    .filter(|&&hit| hit)
+    .count();
 
     let threshold = match aggressiveness {
         Aggressiveness::Low => 3,
@@ -423,7 +375,7 @@ fn transform_if_command(
         return None;
     }
 
-    let (flattened, merged_backslash) = flatten(text, opts.keep_blank_lines);
+    let (flattened, merged_backslash) = flatten::flatten(text, opts.keep_blank_lines);
     if flattened == text {
         None
     } else {
@@ -431,105 +383,12 @@ fn transform_if_command(
     }
 }
 
-fn is_likely_command_line(line: &str) -> bool {
-    let trimmed = line.trim();
-    if trimmed.is_empty() {
-        return false;
-    }
-    if trimmed.starts_with("[[") {
-        return true;
-    }
-    if trimmed.ends_with('.') {
-        return false;
-    }
-    let re = Regex::new(r"^(sudo\s+)?[A-Za-z0-9./~_-]+(?:\s+|\z)").unwrap();
-    re.is_match(trimmed)
-}
-
-fn contains_known_command_prefix(lines: &[&str]) -> bool {
-    lines.iter().any(|line| {
-        let trimmed = line.trim();
-        if trimmed.is_empty() {
-            return false;
-        }
-        if let Some(first) = trimmed.split_whitespace().next() {
-            let lower = first.to_lowercase();
-            return KNOWN_PREFIXES.iter().any(|p| lower.starts_with(p));
-        }
-        false
-    })
-}
-
-fn has_command_punctuation(text: &str) -> bool {
-    Regex::new(r"[./~_=:-]").unwrap().is_match(text)
-}
-
-fn is_likely_list(lines: &[&str]) -> bool {
-    if lines.is_empty() {
-        return false;
-    }
-    let listish = lines.iter().filter(|line| {
-        let trimmed = line.trim();
-        if trimmed.is_empty() {
-            return false;
-        }
-        let has_spaces = trimmed.chars().any(|c| c.is_whitespace());
-        if RE_LIST_BULLET.is_match(trimmed) {
-            return true;
-        }
-        if RE_LIST_NUMBERED.is_match(trimmed) {
-            return true;
-        }
-        if !has_spaces
-            && RE_LIST_BARETOKEN.is_match(trimmed)
-            && !trimmed.contains('.')
-            && !trimmed.contains('/')
-            && !trimmed.contains('$')
-        {
-            return true;
-        }
-        false
-    }).count();
-
-    listish >= (lines.len() / 2 + 1)
-}
-
-fn is_likely_source_code(text: &str) -> bool {
-    let has_braces = text.contains('{') || text.contains('}') || text.to_lowercase().contains("begin");
-    let has_keywords = RE_SOURCE_KEYWORD.is_match(text);
-    has_braces && has_keywords
-}
-
-fn command_line_count(lines: &[&str]) -> usize {
-    lines.iter().filter(|l| is_likely_command_line(l)).count()
-}
-
-fn flatten(text: &str, preserve_blank_lines: bool) -> (String, bool) {
-    let mut result = text.to_string();
-    if preserve_blank_lines {
-        result = RE_BLANK_PLACEHOLDER
-            .replace_all(&result, "__TRIMMEH_BLANK__PLACEHOLDER__")
-            .into_owned();
-    }
-
-    result = RE_HYPHEN_JOIN.replace_all(&result, "$1-$2").into_owned();
-    result = RE_ADJ_WORD_JOIN.replace_all(&result, "$1$2").into_owned();
-    result = RE_PATH_JOIN.replace_all(&result, "$1$2").into_owned();
-
-    let mut merged_backslash = false;
-    if RE_BACKSLASH_NEWLINE.is_match(&result) {
-        merged_backslash = true;
-        result = RE_BACKSLASH_NEWLINE.replace_all(&result, " ").into_owned();
-    }
-
-    result = RE_NEWLINES_TO_SPACE.replace_all(&result, " ").into_owned();
-    result = RE_SPACES.replace_all(&result, " ").into_owned();
-
-    if preserve_blank_lines {
-        result = result.replace("__TRIMMEH_BLANK__PLACEHOLDER__", "\n\n");
-    }
-
-    (result.trim().to_string(), merged_backslash)
+/// Every line but the last ends in `\` before any trailing whitespace, so
+/// `flatten` merges each line break as a continuation.
+fn is_continuation_chain(text: &str) -> bool {
+    let mut lines = text.split('\n');
+    lines.next_back();
+    lines.all(|line| line.trim_end().ends_with('\\'))
 }
 
 fn hash_u128(hash: Hash) -> u128 {
@@ -548,7 +407,7 @@ pub fn trim_js(input: &str, aggressiveness: u8, opts: JsValue) -> JsValue {
     };
     let opts: Options =
         serde_wasm_bindgen::from_value(opts).unwrap_or_else(|_| Options::default());
-    let result = trim(input, aggr, opts);
+    let result = trim_borrowed(input, aggr, &opts);
 
     #[derive(Serialize)]
     struct WasmResult<'a> {
@@ -562,7 +421,7 @@ pub fn trim_js(input: &str, aggressiveness: u8, opts: JsValue) -> JsValue {
         output: &result.output,
         changed: result.changed,
         reason: result.reason,
-        hash_hex: format!("{:032x}", result.hash),
+        hash_hex: format!("{:032x}", content_hash(input)),
     };
 
     serde_wasm_bindgen::to_value(&wasm_result).unwrap()
@@ -618,6 +477,67 @@ mod tests {
         assert_eq!(res.reason, Some(TrimReason::SkippedTooLarge));
     }
 
+    #[test]
+    fn large_snippets_lift_the_command_caps() {
+        let mut input = String::from("docker run --rm \\\n");
+        for i in 0..40 {
+            input.push_str(&format!("  -e VAR_{i}=value \\\n"));
+        }
+        input.push_str("  nginx:latest");
+        let opts = Options { max_lines: 100, ..Default::default() };
+        assert!(!trim(&input, Aggressiveness::High, opts.clone()).changed);
+
+        let large = Options { large_snippets: true, ..opts };
+        let res = trim(&input, Aggressiveness::Normal, large.clone());
+        assert!(res.output.starts_with("docker run --rm -e VAR_0=value -e VAR_1=value "));
+        assert!(res.output.ends_with(" -e VAR_39=value nginx:latest"));
+        assert_eq!(res.reason, Some(TrimReason::BackslashMerged));
+
+        // A line without a continuation keeps the caps.
+        let broken = input.replacen("VAR_7=value \\\n", "VAR_7=value\n", 1);
+        assert!(!trim(&broken, Aggressiveness::High, large).changed);
+    }
+
+    #[test]
+    fn borrowed_trim_allocates_only_rewrites() {
+        let opts = Options::default();
+        let flat = "echo hi";
+        let res = trim_borrowed(flat, Aggressiveness::Normal, &opts);
+        assert!(matches!(res.output, Cow::Borrowed(out) if std::ptr::eq(out, flat)));
+        assert!(!res.changed);
+
+        let blob = "line\n".repeat(20);
+        let res = trim_borrowed(&blob, Aggressiveness::Normal, &opts);
+        assert!(matches!(res.output, Cow::Borrowed(out) if std::ptr::eq(out, blob.as_str())));
+        assert_eq!(res.reason, Some(TrimReason::SkippedTooLarge));
+
+        let res = trim_borrowed("- apples\r\n- pears", Aggressiveness::Normal, &opts);
+        assert_eq!(res.output, "- apples\n- pears");
+        assert!(!res.changed);
+
+        let res = trim_borrowed("echo one \\\n  --two", Aggressiveness::Normal, &opts);
+        assert!(matches!(res.output, Cow::Owned(_)));
+        assert_eq!(res.output, "echo one --two");
+    }
+
+    #[test]
+    fn newlines_normalize_like_replace() {
+        for input in ["a\r\nb", "a\rb", "\r\r\n\n\r", "a\r", "\ra\r\n", "é\r\nü"] {
+            assert_eq!(normalize_newlines(input), input.replace("\r\n", "\n").replace('\r', "\n"), "{input:?}");
+        }
+    }
+
+    #[test]
+    fn prompt_after_unicode_indent() {
+        // The indent was measured in chars and split at as bytes, which
+        // panicked inside the two-byte U+00A0.
+        let res = trim("\u{a0}$ ls -la /tmp", Aggressiveness::Normal, Options::default());
+        assert_eq!(res.output, "\u{a0}ls -la /tmp");
+        assert_eq!(res.reason, Some(TrimReason::PromptStripped));
+        let res = trim("\u{3000}\u{a0}# apt update", Aggressiveness::Normal, Options::default());
+        assert_eq!(res.output, "\u{3000}\u{a0}apt update");
+    }
+
     #[test]
     fn blank_lines_preserved() {
         let input = "echo first\necho second\n\necho third";
@@ -666,6 +586,21 @@ mod tests {
         assert!(!res.changed);
     }
 
+    #[test]
+    fn extra_prefixes_mark_commands() {
+        let input = "helmfile apply\n  production";
+        let res = trim(input, Aggressiveness::Normal, Options::default());
+        assert!(!res.changed);
+
+        let opts = Options {
+            extra_prefixes: PrefixSet::new(["helmfile"]),
+            ..Options::default()
+        };
+        let res = trim(input, Aggressiveness::Normal, opts);
+        assert_eq!(res.output, "helmfile apply production");
+        assert_eq!(res.reason, Some(TrimReason::Flattened));
+    }
+
     #[test]
     fn vectors_match_expected() {
         #[derive(Debug, Deserialize)]
@@ -684,6 +619,8 @@ mod tests {
             strip_box_chars: Option<bool>,
             trim_prompts: Option<bool>,
             max_lines: Option<usize>,
+            extra_prefixes: Option<Vec<String>>,
+            large_snippets: Option<bool>,
         }
 
         #[derive(Debug, Deserialize)]
@@ -713,10 +650,7 @@ mod tests {
             }
         }
 
-        let json = include_str!("../../tests/trim-vectors.json");
-        let vectors: Vec<Vector> = serde_json::from_str(json).expect("parse trim vectors");
-
-        for v in vectors {
+        fn check_vector(v: Vector) {
             let mut opts = Options::default();
             if let Some(o) = v.options {
                 if let Some(val) = o.keep_blank_lines {
@@ -731,9 +665,18 @@ mod tests {
                 if let Some(val) = o.max_lines {
                     opts.max_lines = val;
                 }
+                if let Some(val) = o.extra_prefixes {
+                    opts.extra_prefixes = PrefixSet::new(val);
+                }
+                if let Some(val) = o.large_snippets {
+                    opts.large_snippets = val;
+                }
             }
 
+            let borrowed = trim_borrowed(&v.input, parse_aggr(&v.aggressiveness), &opts);
             let res = trim(&v.input, parse_aggr(&v.aggressiveness), opts);
+            assert_eq!(borrowed.output, res.output, "vector {} borrowed output", v.name);
+            assert_eq!(borrowed.reason, res.reason, "vector {} borrowed reason", v.name);
             assert_eq!(res.output, v.expected.output, "vector {} output", v.name);
             assert_eq!(res.changed, v.expected.changed, "vector {} changed", v.name);
 
@@ -746,5 +689,39 @@ mod tests {
                 );
             }
         }
+
+        // TRIMMEH_VECTORS points at an external corpus: either a JSON array
+        // like tests/trim-vectors.json or JSON Lines (one case per line),
+        // which is streamed so large corpora are never held in memory.
+        let Some(path) = std::env::var_os("TRIMMEH_VECTORS") else {
+            let json = include_str!("../../tests/trim-vectors.json");
+            let vectors: Vec<Vector> = serde_json::from_str(json).expect("parse trim vectors");
+            vectors.into_iter().for_each(check_vector);
+            return;
+        };
+
+        use std::io::BufRead;
+        let file = std::fs::File::open(&path).unwrap_or_else(|e| panic!("open {path:?}: {e}"));
+        let mut reader = std::io::BufReader::new(file);
+        let is_array = reader
+            .fill_buf()
+            .expect("read vectors")
+            .iter()
+            .find(|b| !b.is_ascii_whitespace())
+            == Some(&b'[');
+        if is_array {
+            let vectors: Vec<Vector> = serde_json::from_reader(reader).expect("parse trim vectors");
+            vectors.into_iter().for_each(check_vector);
+            return;
+        }
+        for (index, line) in reader.lines().enumerate() {
+            let line = line.expect("read vectors");
+            if line.trim().is_empty() {
+                continue;
+            }
+            let v: Vector = serde_json::from_str(&line)
+                .unwrap_or_else(|e| panic!("{path:?} line {}: {e}", index + 1));
+            check_vector(v);
+        }
     }
 }
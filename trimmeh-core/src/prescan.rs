@@ -0,0 +1,117 @@
+//! One pass deciding which of `trim`'s rewriting passes can apply.
+//!
+//! Each pass after the line cap first needs the text to contain something:
+//! a box character, a `$` or `#` a prompt starts with, an `http://` or
+//! `https://` scheme, a line break. `scan` looks for all of them with one
+//! Aho-Corasick automaton and returns a bitmask; a pass whose bit is clear
+//! would leave the text unchanged and is skipped, so a plain single line is
+//! read once before `trim` returns it.
+use aho_corasick::AhoCorasick;
+use once_cell::sync::Lazy;
+
+use crate::charclass::BOX_CHARS;
+
+pub(crate) type Features = u8;
+
+/// A box-drawing gutter character.
+pub(crate) const BOX: Features = 1 << 0;
+/// `$` or `#`.
+pub(crate) const PROMPT: Features = 1 << 1;
+/// `http://` or `https://` in any ASCII case, as the URL repair lowercases.
+pub(crate) const URL_SCHEME: Features = 1 << 2;
+/// `\n`.
+pub(crate) const NEWLINE: Features = 1 << 3;
+
+const ALL: Features = BOX | PROMPT | URL_SCHEME | NEWLINE;
+
+struct Automaton {
+    searcher: AhoCorasick,
+    // The feature of each pattern, by pattern index.
+    features: Vec<Features>,
+}
+
+// No pattern occurs inside another, so non-overlapping matches still report
+// every occurrence of each.
+static AUTOMATON: Lazy<Automaton> = Lazy::new(|| {
+    let mut patterns = vec![
+        ("\n".to_string(), NEWLINE),
+        ("$".to_string(), PROMPT),
+        ("#".to_string(), PROMPT),
+        ("http://".to_string(), URL_SCHEME),
+        ("https://".to_string(), URL_SCHEME),
+    ];
+    patterns.extend(BOX_CHARS.iter().map(|c| (c.to_string(), BOX)));
+    let searcher = AhoCorasick::builder()
+        .ascii_case_insensitive(true)
+        .build(patterns.iter().map(|(pattern, _)| pattern))
+        .expect("prescan patterns");
+    Automaton {
+        searcher,
+        features: patterns.iter().map(|&(_, feature)| feature).collect(),
+    }
+});
+
+pub(crate) fn scan(text: &str) -> Features {
+    let automaton = &*AUTOMATON;
+    let mut features = 0;
+    for found in automaton.searcher.find_iter(text) {
+        features |= automaton.features[found.pattern().as_usize()];
+        if features == ALL {
+            break;
+        }
+    }
+    features
+}
+
+#[cfg(test)]
+mod tests {
+    use super::*;
+    use crate::test_support::Rng;
+    use crate::{gutter, Aggressiveness, Options, PrefixSet};
+
+    const PIECES: &[&str] = &[
+        "a", "/", ":", "$", "#", "$ ", "# ", " ", "\t", "\n", "\u{a0}", "│", "┃", "｜", "|", "\\",
+        "http", "HTTPS", "://", "http://", "hTTp://", "https://x", ".com", "sudo ", "git ",
+        "echo hi", "ls -la", "- item", "K", "\u{212a}", "İ",
+    ];
+
+    #[test]
+    fn features_match_contains() {
+        let mut rng = Rng(0x9e37_79b9_7f4a_7c15);
+        for _ in 0..20_000 {
+            let text = rng.text(PIECES, 16);
+            let lower = text.to_ascii_lowercase();
+            let mut expected = 0;
+            if text.contains(BOX_CHARS) {
+                expected |= BOX;
+            }
+            if text.contains(['$', '#']) {
+                expected |= PROMPT;
+            }
+            if lower.contains("http://") || lower.contains("https://") {
+                expected |= URL_SCHEME;
+            }
+            if text.contains('\n') {
+                expected |= NEWLINE;
+            }
+            let features = scan(&text);
+            assert_eq!(features, expected, "{text:?}");
+
+            // A clear bit means the pass it gates would not have changed the text.
+            if features & BOX == 0 {
+                assert_eq!(gutter::strip_box_drawing_characters(&text), None, "{text:?}");
+            }
+            if features & PROMPT == 0 {
+                assert_eq!(crate::strip_prompt_prefixes(&text, &PrefixSet::default()), None, "{text:?}");
+            }
+            if features & URL_SCHEME == 0 {
+                assert_eq!(crate::repair_wrapped_url(&text), None, "{text:?}");
+            }
+            if features & NEWLINE == 0 {
+                for aggr in [Aggressiveness::Low, Aggressiveness::Normal, Aggressiveness::High] {
+                    assert_eq!(crate::transform_if_command(&text, aggr, &Options::default()), None, "{text:?}");
+                }
+            }
+        }
+    }
+}
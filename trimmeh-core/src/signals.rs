@@ -0,0 +1,353 @@
+//! Single-pass scoring signals for `transform_if_command`.
+//!
+//! `scan` walks the text once and reports everything the command heuristics
+//! need. It replaces a dozen regex scans over the same text. `scan_regex` keeps
+//! the original regex formulation as the reference that the scanner is tested
+//! and benchmarked against.
+use regex_syntax::is_word_character;
+
+use crate::charclass::{self, byte_is, ALNUM, PATH, PUNCT, SPACE, TOKEN, WORD};
+use crate::vocab::{self, PrefixSet};
+
+/// Everything `transform_if_command` scores, gathered in one pass.
+#[derive(Debug, Clone, Copy, Default, PartialEq, Eq)]
+pub struct CommandSignals {
+    /// Lines split on `\n`, including empty ones.
+    pub lines: usize,
+    /// Lines with any non-whitespace.
+    pub non_empty: usize,
+    /// Non-empty lines that look like bullets, numbered items or bare tokens.
+    pub listish: usize,
+    /// Non-empty lines that start like a shell command.
+    pub command_lines: usize,
+    /// A backslash right before a newline.
+    pub line_continuation: bool,
+    /// A line ending in `\`, `|`, `&` or `;`, ignoring trailing whitespace.
+    pub joiner_at_eol: bool,
+    /// A line starting with `|`, `||`, `&` or `&&` followed by more text.
+    pub indented_pipeline: bool,
+    pub pipe_or_op: bool,
+    /// A line starting with `$`.
+    pub prompt_mark: bool,
+    /// A line starting with a command-like token (optionally after `sudo`).
+    pub sudo_command: bool,
+    /// `a/b` style path somewhere in the text.
+    pub path_token: bool,
+    /// A line whose first word starts with a built-in or extra command prefix.
+    pub known_prefix: bool,
+    pub command_punctuation: bool,
+    /// A line starting with a source keyword (`import`, `fn`, `class`, ...).
+    pub source_keyword: bool,
+    /// `{`, `}` or `begin` (any case) somewhere in the text.
+    pub braces_or_begin: bool,
+}
+
+impl CommandSignals {
+    pub fn is_likely_list(&self) -> bool {
+        self.non_empty > 0 && self.listish >= self.non_empty / 2 + 1
+    }
+
+    pub fn has_explicit_join(&self) -> bool {
+        self.line_continuation || self.joiner_at_eol || self.indented_pipeline
+    }
+
+    pub fn has_strong_signals(&self) -> bool {
+        self.line_continuation || self.pipe_or_op || self.prompt_mark || self.path_token
+    }
+
+    /// True for zero non-empty lines, matching `Iterator::all`.
+    pub fn all_command_lines(&self) -> bool {
+        self.command_lines == self.non_empty
+    }
+
+    pub fn is_likely_source_code(&self) -> bool {
+        self.braces_or_begin && self.source_keyword
+    }
+}
+
+pub fn scan(text: &str, extra_prefixes: &PrefixSet) -> CommandSignals {
+    let mut signals = CommandSignals::default();
+    let mut pending_pipeline = false;
+    let mut begin_matched = 0usize;
+    let mut slash_after_path = false;
+    let mut prev_is_path = false;
+    let mut line_start = 0usize;
+
+    for (i, &b) in text.as_bytes().iter().enumerate() {
+        match b {
+            b'\n' => {
+                let line = &text[line_start..i];
+                if line.ends_with('\\') {
+                    signals.line_continuation = true;
+                }
+                scan_line(line, extra_prefixes, &mut signals, &mut pending_pipeline);
+                line_start = i + 1;
+            }
+            b'|' | b'&' => signals.pipe_or_op = true,
+            b'{' | b'}' => signals.braces_or_begin = true,
+            _ if byte_is(b, PUNCT) => signals.command_punctuation = true,
+            _ => {}
+        }
+
+        let lower = b | 0x20;
+        if begin_matched > 0 || lower == b'b' {
+            begin_matched = if lower == b"begin"[begin_matched] {
+                begin_matched + 1
+            } else {
+                usize::from(lower == b'b')
+            };
+            if begin_matched == 5 {
+                signals.braces_or_begin = true;
+                begin_matched = 0;
+            }
+        }
+
+        // Multi-byte UTF-8 sequences never contain ASCII bytes, so byte-wise
+        // adjacency is exact for this ASCII-only pattern.
+        let is_path = byte_is(b, PATH);
+        if slash_after_path && is_path {
+            signals.path_token = true;
+        }
+        slash_after_path = b == b'/' && prev_is_path;
+        prev_is_path = is_path;
+    }
+    scan_line(&text[line_start..], extra_prefixes, &mut signals, &mut pending_pipeline);
+    signals
+}
+
+fn scan_line(
+    line: &str,
+    extra_prefixes: &PrefixSet,
+    signals: &mut CommandSignals,
+    pending_pipeline: &mut bool,
+) {
+    signals.lines += 1;
+    let t = line.trim();
+    if t.is_empty() {
+        return;
+    }
+    signals.non_empty += 1;
+    // `^\s*[|&]{1,2}\s+\S` may find its `\S` on a later line.
+    if *pending_pipeline {
+        signals.indented_pipeline = true;
+        *pending_pipeline = false;
+    }
+
+    let bytes = t.as_bytes();
+    let first = bytes[0];
+    if first == b'$' {
+        signals.prompt_mark = true;
+    }
+
+    let ops = bytes.iter().take_while(|b| matches!(b, b'|' | b'&')).count();
+    if ops == 1 || ops == 2 {
+        match t[ops..].chars().next() {
+            Some(c) if charclass::is(c, SPACE) => signals.indented_pipeline = true,
+            Some(_) => {}
+            None => *pending_pipeline = true,
+        }
+    }
+
+    if matches!(bytes[bytes.len() - 1], b'\\' | b'|' | b'&' | b';') {
+        signals.joiner_at_eol = true;
+    }
+
+    let run = bytes.iter().take_while(|b| byte_is(**b, TOKEN)).count();
+    if run > 0 {
+        signals.sudo_command |= token_has_word_boundary(&bytes[..run], t[run..].chars().next());
+    }
+    if is_command_line_trimmed(t, run) {
+        signals.command_lines += 1;
+    }
+    if is_listish(t) {
+        signals.listish += 1;
+    }
+    if !signals.known_prefix {
+        let first_word = t.split(|c| charclass::is(c, SPACE)).next().unwrap_or("");
+        signals.known_prefix = vocab::is_known_command_prefix(first_word, extra_prefixes);
+    }
+    if !signals.source_keyword {
+        signals.source_keyword = vocab::starts_with_source_keyword(t);
+    }
+}
+
+/// `[A-Za-z0-9./~_-]+\b`: some prefix of the token run ends on a word
+/// boundary. `after` is the character following the run, if any.
+fn token_has_word_boundary(run: &[u8], after: Option<char>) -> bool {
+    let has_word = run.iter().any(|b| byte_is(*b, WORD));
+    let has_other = run.iter().any(|b| !byte_is(*b, WORD));
+    let after_is_word = after.is_some_and(is_word_character);
+    match (has_word, has_other) {
+        (true, true) => true,
+        (true, false) => !after_is_word,
+        _ => after_is_word,
+    }
+}
+
+fn is_listish(t: &str) -> bool {
+    let mut chars = t.chars();
+    let first = chars.next();
+    if matches!(first, Some('-' | '*' | '•')) && chars.next().is_some_and(|c| charclass::is(c, SPACE)) {
+        return true;
+    }
+
+    let bytes = t.as_bytes();
+    let digits = bytes.iter().take_while(|b| b.is_ascii_digit()).count();
+    if digits > 0
+        && matches!(bytes.get(digits), Some(b'.' | b')'))
+        && t[digits + 1..].chars().next().is_some_and(|c| charclass::is(c, SPACE))
+    {
+        return true;
+    }
+
+    bytes.len() >= 4 && bytes.iter().all(|b| byte_is(*b, ALNUM))
+}
+
+fn is_command_line_trimmed(t: &str, run: usize) -> bool {
+    if t.starts_with("[[") {
+        return true;
+    }
+    if t.ends_with('.') {
+        return false;
+    }
+    run > 0 && (run == t.len() || t[run..].chars().next().is_some_and(|c| charclass::is(c, SPACE)))
+}
+
+pub(crate) fn is_likely_command_line(line: &str) -> bool {
+    let t = line.trim();
+    let run = t.bytes().take_while(|b| byte_is(*b, TOKEN)).count();
+    !t.is_empty() && is_command_line_trimmed(t, run)
+}
+
+#[cfg(any(test, feature = "internals"))]
+pub use reference::scan_regex;
+
+#[cfg(any(test, feature = "internals"))]
+mod reference {
+    use super::CommandSignals;
+    use crate::vocab::KNOWN_PREFIXES;
+    use once_cell::sync::Lazy;
+    use regex::Regex;
+
+    static RE_JOINER_AT_EOL: Lazy<Regex> =
+        Lazy::new(|| Regex::new(r"(?m)(\\|[|&]{1,2}|;)\s*$").expect("joiner at eol"));
+    static RE_INDENTED_PIPELINE: Lazy<Regex> =
+        Lazy::new(|| Regex::new(r"(?m)^\s*[|&]{1,2}\s+\S").expect("indented pipeline"));
+    static RE_PIPE_OR_OP: Lazy<Regex> = Lazy::new(|| Regex::new(r"[|&]{1,2}").expect("pipe/op"));
+    static RE_PROMPT_MARK: Lazy<Regex> = Lazy::new(|| Regex::new(r"(?m)(^|\n)\s*\$").expect("prompt mark"));
+    static RE_SUDO_CMD: Lazy<Regex> = Lazy::new(|| {
+        Regex::new(r"(?m)^\s*(sudo\s+)?[A-Za-z0-9./~_-]+\b").expect("sudo cmd")
+    });
+    static RE_PATH_TOKEN: Lazy<Regex> = Lazy::new(|| {
+        Regex::new(r"[A-Za-z0-9._~-]+/[A-Za-z0-9._~-]+").expect("path token")
+    });
+    static RE_LIST_BULLET: Lazy<Regex> =
+        Lazy::new(|| Regex::new(r"^[-*•]\s+\S").expect("list bullet"));
+    static RE_LIST_NUMBERED: Lazy<Regex> =
+        Lazy::new(|| Regex::new(r"^[0-9]+[.)]\s+\S").expect("list numbered"));
+    static RE_LIST_BARETOKEN: Lazy<Regex> =
+        Lazy::new(|| Regex::new(r"^[A-Za-z0-9]{4,}$").expect("list bare"));
+    static RE_SOURCE_KEYWORD: Lazy<Regex> = Lazy::new(|| {
+        Regex::new(r"(?m)^\s*(import|package|namespace|using|template|class|struct|enum|extension|protocol|interface|func|def|fn|let|var|public|private|internal|open|protected|if|for|while)\b")
+            .expect("src keyword")
+    });
+    static RE_COMMAND_LINE: Lazy<Regex> =
+        Lazy::new(|| Regex::new(r"^(sudo\s+)?[A-Za-z0-9./~_-]+(?:\s+|\z)").expect("command line"));
+    static RE_COMMAND_PUNCTUATION: Lazy<Regex> =
+        Lazy::new(|| Regex::new(r"[./~_=:-]").expect("command punctuation"));
+
+    /// The regex formulation `scan` replaced, one scan per signal.
+    pub fn scan_regex(text: &str) -> CommandSignals {
+        let lines: Vec<&str> = text.split('\n').collect();
+        let non_empty: Vec<&str> = lines
+            .iter()
+            .copied()
+            .filter(|l| !l.trim().is_empty())
+            .collect();
+
+        CommandSignals {
+            lines: lines.len(),
+            non_empty: non_empty.len(),
+            listish: non_empty.iter().filter(|l| is_listish(l)).count(),
+            command_lines: non_empty.iter().filter(|l| is_likely_command_line(l)).count(),
+            line_continuation: text.contains("\\\n"),
+            joiner_at_eol: RE_JOINER_AT_EOL.is_match(text),
+            indented_pipeline: RE_INDENTED_PIPELINE.is_match(text),
+            pipe_or_op: RE_PIPE_OR_OP.is_match(text),
+            prompt_mark: RE_PROMPT_MARK.is_match(text),
+            sudo_command: RE_SUDO_CMD.is_match(text),
+            path_token: RE_PATH_TOKEN.is_match(text),
+            known_prefix: contains_known_command_prefix(&non_empty),
+            command_punctuation: RE_COMMAND_PUNCTUATION.is_match(text),
+            source_keyword: RE_SOURCE_KEYWORD.is_match(text),
+            braces_or_begin: text.contains('{')
+                || text.contains('}')
+                || text.to_lowercase().contains("begin"),
+        }
+    }
+
+    fn is_likely_command_line(line: &str) -> bool {
+        let trimmed = line.trim();
+        if trimmed.is_empty() {
+            return false;
+        }
+        if trimmed.starts_with("[[") {
+            return true;
+        }
+        if trimmed.ends_with('.') {
+            return false;
+        }
+        RE_COMMAND_LINE.is_match(trimmed)
+    }
+
+    fn contains_known_command_prefix(lines: &[&str]) -> bool {
+        lines.iter().any(|line| {
+            let trimmed = line.trim();
+            if let Some(first) = trimmed.split_whitespace().next() {
+                let lower = first.to_lowercase();
+                return KNOWN_PREFIXES.iter().any(|p| lower.starts_with(p));
+            }
+            false
+        })
+    }
+
+    fn is_listish(line: &str) -> bool {
+        let trimmed = line.trim();
+        if trimmed.is_empty() {
+            return false;
+        }
+        let has_spaces = trimmed.chars().any(|c| c.is_whitespace());
+        RE_LIST_BULLET.is_match(trimmed)
+            || RE_LIST_NUMBERED.is_match(trimmed)
+            || (!has_spaces
+                && RE_LIST_BARETOKEN.is_match(trimmed)
+                && !trimmed.contains('.')
+                && !trimmed.contains('/')
+                && !trimmed.contains('$'))
+    }
+}
+
+#[cfg(test)]
+mod tests {
+    use super::*;
+    use crate::test_support::{check_vectors_and_generated, Rng};
+
+    // Pieces chosen to hit every signal and the Unicode edges where the
+    // scanner could drift from the regex engine: non-ASCII whitespace,
+    // combining marks and letters next to tokens, case folding that maps to
+    // ASCII (Kelvin sign) and multi-char lowercase (dotted I).
+    const PIECES: &[&str] = &[
+        "a", "Z", "0", "_", ".", "/", "~", "-", "=", ":", "$", "#", "|", "&", "||", "&&", ";",
+        "\\", "{", "}", "[[", "(", ")", "*", "•", "1.", "2)", " ", "  ", "\t", "\n", "\n\n",
+        "\u{a0}", "\u{85}", "\u{2028}", "\u{3000}", "é", "\u{301}", "\u{0663}", "\u{212a}", "İ",
+        "sudo ", "ls ", "git ", "Kubectl", "import ", "fn", "let", "letter", "if(", "BEGIN",
+        "begbegin", "path/to", "word.", "item", "abcd", "echo hi", "x\\\n",
+    ];
+
+    #[test]
+    fn scan_matches_regex_reference() {
+        check_vectors_and_generated(Rng(0x9e37_79b9_7f4a_7c15), PIECES, 24, 50_000, |text| {
+            assert_eq!(scan(text, &PrefixSet::default()), scan_regex(text), "input {:?}", text);
+        });
+    }
+}
@@ -0,0 +1,53 @@
+//! Helpers for the differential tests that check each single-pass rewrite
+//! against the regex chain it replaced.
+
+/// Deterministic xorshift so failures reproduce.
+pub(crate) struct Rng(pub(crate) u64);
+
+impl Rng {
+    pub(crate) fn next(&mut self) -> u64 {
+        self.0 ^= self.0 << 13;
+        self.0 ^= self.0 >> 7;
+        self.0 ^= self.0 << 17;
+        self.0
+    }
+
+    /// Fewer than `max_pieces` pieces picked at random and concatenated.
+    pub(crate) fn text(&mut self, pieces: &[&str], max_pieces: u64) -> String {
+        let len = (self.next() % max_pieces) as usize;
+        (0..len)
+            .map(|_| pieces[(self.next() % pieces.len() as u64) as usize])
+            .collect()
+    }
+}
+
+/// Inputs of tests/trim-vectors.json with line breaks normalised the way
+/// `trim` does before any pass sees them.
+pub(crate) fn vector_inputs() -> Vec<String> {
+    #[derive(serde::Deserialize)]
+    struct Vector {
+        input: String,
+    }
+    let json = include_str!("../../tests/trim-vectors.json");
+    let vectors: Vec<Vector> = serde_json::from_str(json).expect("parse trim vectors");
+    vectors
+        .into_iter()
+        .map(|v| crate::normalize_newlines(&v.input).into_owned())
+        .collect()
+}
+
+/// Runs `check` on every vector input, then on `cases` texts from `rng`.
+pub(crate) fn check_vectors_and_generated(
+    mut rng: Rng,
+    pieces: &[&str],
+    max_pieces: u64,
+    cases: usize,
+    mut check: impl FnMut(&str),
+) {
+    for text in vector_inputs() {
+        check(&text);
+    }
+    for _ in 0..cases {
+        check(&rng.text(pieces, max_pieces));
+    }
+}
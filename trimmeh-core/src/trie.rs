@@ -0,0 +1,89 @@
+//! Flat byte tries for the command vocabulary.
+//!
+//! Shared with `build.rs`, which compiles the built-in word lists into static
+//! tables of this shape. Every node's edges are contiguous and sorted, and a
+//! lookup walks one edge per input byte, so the cost of a match depends on the
+//! input, not on how many words the trie holds.
+use std::collections::BTreeMap;
+
+#[derive(Debug, Clone, Copy, PartialEq, Eq)]
+pub struct Node {
+    pub terminal: bool,
+    pub first_edge: u32,
+    pub edge_count: u32,
+}
+
+#[derive(Debug, Clone, Copy, PartialEq, Eq)]
+pub struct Edge {
+    pub byte: u8,
+    pub target: u32,
+}
+
+#[derive(Debug, Clone, Copy)]
+pub struct Trie<'a> {
+    pub nodes: &'a [Node],
+    pub edges: &'a [Edge],
+}
+
+impl Trie<'_> {
+    fn step(&self, node: u32, byte: u8) -> Option<u32> {
+        let node = self.nodes[node as usize];
+        let start = node.first_edge as usize;
+        let edges = &self.edges[start..start + node.edge_count as usize];
+        edges.iter().find(|edge| edge.byte == byte).map(|edge| edge.target)
+    }
+
+    /// Walks `bytes` and calls `accept` with the length of every word that is
+    /// a prefix of them, shortest first, until it returns true.
+    pub fn any_prefix_of(
+        &self,
+        bytes: impl IntoIterator<Item = u8>,
+        mut accept: impl FnMut(usize) -> bool,
+    ) -> bool {
+        if self.nodes.is_empty() {
+            return false;
+        }
+        let mut node = 0u32;
+        for (len, byte) in bytes.into_iter().enumerate() {
+            match self.step(node, byte) {
+                Some(next) => node = next,
+                None => return false,
+            }
+            if self.nodes[node as usize].terminal && accept(len + 1) {
+                return true;
+            }
+        }
+        false
+    }
+}
+
+/// Builds the tables for `words`; empty words are ignored.
+pub fn build<'w>(words: impl IntoIterator<Item = &'w [u8]>) -> (Vec<Node>, Vec<Edge>) {
+    let mut children: Vec<BTreeMap<u8, u32>> = vec![BTreeMap::new()];
+    let mut terminal = vec![false];
+    for word in words.into_iter().filter(|word| !word.is_empty()) {
+        let mut node = 0usize;
+        for &byte in word {
+            let next = children.len() as u32;
+            let child = *children[node].entry(byte).or_insert(next);
+            if child == next {
+                children.push(BTreeMap::new());
+                terminal.push(false);
+            }
+            node = child as usize;
+        }
+        terminal[node] = true;
+    }
+
+    let mut nodes = Vec::with_capacity(children.len());
+    let mut edges = Vec::with_capacity(children.len().saturating_sub(1));
+    for (index, edges_of) in children.iter().enumerate() {
+        nodes.push(Node {
+            terminal: terminal[index],
+            first_edge: edges.len() as u32,
+            edge_count: edges_of.len() as u32,
+        });
+        edges.extend(edges_of.iter().map(|(&byte, &target)| Edge { byte, target }));
+    }
+    (nodes, edges)
+}
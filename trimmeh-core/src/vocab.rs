@@ -0,0 +1,148 @@
+//! Command vocabulary: the built-in prefix and keyword tables compiled by
+//! `build.rs`, plus user-supplied extra prefixes.
+use std::fmt;
+use std::sync::Arc;
+
+#[cfg(feature = "wasm")]
+use serde::{Deserialize, Serialize};
+
+use crate::trie::{self, Edge, Node, Trie};
+
+include!(concat!(env!("OUT_DIR"), "/vocab.rs"));
+
+/// Extra first-word prefixes that mark a line as a command, on top of the
+/// built-in list. Compiled once into a trie so a lookup costs the same however
+/// many prefixes there are; clones share the tables.
+#[cfg_attr(feature = "wasm", derive(Serialize, Deserialize))]
+#[cfg_attr(feature = "wasm", serde(from = "Vec<String>", into = "Vec<String>"))]
+#[derive(Clone, Default, PartialEq, Eq)]
+pub struct PrefixSet {
+    words: Arc<[String]>,
+    nodes: Arc<[Node]>,
+    edges: Arc<[Edge]>,
+}
+
+impl PrefixSet {
+    /// Words are trimmed and lowercased, matching how they are compared;
+    /// empty words and duplicates are dropped.
+    pub fn new<I, S>(words: I) -> Self
+    where
+        I: IntoIterator<Item = S>,
+        S: AsRef<str>,
+    {
+        let mut words: Vec<String> = words
+            .into_iter()
+            .map(|word| word.as_ref().trim().to_lowercase())
+            .filter(|word| !word.is_empty())
+            .collect();
+        words.sort();
+        words.dedup();
+        let (nodes, edges) = trie::build(words.iter().map(|word| word.as_bytes()));
+        Self {
+            words: words.into(),
+            nodes: nodes.into(),
+            edges: edges.into(),
+        }
+    }
+
+    pub fn is_empty(&self) -> bool {
+        self.words.is_empty()
+    }
+
+    pub fn words(&self) -> &[String] {
+        &self.words
+    }
+
+    fn trie(&self) -> Trie<'_> {
+        Trie {
+            nodes: &self.nodes,
+            edges: &self.edges,
+        }
+    }
+}
+
+impl fmt::Debug for PrefixSet {
+    fn fmt(&self, f: &mut fmt::Formatter<'_>) -> fmt::Result {
+        f.debug_tuple("PrefixSet").field(&self.words).finish()
+    }
+}
+
+impl From<Vec<String>> for PrefixSet {
+    fn from(words: Vec<String>) -> Self {
+        Self::new(words)
+    }
+}
+
+impl From<PrefixSet> for Vec<String> {
+    fn from(set: PrefixSet) -> Self {
+        set.words.to_vec()
+    }
+}
+
+/// Same as `token.to_lowercase().starts_with(prefix)` for a built-in or extra
+/// prefix, without allocating.
+pub(crate) fn is_known_command_prefix(token: &str, extra: &PrefixSet) -> bool {
+    fn any_prefix(lowered: impl Iterator<Item = u8> + Clone, extra: &PrefixSet) -> bool {
+        KNOWN_PREFIXES_TRIE.any_prefix_of(lowered.clone(), |_| true)
+            || (!extra.is_empty() && extra.trie().any_prefix_of(lowered, |_| true))
+    }
+
+    if token.is_ascii() {
+        return any_prefix(token.bytes().map(|b| b.to_ascii_lowercase()), extra);
+    }
+    // Some non-ASCII characters lowercase to ASCII (the Kelvin sign to `k`).
+    let lowered = token.chars().flat_map(char::to_lowercase).flat_map(|c| {
+        let mut buf = [0u8; 4];
+        let len = c.encode_utf8(&mut buf).len();
+        buf.into_iter().take(len)
+    });
+    any_prefix(lowered, extra)
+}
+
+/// `t` starts with a source keyword followed by a non-word character or the
+/// end of the text.
+pub(crate) fn starts_with_source_keyword(t: &str) -> bool {
+    SOURCE_KEYWORDS_TRIE.any_prefix_of(t.bytes(), |len| {
+        !t[len..].chars().next().is_some_and(regex_syntax::is_word_character)
+    })
+}
+
+#[cfg(test)]
+mod tests {
+    use super::*;
+
+    #[test]
+    fn builtin_prefixes_match_linear_scan() {
+        let tokens = [
+            "sudo", "SUDO", "Sudoers", "./run", "~/bin", "gitk", "gi", "", "-", "\u{212a}ubectl",
+            "\u{130}nstall", "ls", "lsblk", "l", "shell", "Zsh", "é", "openssl",
+        ];
+        for token in tokens {
+            let lower = token.to_lowercase();
+            let expected = KNOWN_PREFIXES.iter().any(|p| lower.starts_with(p));
+            assert_eq!(is_known_command_prefix(token, &PrefixSet::default()), expected, "{token:?}");
+        }
+    }
+
+    #[test]
+    fn extra_prefixes_extend_the_builtin_list() {
+        let extra = PrefixSet::new(["  Terraform ", "", "helm", "helm", "ÉCHO"]);
+        assert_eq!(extra.words(), ["helm", "terraform", "écho"]);
+        assert!(is_known_command_prefix("terraform", &extra));
+        assert!(is_known_command_prefix("HELMFILE", &extra));
+        assert!(is_known_command_prefix("Échoes", &extra));
+        assert!(!is_known_command_prefix("terra", &extra));
+        assert!(!is_known_command_prefix("terraform", &PrefixSet::default()));
+    }
+
+    #[test]
+    fn source_keywords_need_a_word_boundary() {
+        assert!(starts_with_source_keyword("fn main"));
+        assert!(starts_with_source_keyword("if(x)"));
+        assert!(starts_with_source_keyword("for"));
+        assert!(!starts_with_source_keyword("format"));
+        assert!(!starts_with_source_keyword("ifé"));
+        assert!(starts_with_source_keyword("internal func"));
+        assert!(!starts_with_source_keyword("Import"));
+    }
+}
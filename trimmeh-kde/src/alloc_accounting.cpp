@@ -0,0 +1,213 @@
+#include "alloc_accounting.h"
+
+#ifdef TRIMMEH_ALLOC_ACCOUNTING
+#include <atomic>
+#include <cerrno>
+#include <cstdlib>
+#include <new>
+#endif
+
+namespace AllocAccounting {
+namespace {
+#ifdef TRIMMEH_ALLOC_ACCOUNTING
+constexpr int kStageCount = static_cast<int>(Stage::Count);
+constexpr int kNoStage = -1;
+
+std::atomic<quint64> g_allocations[kStageCount];
+std::atomic<quint64> g_bytes[kStageCount];
+thread_local int t_stage = kNoStage;
+
+void charge(std::size_t size) {
+    const int stage = t_stage;
+    if (stage == kNoStage) {
+        return;
+    }
+    g_allocations[stage].fetch_add(1, std::memory_order_relaxed);
+    g_bytes[stage].fetch_add(size, std::memory_order_relaxed);
+}
+#endif
+}
+
+const char *stageName(Stage stage) {
+    switch (stage) {
+    case Stage::Read:
+        return "read";
+    case Stage::Guard:
+        return "guard";
+    case Stage::Trim:
+        return "trim";
+    case Stage::Write:
+        return "write";
+    case Stage::Count:
+        break;
+    }
+    return "?";
+}
+
+StageCounts counts(Stage stage) {
+    StageCounts result;
+#ifdef TRIMMEH_ALLOC_ACCOUNTING
+    const int index = static_cast<int>(stage);
+    if (index >= 0 && index < kStageCount) {
+        result.allocations = g_allocations[index].load(std::memory_order_relaxed);
+        result.bytes = g_bytes[index].load(std::memory_order_relaxed);
+    }
+#else
+    Q_UNUSED(stage);
+#endif
+    return result;
+}
+
+void reset() {
+#ifdef TRIMMEH_ALLOC_ACCOUNTING
+    for (int i = 0; i < kStageCount; ++i) {
+        g_allocations[i].store(0, std::memory_order_relaxed);
+        g_bytes[i].store(0, std::memory_order_relaxed);
+    }
+#endif
+}
+
+#ifdef TRIMMEH_ALLOC_ACCOUNTING
+Scope::Scope(Stage stage)
+    : m_previous(t_stage) {
+    t_stage = static_cast<int>(stage);
+}
+
+Scope::~Scope() {
+    t_stage = m_previous;
+}
+#endif
+} // namespace AllocAccounting
+
+#ifdef TRIMMEH_ALLOC_ACCOUNTING
+#if defined(__GLIBC__)
+// QString, QByteArray and most of Qt allocate with malloc/realloc rather than
+// operator new, so on glibc the C allocator is interposed as well: these
+// definitions take precedence over libc's and forward to its __libc_*
+// entry points. operator new then reaches the counter through malloc.
+extern "C" {
+void *__libc_malloc(std::size_t size);
+void *__libc_calloc(std::size_t count, std::size_t size);
+void *__libc_realloc(void *ptr, std::size_t size);
+void *__libc_memalign(std::size_t alignment, std::size_t size);
+void __libc_free(void *ptr);
+
+void *malloc(std::size_t size) {
+    AllocAccounting::charge(size);
+    return __libc_malloc(size);
+}
+
+void *calloc(std::size_t count, std::size_t size) {
+    AllocAccounting::charge(count * size);
+    return __libc_calloc(count, size);
+}
+
+void *realloc(void *ptr, std::size_t size) {
+    AllocAccounting::charge(size);
+    return __libc_realloc(ptr, size);
+}
+
+void *memalign(std::size_t alignment, std::size_t size) {
+    AllocAccounting::charge(size);
+    return __libc_memalign(alignment, size);
+}
+
+void *aligned_alloc(std::size_t alignment, std::size_t size) {
+    AllocAccounting::charge(size);
+    return __libc_memalign(alignment, size);
+}
+
+int posix_memalign(void **out, std::size_t alignment, std::size_t size) {
+    if (alignment < sizeof(void *) || (alignment & (alignment - 1)) != 0) {
+        return EINVAL;
+    }
+    AllocAccounting::charge(size);
+    void *ptr = __libc_memalign(alignment, size);
+    if (!ptr) {
+        return ENOMEM;
+    }
+    *out = ptr;
+    return 0;
+}
+
+void free(void *ptr) {
+    __libc_free(ptr);
+}
+}
+
+namespace {
+void chargeNew(std::size_t) {
+}
+}
+#else
+namespace {
+// Without glibc only C++ allocations are counted; Qt's malloc-backed
+// containers are invisible.
+void chargeNew(std::size_t size) {
+    AllocAccounting::charge(size);
+}
+}
+#endif
+
+namespace {
+void *allocate(std::size_t size) {
+    chargeNew(size);
+    if (void *ptr = std::malloc(size ? size : 1)) {
+        return ptr;
+    }
+    throw std::bad_alloc();
+}
+
+void *allocateAligned(std::size_t size, std::align_val_t align) {
+    chargeNew(size);
+    const std::size_t alignment = static_cast<std::size_t>(align);
+    const std::size_t rounded = (size + alignment - 1) / alignment * alignment;
+    if (void *ptr = std::aligned_alloc(alignment, rounded ? rounded : alignment)) {
+        return ptr;
+    }
+    throw std::bad_alloc();
+}
+
+void *allocateNothrow(std::size_t size) noexcept {
+    try {
+        return allocate(size);
+    } catch (const std::bad_alloc &) {
+        return nullptr;
+    }
+}
+
+void *allocateAlignedNothrow(std::size_t size, std::align_val_t align) noexcept {
+    try {
+        return allocateAligned(size, align);
+    } catch (const std::bad_alloc &) {
+        return nullptr;
+    }
+}
+}
+
+void *operator new(std::size_t size) { return allocate(size); }
+void *operator new[](std::size_t size) { return allocate(size); }
+void *operator new(std::size_t size, const std::nothrow_t &) noexcept { return allocateNothrow(size); }
+void *operator new[](std::size_t size, const std::nothrow_t &) noexcept { return allocateNothrow(size); }
+void *operator new(std::size_t size, std::align_val_t align) { return allocateAligned(size, align); }
+void *operator new[](std::size_t size, std::align_val_t align) { return allocateAligned(size, align); }
+void *operator new(std::size_t size, std::align_val_t align, const std::nothrow_t &) noexcept {
+    return allocateAlignedNothrow(size, align);
+}
+void *operator new[](std::size_t size, std::align_val_t align, const std::nothrow_t &) noexcept {
+    return allocateAlignedNothrow(size, align);
+}
+
+void operator delete(void *ptr) noexcept { std::free(ptr); }
+void operator delete[](void *ptr) noexcept { std::free(ptr); }
+void operator delete(void *ptr, std::size_t) noexcept { std::free(ptr); }
+void operator delete[](void *ptr, std::size_t) noexcept { std::free(ptr); }
+void operator delete(void *ptr, const std::nothrow_t &) noexcept { std::free(ptr); }
+void operator delete[](void *ptr, const std::nothrow_t &) noexcept { std::free(ptr); }
+void operator delete(void *ptr, std::align_val_t) noexcept { std::free(ptr); }
+void operator delete[](void *ptr, std::align_val_t) noexcept { std::free(ptr); }
+void operator delete(void *ptr, std::size_t, std::align_val_t) noexcept { std::free(ptr); }
+void operator delete[](void *ptr, std::size_t, std::align_val_t) noexcept { std::free(ptr); }
+void operator delete(void *ptr, std::align_val_t, const std::nothrow_t &) noexcept { std::free(ptr); }
+void operator delete[](void *ptr, std::align_val_t, const std::nothrow_t &) noexcept { std::free(ptr); }
+#endif
@@ -0,0 +1,54 @@
+#pragma once
+
+#include <QtGlobal>
+
+// Heap allocation accounting for the clipboard pipeline. Built only with
+// -DTRIMMEH_ALLOC_ACCOUNTING=ON, which replaces the global operator new and
+// delete and, on glibc, malloc, calloc, realloc and free. Without glibc only
+// C++ new is counted. Memory a library maps directly (the QJSEngine's
+// garbage-collected heap) is never counted. Otherwise Scope is empty and
+// every query returns zero.
+//
+// Allocations are charged to the stage of the innermost Scope on the
+// allocating thread; allocations outside any Scope are not counted.
+namespace AllocAccounting {
+enum class Stage {
+    Read,
+    Guard,
+    Trim,
+    Write,
+    Count,
+};
+
+struct StageCounts {
+    quint64 allocations = 0;
+    quint64 bytes = 0;
+};
+
+constexpr bool isEnabled() {
+#ifdef TRIMMEH_ALLOC_ACCOUNTING
+    return true;
+#else
+    return false;
+#endif
+}
+
+const char *stageName(Stage stage);
+StageCounts counts(Stage stage);
+void reset();
+
+class Scope {
+public:
+#ifdef TRIMMEH_ALLOC_ACCOUNTING
+    explicit Scope(Stage stage);
+    ~Scope();
+
+private:
+    int m_previous;
+#else
+    explicit Scope(Stage) {}
+#endif
+    Scope(const Scope &) = delete;
+    Scope &operator=(const Scope &) = delete;
+};
+} // namespace AllocAccounting
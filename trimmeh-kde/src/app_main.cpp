@@ -1,47 +1,23 @@
 #include "app_identity.h"
-#include "autostart_manager.h"
-#include "clipboard_watcher.h"
-#include "hotkey_manager.h"
-#include "klipper_bridge.h"
-#include "portal_paste_injector.h"
-#include "settings.h"
-#include "settings_store.h"
+#include "app_startup.h"
+#include "startup_profile.h"
 #include "tray_app.h"
-#include "trim_core.h"
 
 #include <QApplication>
 #include <QCommandLineParser>
-#include <QDebug>
-#include <QDir>
-#include <QFileInfo>
 #include <QGuiApplication>
-#include <QLibraryInfo>
-#include <QStandardPaths>
-#include <QSettings>
 
-namespace {
-QString coreBundlePath() {
-    const QString appDir = QApplication::applicationDirPath();
-    const QString local = QDir(appDir).filePath(QStringLiteral("trimmeh-core.js"));
-    if (QFileInfo::exists(local)) {
-        return local;
-    }
-
-    const QString libDir = QLibraryInfo::path(QLibraryInfo::LibrariesPath);
-    if (!libDir.isEmpty()) {
-        const QString candidate = QDir(libDir).filePath(QStringLiteral("trimmeh/trimmeh-core.js"));
-        if (QFileInfo::exists(candidate)) {
-            return candidate;
-        }
-    }
-
-    return local;
-}
-}
+#include <memory>
 
 int main(int argc, char **argv) {
+    StartupProfile profile;
     QGuiApplication::setDesktopFileName(AppIdentity::appId());
-    QApplication app(argc, argv);
+    std::unique_ptr<QApplication> appHolder;
+    {
+        StartupProfile::Phase phase(&profile, QStringLiteral("qapplication"));
+        appHolder = std::make_unique<QApplication>(argc, argv);
+    }
+    QApplication &app = *appHolder;
     QCoreApplication::setOrganizationName("Trimmeh");
     QCoreApplication::setOrganizationDomain("trimmeh.dev");
     QApplication::setApplicationName("trimmeh-kde");
@@ -52,62 +28,22 @@ int main(int argc, char **argv) {
     parser.setApplicationDescription("Trimmeh KDE (Klipper D-Bus auto-trim)");
     parser.addHelpOption();
     parser.addVersionOption();
+    QCommandLineOption profileOpt("startup-profile", "Print a per-phase startup timing table.");
+    parser.addOption(profileOpt);
+    QCommandLineOption exitOpt("exit-after-startup", "Quit once startup has settled (for footprint measurements).");
+    parser.addOption(exitOpt);
+    QCommandLineOption stallOpt("stall-threshold-ms",
+                                "Log event-loop stalls longer than this (default 250, 0 disables).",
+                                "ms", "250");
+    parser.addOption(stallOpt);
     parser.process(app);
-
-    QString identityError;
-    if (!AppIdentity::ensureDesktopFile(&identityError)) {
-        qWarning().noquote() << "[trimmeh-kde]" << identityError;
-    }
-    identityError.clear();
-    if (!AppIdentity::registerWithPortal(&identityError)) {
-        qInfo().noquote() << "[trimmeh-kde]" << identityError;
-    }
-
-    const QString corePath = coreBundlePath();
-    if (!QFileInfo::exists(corePath)) {
-        qCritical().noquote() << "[trimmeh-kde] Missing JS bundle:" << corePath;
-        qCritical() << "[trimmeh-kde] Run the build step that bundles trimmeh-core-js.";
-        return 2;
-    }
-
-    TrimCore core;
-    QString error;
-    if (!core.load(corePath, &error)) {
-        qCritical().noquote() << "[trimmeh-kde]" << error;
-        return 3;
-    }
-
-    KlipperBridge bridge;
-    if (!bridge.init(&error)) {
-        qCritical().noquote() << "[trimmeh-kde]" << error;
-        return 4;
-    }
-
-    SettingsStore store;
-    AutostartManager autostart;
-    Settings settings = store.load();
-    QSettings raw;
-    if (raw.contains(QStringLiteral("startAtLogin"))) {
-        QString error;
-        if (!autostart.setEnabled(settings.startAtLogin, &error)) {
-            qWarning().noquote() << "[trimmeh-kde]" << error;
-        }
-        settings.startAtLogin = autostart.isEnabled();
-    } else {
-        settings.startAtLogin = autostart.isEnabled();
-    }
-    store.save(settings);
-
-    PortalPasteInjector injector;
-    ClipboardWatcher watcher(&bridge, &core, settings, &store, &autostart, &injector);
-    if (!bridge.connectClipboardSignal(&watcher, SLOT(onClipboardHistoryUpdated()), &error)) {
-        qCritical().noquote() << "[trimmeh-kde]" << error;
-        return 5;
-    }
-
-    HotkeyManager hotkeys(&watcher);
-    TrayApp tray(&watcher, &core, &injector);
-
-    qInfo() << "[trimmeh-kde] Listening for clipboardHistoryUpdated...";
-    return app.exec();
+    profile.setEnabled(parser.isSet(profileOpt));
+
+    AppStartup::Config config;
+    config.exitAfterStartup = parser.isSet(exitOpt);
+    config.stallThresholdMs = qMax(0, parser.value(stallOpt).toInt());
+    return AppStartup::run(app, profile, config,
+                           [](ClipboardWatcher *watcher, TrimCore *core, PortalPasteInjector *injector) {
+                               return std::unique_ptr<QObject>(new TrayApp(watcher, core, injector));
+                           });
 }
@@ -0,0 +1,295 @@
+#include "app_startup.h"
+
+#include "app_identity.h"
+#include "autostart_manager.h"
+#include "clipboard_watcher.h"
+#include "event_log.h"
+#include "hotkey_manager.h"
+#include "klipper_bridge.h"
+#include "log_categories.h"
+#include "metrics_service.h"
+#include "portal_paste_injector.h"
+#include "settings.h"
+#include "settings_store.h"
+#include "stall_watchdog.h"
+#include "startup_profile.h"
+#include "trim_core.h"
+#include "trim_service.h"
+
+#include <QCoreApplication>
+#include <QDebug>
+#include <QDir>
+#include <QFileInfo>
+#include <QLibraryInfo>
+#include <QSettings>
+#include <QSocketNotifier>
+#include <QThread>
+#include <QTimer>
+
+#include <csignal>
+#include <cstdio>
+#include <sys/socket.h>
+#include <unistd.h>
+
+namespace {
+constexpr int kCoreWarmupDelayMs = 250;
+
+int g_dumpSignalFds[2] = {-1, -1};
+
+void onDumpSignal(int) {
+    const char byte = 1;
+    const ssize_t ignored = ::write(g_dumpSignalFds[0], &byte, 1);
+    (void)ignored;
+}
+
+// SIGUSR1 writes the event log to stderr: `pkill -USR1 trimmeh-kde`.
+void installDumpSignalHandler(QCoreApplication *app) {
+    if (::socketpair(AF_UNIX, SOCK_STREAM, 0, g_dumpSignalFds) != 0) {
+        return;
+    }
+    auto *notifier = new QSocketNotifier(g_dumpSignalFds[1], QSocketNotifier::Read, app);
+    QObject::connect(notifier, &QSocketNotifier::activated, app, []() {
+        char byte = 0;
+        const ssize_t ignored = ::read(g_dumpSignalFds[1], &byte, 1);
+        (void)ignored;
+        const QStringList lines = EventLog::dump();
+        std::fprintf(stderr, "[trimmeh-kde] event log (%lld entries):\n", static_cast<long long>(lines.size()));
+        for (const QString &line : lines) {
+            std::fprintf(stderr, "  %s\n", line.toLocal8Bit().constData());
+        }
+        std::fflush(stderr);
+    });
+    std::signal(SIGUSR1, onDumpSignal);
+}
+
+struct IdentityResult {
+    QString desktopError;
+    QString portalError;
+};
+
+// A failed startup never reaches startup-complete, which is when the table
+// is normally printed; print what was recorded up to the failure instead.
+int failStartup(StartupProfile &profile, int rc) {
+    profile.mark(QStringLiteral("startup-failed"));
+    if (profile.isEnabled()) {
+        profile.print();
+    }
+    return rc;
+}
+}
+
+namespace AppStartup {
+QString coreBundlePath() {
+    const QString appDir = QCoreApplication::applicationDirPath();
+    const QString local = QDir(appDir).filePath(QStringLiteral("trimmeh-core.js"));
+    if (QFileInfo::exists(local)) {
+        return local;
+    }
+
+    const QString libDir = QLibraryInfo::path(QLibraryInfo::LibrariesPath);
+    if (!libDir.isEmpty()) {
+        const QString candidate = QDir(libDir).filePath(QStringLiteral("trimmeh/trimmeh-core.js"));
+        if (QFileInfo::exists(candidate)) {
+            return candidate;
+        }
+    }
+
+    return local;
+}
+
+int run(QCoreApplication &app,
+        StartupProfile &profile,
+        const Config &config,
+        const UiFactory &createUi) {
+    EventLog::installMessageHandler();
+    installDumpSignalHandler(&app);
+
+    const QString corePath = coreBundlePath();
+    if (!QFileInfo::exists(corePath)) {
+        qCCritical(lcCore).noquote() << "[trimmeh-kde] Missing JS bundle:" << corePath;
+        qCCritical(lcCore) << "[trimmeh-kde] Run the build step that bundles trimmeh-core-js.";
+        return failStartup(profile, 2);
+    }
+
+    QString error;
+    KlipperBridge bridge;
+    {
+        StartupProfile::Phase phase(&profile, QStringLiteral("klipper-bridge"));
+        if (!bridge.init(&error)) {
+            qCCritical(lcBridge).noquote() << "[trimmeh-kde]" << error;
+            return failStartup(profile, 4);
+        }
+    }
+
+    SettingsStore store;
+    AutostartManager autostart;
+    AutostartManager *autostartPtr = config.manageAutostart ? &autostart : nullptr;
+    Settings settings;
+    bool hasStartAtLogin = false;
+    {
+        StartupProfile::Phase phase(&profile, QStringLiteral("settings-load"));
+        settings = store.load();
+        hasStartAtLogin = QSettings().contains(QStringLiteral("startAtLogin"));
+    }
+
+    // The desktop entry and portal registration only touch files and D-Bus,
+    // so they run on a worker while the clipboard path comes up. The portal
+    // injector must wait for the Registry call. Autostart stays on this
+    // thread: the preferences dialog calls the same AutostartManager.
+    auto identity = std::make_shared<IdentityResult>();
+    std::unique_ptr<QThread> identityThread(QThread::create([&profile, identity]() {
+        {
+            StartupProfile::Phase phase(&profile, QStringLiteral("desktop-file"));
+            AppIdentity::ensureDesktopFile(&identity->desktopError);
+        }
+        {
+            StartupProfile::Phase phase(&profile, QStringLiteral("portal-register"));
+            AppIdentity::registerWithPortal(&identity->portalError);
+        }
+    }));
+    identityThread->start();
+
+    TrimCore core;
+    core.setBundlePath(corePath);
+    std::unique_ptr<PortalPasteInjector> injector;
+    if (config.hotkeys) {
+        injector = std::make_unique<PortalPasteInjector>();
+    }
+    std::unique_ptr<ClipboardWatcher> watcher;
+    {
+        StartupProfile::Phase phase(&profile, QStringLiteral("watcher"));
+        watcher = std::make_unique<ClipboardWatcher>(&bridge, &core, settings, &store, autostartPtr, injector.get());
+        if (!bridge.connectClipboardSignal(watcher.get(), SLOT(onClipboardHistoryUpdated()), &error)) {
+            qCCritical(lcBridge).noquote() << "[trimmeh-kde]" << error;
+            identityThread->wait();
+            return failStartup(profile, 5);
+        }
+    }
+
+    TrimService trimService(watcher.get(), &core);
+    MetricsService metricsService(watcher.get());
+    {
+        StartupProfile::Phase phase(&profile, QStringLiteral("trim-service"));
+        if (!trimService.registerOnBus(&error)) {
+            qCWarning(lcApp).noquote() << "[trimmeh-kde]" << error;
+        }
+        if (!metricsService.registerOnBus(&error)) {
+            qCWarning(lcApp).noquote() << "[trimmeh-kde]" << error;
+        }
+    }
+
+    std::unique_ptr<StallWatchdog> watchdog;
+    if (config.stallThresholdMs > 0) {
+        watchdog = std::make_unique<StallWatchdog>(config.stallThresholdMs);
+        ClipboardWatcher *watcherPtr = watcher.get();
+        QObject::connect(watchdog.get(), &StallWatchdog::stallEnded, watcherPtr,
+                         [watcherPtr](const StallRecord &record) {
+                             watcherPtr->recordStall(record.stage, record.durationMs, record.payloadSize);
+                         });
+        watchdog->start();
+    }
+
+    std::unique_ptr<QObject> ui;
+    if (createUi) {
+        StartupProfile::Phase phase(&profile, QStringLiteral("tray"));
+        ui = createUi(watcher.get(), &core, injector.get());
+        profile.mark(QStringLiteral("tray-visible"));
+    }
+    profile.mark(QStringLiteral("accepting-events"));
+
+    std::unique_ptr<HotkeyManager> hotkeys;
+    int pendingStages = 4;
+    auto stageDone = [&profile, &pendingStages, &config]() {
+        pendingStages -= 1;
+        if (pendingStages == 0) {
+            profile.mark(QStringLiteral("startup-complete"));
+            if (profile.isEnabled()) {
+                profile.print();
+            }
+            if (config.exitAfterStartup) {
+                QCoreApplication::quit();
+            }
+        }
+    };
+
+    // The JS engine is compiled lazily: in an idle slot once the tray is up,
+    // or on the first clipboard event, whichever comes first. With auto-trim
+    // off it is not created until a manual trim needs it.
+    if (watcher->autoTrimEnabled()) {
+        QTimer::singleShot(kCoreWarmupDelayMs, &app, [&]() {
+            if (!core.isReady()) {
+                StartupProfile::Phase phase(&profile, QStringLiteral("trim-core-load"));
+                QString loadError;
+                if (!core.ensureLoaded(&loadError)) {
+                    qCCritical(lcCore).noquote() << "[trimmeh-kde]" << loadError;
+                    QCoreApplication::exit(failStartup(profile, 3));
+                    return;
+                }
+            }
+            stageDone();
+        });
+    } else {
+        profile.mark(QStringLiteral("trim-core-deferred"));
+        stageDone();
+    }
+
+    if (config.hotkeys) {
+        QTimer::singleShot(0, &app, [&]() {
+            {
+                StartupProfile::Phase phase(&profile, QStringLiteral("hotkeys"));
+                hotkeys = std::make_unique<HotkeyManager>(watcher.get());
+            }
+            stageDone();
+        });
+    } else {
+        stageDone();
+    }
+
+    // Deferred so the first clipboard event is not queued behind the
+    // autostart file check.
+    QTimer::singleShot(0, &app, [&]() {
+        if (autostartPtr) {
+            StartupProfile::Phase phase(&profile, QStringLiteral("autostart-check"));
+            QString autostartError;
+            if (hasStartAtLogin && !autostartPtr->setEnabled(settings.startAtLogin, &autostartError)) {
+                qCWarning(lcSettings).noquote() << "[trimmeh-kde]" << autostartError;
+            }
+            const bool enabled = autostartPtr->isEnabled();
+            if (watcher->startAtLogin() != enabled) {
+                watcher->setStartAtLogin(enabled);
+            }
+        }
+        stageDone();
+    });
+
+    QObject::connect(identityThread.get(), &QThread::finished, &app, [&, identity]() {
+        if (!identity->desktopError.isEmpty()) {
+            qCWarning(lcApp).noquote() << "[trimmeh-kde]" << identity->desktopError;
+        }
+        if (!identity->portalError.isEmpty()) {
+            qCInfo(lcPortal).noquote() << "[trimmeh-kde]" << identity->portalError;
+        }
+        if (injector) {
+            StartupProfile::Phase phase(&profile, QStringLiteral("portal-injector"));
+            injector->start();
+        }
+        stageDone();
+    });
+
+    qCInfo(lcWatcher) << "[trimmeh-kde] Listening for clipboardHistoryUpdated...";
+    const int rc = app.exec();
+    if (watchdog) {
+        watchdog->stop();
+    }
+    identityThread->wait();
+    store.flush();
+    qCInfo(lcSettings).noquote() << "[trimmeh-kde] settings:" << store.diskWrites() << "disk writes,"
+                      << store.writesAvoided() << "avoided";
+    if (trimService.requestCount() > 0) {
+        qCInfo(lcApp).noquote() << "[trimmeh-kde] trim service:" << trimService.requestCount() << "requests,"
+                          << trimService.trimCount() << "texts,"
+                          << trimService.totalLatencyUsec() / trimService.requestCount() << "us mean latency";
+    }
+    return rc;
+}
+} // namespace AppStartup
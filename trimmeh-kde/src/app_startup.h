@@ -0,0 +1,40 @@
+#pragma once
+
+#include <QObject>
+#include <QString>
+
+#include <functional>
+#include <memory>
+
+class ClipboardWatcher;
+class PortalPasteInjector;
+class QCoreApplication;
+class StartupProfile;
+class TrimCore;
+
+// Staged startup shared by the tray app and the headless daemon. The caller
+// owns the application object so it can pick QApplication, QGuiApplication
+// or QCoreApplication.
+namespace AppStartup {
+struct Config {
+    // Registers KGlobalAccel shortcuts and the portal paste injector. Both
+    // need a QGuiApplication.
+    bool hotkeys = true;
+    // Writes the XDG autostart entry for this executable. Only the tray app
+    // owns the entry; the daemon is started by the session or a unit file.
+    bool manageAutostart = true;
+    bool exitAfterStartup = false;
+    // Event-loop stall threshold for the watchdog thread; 0 disables it.
+    int stallThresholdMs = 250;
+};
+
+using UiFactory = std::function<std::unique_ptr<QObject>(ClipboardWatcher *watcher,
+                                                         TrimCore *core,
+                                                         PortalPasteInjector *injector)>;
+
+QString coreBundlePath();
+int run(QCoreApplication &app,
+        StartupProfile &profile,
+        const Config &config,
+        const UiFactory &createUi = UiFactory());
+} // namespace AppStartup
@@ -1,12 +1,17 @@
 #include "clipboard_watcher.h"
 
+#include "alloc_accounting.h"
 #include "autostart_manager.h"
+#include "event_log.h"
+#include "log_categories.h"
 #include "portal_paste_injector.h"
 #include "settings_store.h"
+#include "stall_watchdog.h"
 
 #include <QCryptographicHash>
 #include <QDateTime>
 #include <QDebug>
+#include <QElapsedTimer>
 #include <QClipboard>
 #include <QGuiApplication>
 #include <QMimeData>
@@ -16,6 +21,7 @@
 namespace {
 constexpr int kMinRestoreDelayMs = 50;
 constexpr int kMaxRestoreDelayMs = 2000;
+constexpr char kSkippedTooLargeReason[] = "skipped_too_large";
 }
 
 ClipboardWatcher::ClipboardWatcher(KlipperBridge *bridge,
@@ -34,159 +40,116 @@ ClipboardWatcher::ClipboardWatcher(KlipperBridge *bridge,
     , m_injector(injector)
 {
     m_debounce.setSingleShot(true);
-    m_debounce.setInterval(m_settings.graceDelayMs);
+    m_debounce.setInterval(m_settings.current()->settings.graceDelayMs);
     connect(&m_debounce, &QTimer::timeout, this, &ClipboardWatcher::onDebounceTimeout);
 }
 
-void ClipboardWatcher::setAutoTrimEnabled(bool enabled) {
-    if (m_settings.autoTrimEnabled == enabled) {
-        return;
+template <typename T>
+bool ClipboardWatcher::updateSetting(T Settings::*field, const T &value) {
+    const SettingsSnapshotPtr current = m_settings.current();
+    if (current->settings.*field == value) {
+        return false;
     }
-    m_settings.autoTrimEnabled = enabled;
+    Settings next = current->settings;
+    next.*field = value;
+    m_settings.publish(next);
     persistSettings();
     emit stateChanged();
+    return true;
 }
 
-void ClipboardWatcher::setKeepBlankLines(bool enabled) {
-    if (m_settings.keepBlankLines == enabled) {
-        return;
+void ClipboardWatcher::setAutoTrimEnabled(bool enabled) {
+    if (updateSetting(&Settings::autoTrimEnabled, enabled) && enabled) {
+        scheduleCoreWarmup();
     }
-    m_settings.keepBlankLines = enabled;
-    persistSettings();
-    emit stateChanged();
+}
+
+void ClipboardWatcher::setKeepBlankLines(bool enabled) {
+    updateSetting(&Settings::keepBlankLines, enabled);
 }
 
 void ClipboardWatcher::setStripBoxChars(bool enabled) {
-    if (m_settings.stripBoxChars == enabled) {
-        return;
-    }
-    m_settings.stripBoxChars = enabled;
-    persistSettings();
-    emit stateChanged();
+    updateSetting(&Settings::stripBoxChars, enabled);
 }
 
 void ClipboardWatcher::setTrimPrompts(bool enabled) {
-    if (m_settings.trimPrompts == enabled) {
-        return;
-    }
-    m_settings.trimPrompts = enabled;
-    persistSettings();
-    emit stateChanged();
+    updateSetting(&Settings::trimPrompts, enabled);
 }
 
 void ClipboardWatcher::setUseClipboardFallbacks(bool enabled) {
-    if (m_settings.useClipboardFallbacks == enabled) {
-        return;
-    }
-    m_settings.useClipboardFallbacks = enabled;
-    persistSettings();
-    emit stateChanged();
+    updateSetting(&Settings::useClipboardFallbacks, enabled);
 }
 
 void ClipboardWatcher::setMaxLines(int maxLines) {
-    if (m_settings.maxLines == maxLines) {
-        return;
-    }
-    m_settings.maxLines = maxLines;
-    persistSettings();
-    emit stateChanged();
+    updateSetting(&Settings::maxLines, maxLines);
+}
+
+void ClipboardWatcher::setLargeSnippets(bool enabled) {
+    updateSetting(&Settings::largeSnippets, enabled);
+}
+
+void ClipboardWatcher::setExtraCommandPrefixes(const QStringList &prefixes) {
+    updateSetting(&Settings::extraCommandPrefixes, prefixes);
 }
 
 void ClipboardWatcher::setAggressiveness(const QString &level) {
-    if (m_settings.aggressiveness == level) {
-        return;
-    }
-    m_settings.aggressiveness = level;
-    persistSettings();
-    emit stateChanged();
+    updateSetting(&Settings::aggressiveness, level);
 }
 
 void ClipboardWatcher::setStartAtLogin(bool enabled) {
     if (m_autostart) {
         QString error;
         if (!m_autostart->setEnabled(enabled, &error)) {
-            qWarning().noquote() << "[trimmeh-kde]" << error;
+            qCWarning(lcSettings).noquote() << "[trimmeh-kde]" << error;
         }
         const bool actual = m_autostart->isEnabled();
-        if (m_settings.startAtLogin == actual) {
-            if (actual != enabled) {
-                emit stateChanged();
-            }
-            return;
-        }
-        m_settings.startAtLogin = actual;
-    } else {
-        if (m_settings.startAtLogin == enabled) {
-            return;
+        if (!updateSetting(&Settings::startAtLogin, actual) && actual != enabled) {
+            emit stateChanged();
         }
-        m_settings.startAtLogin = enabled;
+        return;
     }
-    persistSettings();
-    emit stateChanged();
+    updateSetting(&Settings::startAtLogin, enabled);
 }
 
 void ClipboardWatcher::setPasteRestoreDelayMs(int delayMs) {
-    const int clamped = qBound(kMinRestoreDelayMs, delayMs, kMaxRestoreDelayMs);
-    if (m_settings.pasteRestoreDelayMs == clamped) {
-        return;
-    }
-    m_settings.pasteRestoreDelayMs = clamped;
-    persistSettings();
-    emit stateChanged();
+    updateSetting(&Settings::pasteRestoreDelayMs, qBound(kMinRestoreDelayMs, delayMs, kMaxRestoreDelayMs));
 }
 
 void ClipboardWatcher::setPasteTrimmedHotkeyEnabled(bool enabled) {
-    if (m_settings.pasteTrimmedHotkeyEnabled == enabled) {
-        return;
-    }
-    m_settings.pasteTrimmedHotkeyEnabled = enabled;
-    persistSettings();
-    emit stateChanged();
+    updateSetting(&Settings::pasteTrimmedHotkeyEnabled, enabled);
 }
 
 void ClipboardWatcher::setPasteOriginalHotkeyEnabled(bool enabled) {
-    if (m_settings.pasteOriginalHotkeyEnabled == enabled) {
-        return;
-    }
-    m_settings.pasteOriginalHotkeyEnabled = enabled;
-    persistSettings();
-    emit stateChanged();
+    updateSetting(&Settings::pasteOriginalHotkeyEnabled, enabled);
 }
 
 void ClipboardWatcher::setToggleAutoTrimHotkeyEnabled(bool enabled) {
-    if (m_settings.toggleAutoTrimHotkeyEnabled == enabled) {
-        return;
-    }
-    m_settings.toggleAutoTrimHotkeyEnabled = enabled;
-    persistSettings();
-    emit stateChanged();
+    updateSetting(&Settings::toggleAutoTrimHotkeyEnabled, enabled);
 }
 
 void ClipboardWatcher::setPasteTrimmedHotkey(const QString &sequence) {
-    if (m_settings.pasteTrimmedHotkey == sequence) {
-        return;
-    }
-    m_settings.pasteTrimmedHotkey = sequence;
-    persistSettings();
-    emit stateChanged();
+    updateSetting(&Settings::pasteTrimmedHotkey, sequence);
 }
 
 void ClipboardWatcher::setPasteOriginalHotkey(const QString &sequence) {
-    if (m_settings.pasteOriginalHotkey == sequence) {
-        return;
-    }
-    m_settings.pasteOriginalHotkey = sequence;
-    persistSettings();
-    emit stateChanged();
+    updateSetting(&Settings::pasteOriginalHotkey, sequence);
 }
 
 void ClipboardWatcher::setToggleAutoTrimHotkey(const QString &sequence) {
-    if (m_settings.toggleAutoTrimHotkey == sequence) {
-        return;
-    }
-    m_settings.toggleAutoTrimHotkey = sequence;
-    persistSettings();
-    emit stateChanged();
+    updateSetting(&Settings::toggleAutoTrimHotkey, sequence);
+}
+
+void ClipboardWatcher::setShowStatisticsMenu(bool enabled) {
+    updateSetting(&Settings::showStatisticsMenu, enabled);
+}
+
+void ClipboardWatcher::resetMetrics() {
+    m_counters = WatcherCounters();
+    m_metrics.reset();
+}
+
+void ClipboardWatcher::recordStall(const QString &stage, qint64 durationMs, qint64 payloadSize) {
+    m_metrics.recordStall(stage, durationMs, payloadSize);
 }
 
 void ClipboardWatcher::onClipboardHistoryUpdated() {
@@ -194,28 +157,67 @@ void ClipboardWatcher::onClipboardHistoryUpdated() {
         return;
     }
 
+    m_counters.events += 1;
     m_gen += 1;
     m_pendingGen = m_gen;
+    EventLog::record(EventLog::Kind::ClipboardEvent, static_cast<qint64>(m_gen));
     m_debounce.start();
+    if (autoTrimEnabled()) {
+        scheduleCoreWarmup();
+    }
 }
 
 void ClipboardWatcher::onDebounceTimeout() {
     process(m_pendingGen);
 }
 
+void ClipboardWatcher::scheduleCoreWarmup() {
+    if (!m_core || m_core->isReady() || m_core->loadFailed() || m_warmupScheduled) {
+        return;
+    }
+    // Compile inside the debounce grace window; events that arrive until the
+    // engine is ready coalesce in the debounce and are trimmed afterwards.
+    m_warmupScheduled = true;
+    QTimer::singleShot(0, this, &ClipboardWatcher::warmCore);
+}
+
+void ClipboardWatcher::warmCore() {
+    m_warmupScheduled = false;
+    if (!m_core || m_core->isReady()) {
+        return;
+    }
+    QString error;
+    if (!m_core->ensureLoaded(&error)) {
+        qCCritical(lcCore).noquote() << "[trimmeh-kde]" << error;
+    }
+}
+
 void ClipboardWatcher::process(quint64 genAtSchedule) {
     if (!m_enabled || genAtSchedule != m_pendingGen) {
         return;
     }
+    m_counters.processed += 1;
 
     QString error;
-    const QString text = readClipboardText(&error);
+    QString text;
+    QElapsedTimer stageClock;
+    {
+        AllocAccounting::Scope stage(AllocAccounting::Stage::Read);
+        stageClock.start();
+        text = readClipboardText(&error);
+        const qint64 readNs = stageClock.nsecsElapsed();
+        m_metrics.recordLatency(MetricsRegistry::Stage::Read, readNs);
+        EventLog::record(EventLog::Kind::Read, text.size(), readNs / 1000);
+    }
     if (!error.isEmpty()) {
-        qWarning().noquote() << "[trimmeh-kde]" << error;
+        m_counters.errors += 1;
+        qCWarning(lcBridge).noquote() << "[trimmeh-kde]" << error;
         return;
     }
 
     if (!m_enabled || genAtSchedule != m_pendingGen) {
+        m_counters.staleWritesAvoided += 1;
+        EventLog::record(EventLog::Kind::StaleResult, static_cast<qint64>(genAtSchedule));
         return;
     }
 
@@ -223,49 +225,74 @@ void ClipboardWatcher::process(quint64 genAtSchedule) {
         return;
     }
 
-    const QString incomingHash = hashText(text);
-    if (!m_lastWrittenHash.isEmpty() && incomingHash == m_lastWrittenHash) {
-        m_lastWrittenHash.clear();
-        return;
-    }
+    {
+        AllocAccounting::Scope stage(AllocAccounting::Stage::Guard);
+        const QByteArray incomingHash = hashText(text);
+        if (!m_lastWrittenHash.isEmpty() && incomingHash == m_lastWrittenHash) {
+            m_counters.selfWritesIgnored += 1;
+            EventLog::record(EventLog::Kind::SelfWriteIgnored);
+            m_lastWrittenHash.clear();
+            return;
+        }
 
-    if (shouldIgnoreRestoreGuard(incomingHash)) {
-        return;
+        if (shouldIgnoreRestoreGuard(incomingHash)) {
+            m_counters.restoreGuardHits += 1;
+            EventLog::record(EventLog::Kind::RestoreGuardHit);
+            return;
+        }
     }
 
-    if (!m_settings.autoTrimEnabled) {
+    const SettingsSnapshotPtr snapshot = m_settings.current();
+    if (!snapshot->settings.autoTrimEnabled) {
         return;
     }
 
-    TrimOptions options;
-    options.keepBlankLines = m_settings.keepBlankLines;
-    options.stripBoxChars = m_settings.stripBoxChars;
-    options.trimPrompts = m_settings.trimPrompts;
-    options.maxLines = m_settings.maxLines;
-
-    TrimResult result = m_core->trim(text, m_settings.aggressiveness, options, &error);
+    TrimResult result;
+    {
+        AllocAccounting::Scope stage(AllocAccounting::Stage::Trim);
+        stageClock.restart();
+        result = m_core->trim(text, snapshot->aggressiveness, snapshot->trimOptions, &error);
+        const qint64 trimNs = stageClock.nsecsElapsed();
+        m_metrics.recordLatency(MetricsRegistry::Stage::Trim, trimNs);
+        EventLog::record(EventLog::Kind::Trim, result.changed ? 1 : 0, trimNs / 1000);
+    }
     if (!error.isEmpty()) {
-        qWarning().noquote() << "[trimmeh-kde] trim error:" << error;
+        m_counters.errors += 1;
+        qCWarning(lcCore).noquote() << "[trimmeh-kde] trim error:" << error;
         return;
     }
 
     if (!result.changed) {
+        m_counters.unchanged += 1;
+        if (result.reason == QLatin1String(kSkippedTooLargeReason)) {
+            m_metrics.recordSkippedTooLarge();
+        }
         return;
     }
 
     if (!m_enabled || genAtSchedule != m_pendingGen) {
+        m_counters.staleWritesAvoided += 1;
+        EventLog::record(EventLog::Kind::StaleResult, static_cast<qint64>(genAtSchedule));
         return;
     }
 
+    AllocAccounting::Scope stage(AllocAccounting::Stage::Write);
     m_lastOriginal = text;
     m_lastTrimmed = result.output;
     updateSummary(result.output);
     m_lastWrittenHash = hashText(result.output);
 
-    if (!m_bridge->setClipboardText(result.output, &error)) {
-        qWarning().noquote() << "[trimmeh-kde]" << error;
+    stageClock.restart();
+    const bool written = m_bridge->setClipboardText(result.output, &error);
+    m_metrics.recordLatency(MetricsRegistry::Stage::Write, stageClock.nsecsElapsed());
+    EventLog::record(EventLog::Kind::Write, result.output.size(), written ? 1 : 0);
+    if (!written) {
+        m_counters.errors += 1;
+        qCWarning(lcBridge).noquote() << "[trimmeh-kde]" << error;
     } else {
-        qInfo().noquote() << "[trimmeh-kde] trimmed" << result.reason;
+        m_counters.trims += 1;
+        m_metrics.recordTrim(result.reason);
+        qCDebug(lcWatcher).noquote() << "[trimmeh-kde] trimmed" << result.reason;
     }
 }
 
@@ -277,7 +304,7 @@ bool ClipboardWatcher::pasteTrimmed() {
     QString error;
     QString source = readClipboardText(&error);
     if (!error.isEmpty()) {
-        qWarning().noquote() << "[trimmeh-kde]" << error;
+        qCWarning(lcBridge).noquote() << "[trimmeh-kde]" << error;
         return false;
     }
     if (source.isEmpty()) {
@@ -285,21 +312,16 @@ bool ClipboardWatcher::pasteTrimmed() {
         return false;
     }
 
-    TrimOptions options;
-    options.keepBlankLines = m_settings.keepBlankLines;
-    options.stripBoxChars = m_settings.stripBoxChars;
-    options.trimPrompts = m_settings.trimPrompts;
-    options.maxLines = m_settings.maxLines;
-
-    TrimResult result = m_core->trim(source, QStringLiteral("high"), options, &error);
+    const SettingsSnapshotPtr snapshot = m_settings.current();
+    TrimResult result = m_core->trim(source, TrimAggressiveness::High, snapshot->trimOptions, &error);
     if (!error.isEmpty()) {
-        qWarning().noquote() << "[trimmeh-kde] trim error:" << error;
+        qCWarning(lcCore).noquote() << "[trimmeh-kde] trim error:" << error;
         return false;
     }
 
     QString previous = readClipboardText(&error);
     if (!error.isEmpty()) {
-        qWarning().noquote() << "[trimmeh-kde]" << error;
+        qCWarning(lcBridge).noquote() << "[trimmeh-kde]" << error;
         return false;
     }
 
@@ -312,14 +334,14 @@ bool ClipboardWatcher::pasteTrimmed() {
 
     const bool swapped = swapClipboardTemporarily(result.output, previous);
     if (swapped && m_injector) {
-        const int delayMs = qMax(0, m_settings.pasteInjectDelayMs);
+        const int delayMs = qMax(0, m_settings.current()->settings.pasteInjectDelayMs);
         QTimer::singleShot(delayMs, this, [this]() {
             if (!m_injector) {
                 return;
             }
             const auto result = m_injector->injectPaste();
             if (result != PortalPasteInjector::PasteResult::Injected) {
-                qInfo() << "[trimmeh-kde] portal inject result" << static_cast<int>(result);
+                qCInfo(lcPortal) << "[trimmeh-kde] portal inject result" << static_cast<int>(result);
             }
             applyPasteHint(result);
         });
@@ -337,7 +359,7 @@ bool ClipboardWatcher::pasteOriginal() {
     QString error;
     const QString current = readClipboardText(&error);
     if (!error.isEmpty()) {
-        qWarning().noquote() << "[trimmeh-kde]" << error;
+        qCWarning(lcBridge).noquote() << "[trimmeh-kde]" << error;
         return false;
     }
 
@@ -351,7 +373,7 @@ bool ClipboardWatcher::pasteOriginal() {
 
     QString previous = readClipboardText(&error);
     if (!error.isEmpty()) {
-        qWarning().noquote() << "[trimmeh-kde]" << error;
+        qCWarning(lcBridge).noquote() << "[trimmeh-kde]" << error;
         return false;
     }
 
@@ -363,14 +385,14 @@ bool ClipboardWatcher::pasteOriginal() {
 
     const bool swapped = swapClipboardTemporarily(original, previous);
     if (swapped && m_injector) {
-        const int delayMs = qMax(0, m_settings.pasteInjectDelayMs);
+        const int delayMs = qMax(0, m_settings.current()->settings.pasteInjectDelayMs);
         QTimer::singleShot(delayMs, this, [this]() {
             if (!m_injector) {
                 return;
             }
             const auto result = m_injector->injectPaste();
             if (result != PortalPasteInjector::PasteResult::Injected) {
-                qInfo() << "[trimmeh-kde] portal inject result" << static_cast<int>(result);
+                qCInfo(lcPortal) << "[trimmeh-kde] portal inject result" << static_cast<int>(result);
             }
             applyPasteHint(result);
         });
@@ -398,7 +420,7 @@ bool ClipboardWatcher::restoreLastCopy() {
     m_lastWrittenHash = hashText(original);
 
     if (!m_bridge->setClipboardText(original, &error)) {
-        qWarning().noquote() << "[trimmeh-kde]" << error;
+        qCWarning(lcBridge).noquote() << "[trimmeh-kde]" << error;
         return false;
     }
 
@@ -433,10 +455,12 @@ QString ClipboardWatcher::ellipsize(const QString &text, int limit) const {
     return text.left(head) + QStringLiteral("...") + text.right(tail);
 }
 
-QString ClipboardWatcher::hashText(const QString &text) const {
-    const QByteArray bytes = text.toUtf8();
-    const QByteArray digest = QCryptographicHash::hash(bytes, QCryptographicHash::Sha256);
-    return QString::fromLatin1(digest.toHex());
+QByteArray ClipboardWatcher::hashText(const QString &text) const {
+    // Hashes the UTF-16 storage as is: the digest never leaves the process,
+    // so there is no reason to transcode every clipboard event to UTF-8.
+    const QByteArray units = QByteArray::fromRawData(reinterpret_cast<const char *>(text.utf16()),
+                                                     text.size() * qsizetype(sizeof(char16_t)));
+    return QCryptographicHash::hash(units, QCryptographicHash::Sha256);
 }
 
 bool ClipboardWatcher::swapClipboardTemporarily(const QString &text, const QString &previous) {
@@ -447,16 +471,18 @@ bool ClipboardWatcher::swapClipboardTemporarily(const QString &text, const QStri
     QString error;
     m_lastWrittenHash = hashText(text);
     if (!m_bridge->setClipboardText(text, &error)) {
-        qWarning().noquote() << "[trimmeh-kde]" << error;
+        qCWarning(lcBridge).noquote() << "[trimmeh-kde]" << error;
         return false;
     }
-    qInfo().noquote() << "[trimmeh-kde] manual swap window" << m_settings.pasteRestoreDelayMs << "ms";
+    const int restoreDelayMs = pasteRestoreDelayMs();
+    EventLog::record(EventLog::Kind::PasteSwap, text.size(), restoreDelayMs);
+    qCDebug(lcWatcher).noquote() << "[trimmeh-kde] manual swap window" << restoreDelayMs << "ms";
 
     if (previous.isEmpty()) {
         return true;
     }
 
-    QTimer::singleShot(m_settings.pasteRestoreDelayMs, this, [this, previous]() {
+    QTimer::singleShot(restoreDelayMs, this, [this, previous]() {
         if (!m_bridge) {
             return;
         }
@@ -464,7 +490,7 @@ bool ClipboardWatcher::swapClipboardTemporarily(const QString &text, const QStri
         setRestoreGuard(previous, 1500);
         m_lastWrittenHash = hashText(previous);
         if (!m_bridge->setClipboardText(previous, &err)) {
-            qWarning().noquote() << "[trimmeh-kde]" << err;
+            qCWarning(lcBridge).noquote() << "[trimmeh-kde]" << err;
         }
     });
 
@@ -475,7 +501,7 @@ void ClipboardWatcher::persistSettings() {
     if (!m_store) {
         return;
     }
-    m_store->save(m_settings);
+    m_store->save(m_settings.current()->settings);
 }
 
 void ClipboardWatcher::setRestoreGuard(const QString &text, int durationMs) {
@@ -484,7 +510,7 @@ void ClipboardWatcher::setRestoreGuard(const QString &text, int durationMs) {
     m_restoreGuardExpiresMs = nowMs + qMax(0, durationMs);
 }
 
-bool ClipboardWatcher::shouldIgnoreRestoreGuard(const QString &hash) {
+bool ClipboardWatcher::shouldIgnoreRestoreGuard(const QByteArray &hash) {
     if (m_restoreGuardHash.isEmpty() || m_restoreGuardExpiresMs == 0) {
         return false;
     }
@@ -530,7 +556,7 @@ QString ClipboardWatcher::readClipboardText(QString *errorMessage) const {
         return text;
     }
 
-    if (!m_settings.useClipboardFallbacks) {
+    if (!useClipboardFallbacks()) {
         return text;
     }
 
@@ -538,6 +564,11 @@ QString ClipboardWatcher::readClipboardText(QString *errorMessage) const {
 }
 
 QString ClipboardWatcher::fallbackClipboardText() const {
+    // trimmeh-kded --no-hotkeys runs on a QCoreApplication, which has no
+    // QClipboard; Klipper is the only source there.
+    if (!qobject_cast<QGuiApplication *>(QCoreApplication::instance())) {
+        return QString();
+    }
     QClipboard *clipboard = QGuiApplication::clipboard();
     if (!clipboard) {
         return QString();
@@ -552,6 +583,7 @@ QString ClipboardWatcher::fallbackClipboardText() const {
     QString htmlSubtype = QStringLiteral("html");
     QString html = clipboard->text(htmlSubtype, QClipboard::Clipboard);
     if (!html.isEmpty()) {
+        StallWatchdog::Scope stage(StallWatchdog::Stage::RichText, html.size());
         QTextDocument doc;
         doc.setHtml(html);
         return doc.toPlainText();
@@ -1,16 +1,36 @@
 #pragma once
 
 #include "klipper_bridge.h"
+#include "metrics_registry.h"
 #include "portal_paste_injector.h"
 #include "settings.h"
+#include "settings_snapshot.h"
 #include "trim_core.h"
 
+#include <QByteArray>
 #include <QObject>
 #include <QTimer>
 
 class SettingsStore;
 class AutostartManager;
 
+// Cumulative event accounting, used by the replay harness and diagnostics.
+struct WatcherCounters {
+    quint64 events = 0;
+    quint64 processed = 0;
+    quint64 trims = 0;
+    quint64 unchanged = 0;
+    quint64 selfWritesIgnored = 0;
+    quint64 restoreGuardHits = 0;
+    // A newer event arrived while an older one was being read or trimmed, so
+    // the older result was not written back.
+    quint64 staleWritesAvoided = 0;
+    quint64 errors = 0;
+
+    // Events folded into a later one by the debounce window.
+    quint64 coalesced() const { return events > processed ? events - processed : 0; }
+};
+
 class ClipboardWatcher : public QObject {
     Q_OBJECT
 public:
@@ -22,29 +42,37 @@ public:
                      PortalPasteInjector *injector = nullptr,
                      QObject *parent = nullptr);
 
-    bool autoTrimEnabled() const { return m_settings.autoTrimEnabled; }
+    // Safe to call from any thread; the snapshot is immutable.
+    SettingsSnapshotPtr settingsSnapshot() const { return m_settings.current(); }
+
+    bool autoTrimEnabled() const { return m_settings.current()->settings.autoTrimEnabled; }
     void setAutoTrimEnabled(bool enabled);
 
-    bool keepBlankLines() const { return m_settings.keepBlankLines; }
-    bool stripBoxChars() const { return m_settings.stripBoxChars; }
-    bool trimPrompts() const { return m_settings.trimPrompts; }
-    bool useClipboardFallbacks() const { return m_settings.useClipboardFallbacks; }
-    int maxLines() const { return m_settings.maxLines; }
-    QString aggressiveness() const { return m_settings.aggressiveness; }
-    bool startAtLogin() const { return m_settings.startAtLogin; }
-    int pasteRestoreDelayMs() const { return m_settings.pasteRestoreDelayMs; }
-    bool pasteTrimmedHotkeyEnabled() const { return m_settings.pasteTrimmedHotkeyEnabled; }
-    bool pasteOriginalHotkeyEnabled() const { return m_settings.pasteOriginalHotkeyEnabled; }
-    bool toggleAutoTrimHotkeyEnabled() const { return m_settings.toggleAutoTrimHotkeyEnabled; }
-    QString pasteTrimmedHotkey() const { return m_settings.pasteTrimmedHotkey; }
-    QString pasteOriginalHotkey() const { return m_settings.pasteOriginalHotkey; }
-    QString toggleAutoTrimHotkey() const { return m_settings.toggleAutoTrimHotkey; }
+    bool keepBlankLines() const { return m_settings.current()->settings.keepBlankLines; }
+    bool stripBoxChars() const { return m_settings.current()->settings.stripBoxChars; }
+    bool trimPrompts() const { return m_settings.current()->settings.trimPrompts; }
+    bool useClipboardFallbacks() const { return m_settings.current()->settings.useClipboardFallbacks; }
+    int maxLines() const { return m_settings.current()->settings.maxLines; }
+    bool largeSnippets() const { return m_settings.current()->settings.largeSnippets; }
+    QStringList extraCommandPrefixes() const { return m_settings.current()->settings.extraCommandPrefixes; }
+    QString aggressiveness() const { return m_settings.current()->settings.aggressiveness; }
+    bool startAtLogin() const { return m_settings.current()->settings.startAtLogin; }
+    int pasteRestoreDelayMs() const { return m_settings.current()->settings.pasteRestoreDelayMs; }
+    bool pasteTrimmedHotkeyEnabled() const { return m_settings.current()->settings.pasteTrimmedHotkeyEnabled; }
+    bool pasteOriginalHotkeyEnabled() const { return m_settings.current()->settings.pasteOriginalHotkeyEnabled; }
+    bool toggleAutoTrimHotkeyEnabled() const { return m_settings.current()->settings.toggleAutoTrimHotkeyEnabled; }
+    QString pasteTrimmedHotkey() const { return m_settings.current()->settings.pasteTrimmedHotkey; }
+    QString pasteOriginalHotkey() const { return m_settings.current()->settings.pasteOriginalHotkey; }
+    QString toggleAutoTrimHotkey() const { return m_settings.current()->settings.toggleAutoTrimHotkey; }
+    bool showStatisticsMenu() const { return m_settings.current()->settings.showStatisticsMenu; }
 
     void setKeepBlankLines(bool enabled);
     void setStripBoxChars(bool enabled);
     void setTrimPrompts(bool enabled);
     void setUseClipboardFallbacks(bool enabled);
     void setMaxLines(int maxLines);
+    void setLargeSnippets(bool enabled);
+    void setExtraCommandPrefixes(const QStringList &prefixes);
     void setAggressiveness(const QString &level);
     void setStartAtLogin(bool enabled);
     void setPasteRestoreDelayMs(int delayMs);
@@ -54,11 +82,16 @@ public:
     void setPasteTrimmedHotkey(const QString &sequence);
     void setPasteOriginalHotkey(const QString &sequence);
     void setToggleAutoTrimHotkey(const QString &sequence);
+    void setShowStatisticsMenu(bool enabled);
 
     QString lastSummary() const { return m_lastSummary; }
     QString lastOriginal() const { return m_lastOriginal; }
     QString lastTrimmed() const { return m_lastTrimmed; }
     bool hasLastOriginal() const { return !m_lastOriginal.isEmpty(); }
+    const WatcherCounters &counters() const { return m_counters; }
+    const MetricsRegistry &metrics() const { return m_metrics; }
+    void resetMetrics();
+    void recordStall(const QString &stage, qint64 durationMs, qint64 payloadSize);
 
     bool pasteTrimmed();
     bool pasteOriginal();
@@ -73,35 +106,43 @@ signals:
 
 private slots:
     void onDebounceTimeout();
+    void warmCore();
 
 private:
     void process(quint64 genAtSchedule);
+    void scheduleCoreWarmup();
     void updateSummary(const QString &text);
     QString summarize(const QString &text) const;
     QString ellipsize(const QString &text, int limit) const;
-    QString hashText(const QString &text) const;
+    QByteArray hashText(const QString &text) const;
     bool swapClipboardTemporarily(const QString &text, const QString &previous);
+    template <typename T>
+    bool updateSetting(T Settings::*field, const T &value);
     void persistSettings();
     void setRestoreGuard(const QString &text, int durationMs);
-    bool shouldIgnoreRestoreGuard(const QString &hash);
+    bool shouldIgnoreRestoreGuard(const QByteArray &hash);
     void applyPasteHint(PortalPasteInjector::PasteResult result);
     QString readClipboardText(QString *errorMessage = nullptr) const;
     QString fallbackClipboardText() const;
 
     KlipperBridge *m_bridge = nullptr;
     TrimCore *m_core = nullptr;
-    Settings m_settings;
+    SettingsPublisher m_settings;
     SettingsStore *m_store = nullptr;
     AutostartManager *m_autostart = nullptr;
     PortalPasteInjector *m_injector = nullptr;
     QTimer m_debounce;
     quint64 m_gen = 0;
     quint64 m_pendingGen = 0;
-    QString m_lastWrittenHash;
-    QString m_restoreGuardHash;
+    bool m_warmupScheduled = false;
+    // Raw SHA-256 digests, only ever compared with each other.
+    QByteArray m_lastWrittenHash;
+    QByteArray m_restoreGuardHash;
     qint64 m_restoreGuardExpiresMs = 0;
     QString m_lastOriginal;
     QString m_lastTrimmed;
     QString m_lastSummary;
+    WatcherCounters m_counters;
+    MetricsRegistry m_metrics;
     bool m_enabled = true;
 };
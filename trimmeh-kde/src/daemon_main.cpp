@@ -0,0 +1,74 @@
+#include "app_identity.h"
+#include "app_startup.h"
+#include "startup_profile.h"
+
+#include <QCommandLineParser>
+#include <QCoreApplication>
+#include <QGuiApplication>
+
+#include <cstring>
+#include <memory>
+
+namespace {
+// QCommandLineParser needs the application object, and the flag decides
+// which one to create, so it is looked up by hand first.
+bool hasNoHotkeysFlag(int argc, char **argv) {
+    for (int i = 1; i < argc; ++i) {
+        if (std::strcmp(argv[i], "--no-hotkeys") == 0 || std::strcmp(argv[i], "-no-hotkeys") == 0) {
+            return true;
+        }
+    }
+    return false;
+}
+}
+
+// Headless variant of trimmeh-kde: same clipboard pipeline and settings, no
+// tray icon, no preferences dialog and no QtWidgets. KGlobalAccel's QActions
+// and the QClipboard fallback need a QGuiApplication; with --no-hotkeys the
+// daemon runs on a QCoreApplication and needs no display at all.
+int main(int argc, char **argv) {
+    StartupProfile profile;
+    const bool gui = !hasNoHotkeysFlag(argc, argv);
+    std::unique_ptr<QCoreApplication> appHolder;
+    {
+        StartupProfile::Phase phase(&profile, gui ? QStringLiteral("qguiapplication")
+                                                  : QStringLiteral("qcoreapplication"));
+        if (gui) {
+            QGuiApplication::setDesktopFileName(AppIdentity::appId());
+            appHolder = std::make_unique<QGuiApplication>(argc, argv);
+            QGuiApplication::setQuitOnLastWindowClosed(false);
+        } else {
+            appHolder = std::make_unique<QCoreApplication>(argc, argv);
+        }
+    }
+    QCoreApplication &app = *appHolder;
+    QCoreApplication::setOrganizationName("Trimmeh");
+    QCoreApplication::setOrganizationDomain("trimmeh.dev");
+    // Shares the trimmeh-kde settings file so the tray app can configure it.
+    QCoreApplication::setApplicationName("trimmeh-kde");
+    QCoreApplication::setApplicationVersion("0.0.1");
+
+    QCommandLineParser parser;
+    parser.setApplicationDescription("Trimmeh KDE headless daemon (Klipper D-Bus auto-trim, no tray)");
+    parser.addHelpOption();
+    parser.addVersionOption();
+    QCommandLineOption profileOpt("startup-profile", "Print a per-phase startup timing table.");
+    parser.addOption(profileOpt);
+    QCommandLineOption exitOpt("exit-after-startup", "Quit once startup has settled (for footprint measurements).");
+    parser.addOption(exitOpt);
+    QCommandLineOption stallOpt("stall-threshold-ms",
+                                "Log event-loop stalls longer than this (default 250, 0 disables).",
+                                "ms", "250");
+    parser.addOption(stallOpt);
+    QCommandLineOption noHotkeysOpt("no-hotkeys", "Do not register global shortcuts or the portal paste injector; runs without a display.");
+    parser.addOption(noHotkeysOpt);
+    parser.process(app);
+    profile.setEnabled(parser.isSet(profileOpt));
+
+    AppStartup::Config config;
+    config.hotkeys = !parser.isSet(noHotkeysOpt);
+    config.manageAutostart = false;
+    config.exitAfterStartup = parser.isSet(exitOpt);
+    config.stallThresholdMs = qMax(0, parser.value(stallOpt).toInt());
+    return AppStartup::run(app, profile, config);
+}
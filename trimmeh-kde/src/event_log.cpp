@@ -0,0 +1,238 @@
+#include "event_log.h"
+
+#include <QElapsedTimer>
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <cstring>
+
+namespace {
+constexpr int kTextBytes = 160;
+constexpr char kCategoryPrefix[] = "trimmeh.";
+
+// Seqlock slot: seq is odd while a writer fills it and 2 * ticket + 2 once
+// the entry for that ticket is complete.
+struct Slot {
+    std::atomic<quint64> seq{0};
+    qint64 timeNs = 0;
+    qint64 a = 0;
+    qint64 b = 0;
+    const char *category = nullptr;
+    quint8 kind = 0;
+    quint8 level = 0;
+    quint8 textLength = 0;
+    char text[kTextBytes];
+};
+
+struct Entry {
+    qint64 timeNs = 0;
+    qint64 a = 0;
+    qint64 b = 0;
+    const char *category = nullptr;
+    EventLog::Kind kind = EventLog::Kind::Message;
+    QtMsgType level = QtInfoMsg;
+    QByteArray text;
+};
+
+std::array<Slot, EventLog::kCapacity> g_slots;
+std::atomic<quint64> g_head{0};
+QtMessageHandler g_previousHandler = nullptr;
+
+qint64 nowNs() {
+    static const QElapsedTimer timer = []() {
+        QElapsedTimer started;
+        started.start();
+        return started;
+    }();
+    return timer.nsecsElapsed();
+}
+
+Slot &claim(quint64 *ticket) {
+    *ticket = g_head.fetch_add(1, std::memory_order_relaxed);
+    Slot &slot = g_slots[*ticket % EventLog::kCapacity];
+    slot.seq.store(2 * *ticket + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    return slot;
+}
+
+void publish(Slot &slot, quint64 ticket) {
+    slot.seq.store(2 * ticket + 2, std::memory_order_release);
+}
+
+bool readSlot(quint64 ticket, Entry *entry) {
+    const Slot &slot = g_slots[ticket % EventLog::kCapacity];
+    const quint64 expected = 2 * ticket + 2;
+    if (slot.seq.load(std::memory_order_acquire) != expected) {
+        return false;
+    }
+    entry->timeNs = slot.timeNs;
+    entry->a = slot.a;
+    entry->b = slot.b;
+    entry->category = slot.category;
+    entry->kind = static_cast<EventLog::Kind>(slot.kind);
+    entry->level = static_cast<QtMsgType>(slot.level);
+    entry->text = QByteArray(slot.text, std::min<int>(slot.textLength, kTextBytes));
+    std::atomic_thread_fence(std::memory_order_acquire);
+    // Overwritten by a later ticket while copying.
+    return slot.seq.load(std::memory_order_relaxed) == expected;
+}
+
+// Encodes `text` as UTF-8 straight into `out`, stopping before the first
+// character that does not fit; lone surrogates become U+FFFD as in
+// QString::toUtf8(). Returns the bytes written.
+int encodeUtf8(const QString &text, char *out, int capacity) {
+    const QChar *chars = text.constData();
+    const qsizetype size = text.size();
+    int length = 0;
+    for (qsizetype i = 0; i < size; ++i) {
+        char32_t code = chars[i].unicode();
+        if (QChar::isHighSurrogate(code) && i + 1 < size && chars[i + 1].isLowSurrogate()) {
+            code = QChar::surrogateToUcs4(static_cast<char16_t>(code), chars[i + 1].unicode());
+            i += 1;
+        } else if (QChar::isSurrogate(code)) {
+            code = QChar::ReplacementCharacter;
+        }
+        const int bytes = code < 0x80 ? 1 : code < 0x800 ? 2 : code < 0x10000 ? 3 : 4;
+        if (length + bytes > capacity) {
+            break;
+        }
+        char *p = out + length;
+        switch (bytes) {
+        case 1:
+            p[0] = static_cast<char>(code);
+            break;
+        case 2:
+            p[0] = static_cast<char>(0xc0 | (code >> 6));
+            p[1] = static_cast<char>(0x80 | (code & 0x3f));
+            break;
+        case 3:
+            p[0] = static_cast<char>(0xe0 | (code >> 12));
+            p[1] = static_cast<char>(0x80 | ((code >> 6) & 0x3f));
+            p[2] = static_cast<char>(0x80 | (code & 0x3f));
+            break;
+        default:
+            p[0] = static_cast<char>(0xf0 | (code >> 18));
+            p[1] = static_cast<char>(0x80 | ((code >> 12) & 0x3f));
+            p[2] = static_cast<char>(0x80 | ((code >> 6) & 0x3f));
+            p[3] = static_cast<char>(0x80 | (code & 0x3f));
+            break;
+        }
+        length += bytes;
+    }
+    return length;
+}
+
+const char *kindName(EventLog::Kind kind) {
+    switch (kind) {
+    case EventLog::Kind::Message:
+        return "message";
+    case EventLog::Kind::ClipboardEvent:
+        return "clipboard-event";
+    case EventLog::Kind::Read:
+        return "read";
+    case EventLog::Kind::SelfWriteIgnored:
+        return "self-write-ignored";
+    case EventLog::Kind::RestoreGuardHit:
+        return "restore-guard-hit";
+    case EventLog::Kind::StaleResult:
+        return "stale-result";
+    case EventLog::Kind::Trim:
+        return "trim";
+    case EventLog::Kind::Write:
+        return "write";
+    case EventLog::Kind::PasteSwap:
+        return "paste-swap";
+    case EventLog::Kind::Stall:
+        return "stall";
+    }
+    return "unknown";
+}
+
+const char *levelName(QtMsgType type) {
+    switch (type) {
+    case QtDebugMsg:
+        return "debug";
+    case QtInfoMsg:
+        return "info";
+    case QtWarningMsg:
+        return "warning";
+    case QtCriticalMsg:
+        return "critical";
+    case QtFatalMsg:
+        return "fatal";
+    }
+    return "info";
+}
+
+QString formatEntry(const Entry &entry) {
+    const QString time = QString::number(static_cast<double>(entry.timeNs) / 1000000.0, 'f', 3);
+    if (entry.kind == EventLog::Kind::Message) {
+        return QStringLiteral("+%1ms %2 %3: %4")
+            .arg(time,
+                 QString::fromLatin1(entry.category ? entry.category : "default"),
+                 QString::fromLatin1(levelName(entry.level)),
+                 QString::fromUtf8(entry.text));
+    }
+    return QStringLiteral("+%1ms event %2 a=%3 b=%4")
+        .arg(time, QString::fromLatin1(kindName(entry.kind)))
+        .arg(entry.a)
+        .arg(entry.b);
+}
+
+void messageHandler(QtMsgType type, const QMessageLogContext &context, const QString &message) {
+    if (context.category && std::strncmp(context.category, kCategoryPrefix, sizeof(kCategoryPrefix) - 1) == 0) {
+        EventLog::recordMessage(type, context.category, message);
+    }
+    if (g_previousHandler) {
+        g_previousHandler(type, context, message);
+    }
+}
+}
+
+namespace EventLog {
+void record(Kind kind, qint64 a, qint64 b) {
+    quint64 ticket = 0;
+    Slot &slot = claim(&ticket);
+    slot.timeNs = nowNs();
+    slot.a = a;
+    slot.b = b;
+    slot.category = nullptr;
+    slot.kind = static_cast<quint8>(kind);
+    slot.level = static_cast<quint8>(QtInfoMsg);
+    slot.textLength = 0;
+    publish(slot, ticket);
+}
+
+void recordMessage(QtMsgType type, const char *category, const QString &message) {
+    quint64 ticket = 0;
+    Slot &slot = claim(&ticket);
+    slot.timeNs = nowNs();
+    slot.a = 0;
+    slot.b = 0;
+    // Category names are string literals owned by the static QLoggingCategory.
+    slot.category = category;
+    slot.kind = static_cast<quint8>(Kind::Message);
+    slot.level = static_cast<quint8>(type);
+    slot.textLength = static_cast<quint8>(encodeUtf8(message, slot.text, kTextBytes));
+    publish(slot, ticket);
+}
+
+void installMessageHandler() {
+    g_previousHandler = qInstallMessageHandler(messageHandler);
+}
+
+QStringList dump() {
+    const quint64 head = g_head.load(std::memory_order_acquire);
+    const quint64 first = head > static_cast<quint64>(kCapacity) ? head - kCapacity : 0;
+    QStringList lines;
+    lines.reserve(static_cast<int>(head - first));
+    for (quint64 ticket = first; ticket < head; ++ticket) {
+        Entry entry;
+        if (readSlot(ticket, &entry)) {
+            lines.append(formatEntry(entry));
+        }
+    }
+    return lines;
+}
+} // namespace EventLog
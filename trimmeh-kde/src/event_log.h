@@ -0,0 +1,36 @@
+#pragma once
+
+#include <QString>
+#include <QStringList>
+
+// Fixed-size in-memory record of recent pipeline events and trimmeh.* log
+// messages, kept so a trace is available after a problem without running
+// with debug logging. Writers claim a slot with one atomic increment and
+// never block or allocate; the oldest entries are overwritten.
+namespace EventLog {
+constexpr int kCapacity = 512;
+
+enum class Kind : quint8 {
+    Message,
+    ClipboardEvent,   // a = generation
+    Read,             // a = characters, b = latency us
+    SelfWriteIgnored,
+    RestoreGuardHit,
+    StaleResult,      // a = generation
+    Trim,             // a = changed, b = latency us
+    Write,            // a = characters, b = succeeded
+    PasteSwap,        // a = characters, b = restore delay ms
+    Stall,            // a = duration ms, b = payload size
+};
+
+void record(Kind kind, qint64 a = 0, qint64 b = 0);
+// Messages longer than the slot are truncated at a character boundary.
+void recordMessage(QtMsgType type, const char *category, const QString &message);
+
+// Routes trimmeh.* messages into the log before the previous handler prints
+// them. Call once, after the application object exists.
+void installMessageHandler();
+
+// Oldest first; one line per entry with its time since process start.
+QStringList dump();
+} // namespace EventLog
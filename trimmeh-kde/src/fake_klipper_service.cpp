@@ -0,0 +1,86 @@
+#include "fake_klipper_service.h"
+
+#include <QDBusConnection>
+#include <QDBusConnectionInterface>
+#include <QDBusError>
+#include <QDBusMessage>
+#include <QTimer>
+
+namespace {
+constexpr const char kService[] = "org.kde.klipper";
+constexpr const char kPath[] = "/klipper";
+}
+
+FakeKlipperService::FakeKlipperService(QObject *parent)
+    : QObject(parent) {
+}
+
+bool FakeKlipperService::registerOnBus(QString *errorMessage) {
+    QDBusConnection bus = QDBusConnection::sessionBus();
+    if (!bus.isConnected()) {
+        if (errorMessage) {
+            *errorMessage = QStringLiteral("Failed to connect to session bus: %1")
+                                .arg(bus.lastError().message());
+        }
+        return false;
+    }
+    if (bus.interface() && bus.interface()->isServiceRegistered(QString::fromLatin1(kService))) {
+        if (errorMessage) {
+            *errorMessage = QStringLiteral("%1 is already registered; run on a private bus (dbus-run-session)")
+                                .arg(QString::fromLatin1(kService));
+        }
+        return false;
+    }
+    if (!bus.registerObject(QString::fromLatin1(kPath), this,
+                            QDBusConnection::ExportAllSlots | QDBusConnection::ExportAllSignals)) {
+        if (errorMessage) {
+            *errorMessage = QStringLiteral("Failed to export %1: %2")
+                                .arg(QString::fromLatin1(kPath), bus.lastError().message());
+        }
+        return false;
+    }
+    if (!bus.registerService(QString::fromLatin1(kService))) {
+        if (errorMessage) {
+            *errorMessage = QStringLiteral("Failed to register %1: %2")
+                                .arg(QString::fromLatin1(kService), bus.lastError().message());
+        }
+        return false;
+    }
+    return true;
+}
+
+void FakeKlipperService::userCopy(const QString &text) {
+    m_contents = text;
+    emit clipboardHistoryUpdated();
+}
+
+QString FakeKlipperService::getClipboardContents() {
+    if (m_latencyMs <= 0 || !calledFromDBus()) {
+        return m_contents;
+    }
+    setDelayedReply(true);
+    const QDBusMessage request = message();
+    QTimer::singleShot(m_latencyMs, this, [this, request]() {
+        QDBusConnection::sessionBus().send(request.createReply(m_contents));
+    });
+    return QString();
+}
+
+void FakeKlipperService::setClipboardContents(const QString &text) {
+    if (m_latencyMs <= 0 || !calledFromDBus()) {
+        applyWrite(text);
+        return;
+    }
+    setDelayedReply(true);
+    const QDBusMessage request = message();
+    QTimer::singleShot(m_latencyMs, this, [this, request, text]() {
+        applyWrite(text);
+        QDBusConnection::sessionBus().send(request.createReply());
+    });
+}
+
+void FakeKlipperService::applyWrite(const QString &text) {
+    m_contents = text;
+    emit contentsWritten(text);
+    emit clipboardHistoryUpdated();
+}
@@ -0,0 +1,40 @@
+#pragma once
+
+#include <QDBusContext>
+#include <QObject>
+#include <QString>
+
+// Minimal stand-in for org.kde.klipper: same object path, interface, methods
+// and signal as the subset KlipperBridge uses. Meant for a private session
+// bus (dbus-run-session), never for a real Plasma session.
+class FakeKlipperService : public QObject, protected QDBusContext {
+    Q_OBJECT
+    Q_CLASSINFO("D-Bus Interface", "org.kde.klipper.klipper")
+public:
+    explicit FakeKlipperService(QObject *parent = nullptr);
+
+    bool registerOnBus(QString *errorMessage = nullptr);
+
+    // Artificial delay before each D-Bus reply (and before a set takes effect).
+    void setLatencyMs(int latencyMs) { m_latencyMs = latencyMs; }
+    int latencyMs() const { return m_latencyMs; }
+
+    QString contents() const { return m_contents; }
+    // A copy by the user: replaces the contents and announces it.
+    void userCopy(const QString &text);
+
+public slots:
+    QString getClipboardContents();
+    void setClipboardContents(const QString &text);
+
+signals:
+    void clipboardHistoryUpdated();
+    // Emitted when a D-Bus client (the app under test) writes the clipboard.
+    void contentsWritten(const QString &text);
+
+private:
+    void applyWrite(const QString &text);
+
+    QString m_contents;
+    int m_latencyMs = 0;
+};
@@ -1,5 +1,7 @@
 #include "klipper_bridge.h"
 
+#include "stall_watchdog.h"
+
 #include <QDBusConnectionInterface>
 #include <QDBusError>
 #include <QDBusReply>
@@ -90,6 +92,7 @@ QString KlipperBridge::getClipboardText(QString *errorMessage) {
         return QString();
     }
 
+    StallWatchdog::Scope stage(StallWatchdog::Stage::KlipperRead);
     QDBusReply<QString> reply = m_iface->call(QString::fromLatin1(kMethodGet));
     if (!reply.isValid()) {
         if (errorMessage) {
@@ -109,6 +112,7 @@ bool KlipperBridge::setClipboardText(const QString &text, QString *errorMessage)
         return false;
     }
 
+    StallWatchdog::Scope stage(StallWatchdog::Stage::KlipperWrite, text.size());
     QDBusReply<void> reply = m_iface->call(QString::fromLatin1(kMethodSet), text);
     if (!reply.isValid()) {
         if (errorMessage) {
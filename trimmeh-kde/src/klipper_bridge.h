@@ -9,11 +9,13 @@
 class KlipperBridge {
 public:
     KlipperBridge();
+    virtual ~KlipperBridge() = default;
     bool init(QString *errorMessage = nullptr);
     bool connectClipboardSignal(QObject *receiver, const char *slot, QString *errorMessage = nullptr);
 
-    QString getClipboardText(QString *errorMessage = nullptr);
-    bool setClipboardText(const QString &text, QString *errorMessage = nullptr);
+    // Virtual so the replay harness can stand in for Klipper.
+    virtual QString getClipboardText(QString *errorMessage = nullptr);
+    virtual bool setClipboardText(const QString &text, QString *errorMessage = nullptr);
 
 private:
     QDBusConnection m_bus;
@@ -0,0 +1,269 @@
+#include "fake_klipper_service.h"
+
+#include <QCommandLineParser>
+#include <QCoreApplication>
+#include <QDBusConnection>
+#include <QDBusConnectionInterface>
+#include <QElapsedTimer>
+#include <QEventLoop>
+#include <QProcess>
+#include <QTextStream>
+#include <QTimer>
+#include <QVector>
+
+#include <algorithm>
+#include <functional>
+#include <numeric>
+
+namespace {
+constexpr const char kAppService[] = "dev.trimmeh.TrimmehKDE";
+constexpr int kReadyTimeoutMs = 15000;
+
+// Every sample is rewritten by the default settings, so each copy should
+// produce exactly one write-back. %1 keeps consecutive copies distinct.
+const char *const kSamples[] = {
+    "kubectl get pods \\\n  --namespace ns-%1 \\\n  -o wide",
+    "$ echo run-%1 \\\n    && ls -la",
+    "│ git commit -m \"fix %1\"   │\n│   --amend                  │",
+};
+
+QString sample(int index) {
+    const int count = static_cast<int>(sizeof(kSamples) / sizeof(kSamples[0]));
+    return QString::fromUtf8(kSamples[index % count]).arg(index);
+}
+
+// Runs the event loop until `done` returns true or `timeoutMs` passes.
+bool waitUntil(const std::function<bool()> &done, int timeoutMs) {
+    QElapsedTimer timer;
+    timer.start();
+    while (!done()) {
+        const qint64 left = timeoutMs - timer.elapsed();
+        if (left <= 0) {
+            return false;
+        }
+        QEventLoop loop;
+        QTimer::singleShot(static_cast<int>(std::min<qint64>(left, 5)), &loop, &QEventLoop::quit);
+        loop.exec();
+    }
+    return true;
+}
+
+void pause(int ms) {
+    QEventLoop loop;
+    QTimer::singleShot(ms, &loop, &QEventLoop::quit);
+    loop.exec();
+}
+
+QString formatMs(qint64 ns) {
+    return QString::number(static_cast<double>(ns) / 1e6, 'f', 2);
+}
+
+qint64 percentile(const QVector<qint64> &sorted, double p) {
+    if (sorted.isEmpty()) {
+        return 0;
+    }
+    const int index = std::min(static_cast<int>(p * (sorted.size() - 1) + 0.5), static_cast<int>(sorted.size() - 1));
+    return sorted.at(index);
+}
+
+int intOption(const QCommandLineParser &parser, const QCommandLineOption &option, int fallback) {
+    return parser.isSet(option) ? parser.value(option).toInt() : fallback;
+}
+}
+
+int main(int argc, char **argv) {
+    QCoreApplication app(argc, argv);
+    QCoreApplication::setApplicationName(QStringLiteral("trimmeh-kde-loadtest"));
+    QCoreApplication::setApplicationVersion(QStringLiteral("0.0.1"));
+
+    QCommandLineParser parser;
+    parser.setApplicationDescription(QStringLiteral(
+        "Runs a fake Klipper on the session bus and measures trim latency and throughput "
+        "of trimmeh-kde/trimmeh-kded against it. Use a private bus (dbus-run-session)."));
+    parser.addHelpOption();
+    parser.addVersionOption();
+    QCommandLineOption daemonOpt(QStringLiteral("daemon"),
+                                 QStringLiteral("Start this trimmeh-kded binary (otherwise wait for one to connect)"),
+                                 QStringLiteral("path"));
+    QCommandLineOption latencyOpt(QStringLiteral("latency-ms"),
+                                  QStringLiteral("Artificial delay for every fake Klipper reply (default: 0)"),
+                                  QStringLiteral("ms"));
+    QCommandLineOption iterationsOpt(QStringLiteral("iterations"),
+                                     QStringLiteral("Isolated copies to time (default: 50)"),
+                                     QStringLiteral("n"));
+    QCommandLineOption gapOpt(QStringLiteral("gap-ms"),
+                              QStringLiteral("Pause after each isolated copy's write-back (default: 200)"),
+                              QStringLiteral("ms"));
+    QCommandLineOption burstsOpt(QStringLiteral("bursts"),
+                                 QStringLiteral("Number of copy bursts (default: 5)"),
+                                 QStringLiteral("n"));
+    QCommandLineOption burstSizeOpt(QStringLiteral("burst-size"),
+                                    QStringLiteral("Copies per burst (default: 20)"),
+                                    QStringLiteral("n"));
+    QCommandLineOption burstIntervalOpt(QStringLiteral("burst-interval-ms"),
+                                        QStringLiteral("Delay between copies in a burst (default: 5)"),
+                                        QStringLiteral("ms"));
+    QCommandLineOption timeoutOpt(QStringLiteral("timeout-ms"),
+                                  QStringLiteral("How long to wait for a write-back (default: 3000)"),
+                                  QStringLiteral("ms"));
+    QCommandLineOption maxP95Opt(QStringLiteral("max-p95-ms"),
+                                 QStringLiteral("Fail if the p95 copy-to-write latency exceeds this"),
+                                 QStringLiteral("ms"));
+    QCommandLineOption verboseOpt(QStringLiteral("verbose"), QStringLiteral("Show the daemon's output"));
+    parser.addOption(daemonOpt);
+    parser.addOption(latencyOpt);
+    parser.addOption(iterationsOpt);
+    parser.addOption(gapOpt);
+    parser.addOption(burstsOpt);
+    parser.addOption(burstSizeOpt);
+    parser.addOption(burstIntervalOpt);
+    parser.addOption(timeoutOpt);
+    parser.addOption(maxP95Opt);
+    parser.addOption(verboseOpt);
+    parser.process(app);
+
+    QTextStream out(stdout);
+    QTextStream err(stderr);
+
+    const int iterations = intOption(parser, iterationsOpt, 50);
+    const int gapMs = intOption(parser, gapOpt, 200);
+    const int bursts = intOption(parser, burstsOpt, 5);
+    const int burstSize = intOption(parser, burstSizeOpt, 20);
+    const int burstIntervalMs = intOption(parser, burstIntervalOpt, 5);
+    const int timeoutMs = intOption(parser, timeoutOpt, 3000);
+
+    FakeKlipperService klipper;
+    klipper.setLatencyMs(intOption(parser, latencyOpt, 0));
+    QString error;
+    if (!klipper.registerOnBus(&error)) {
+        err << error << "\n";
+        return 2;
+    }
+
+    QElapsedTimer clock;
+    clock.start();
+    QVector<qint64> writeTimesNs;
+    QObject::connect(&klipper, &FakeKlipperService::contentsWritten, &app, [&]() {
+        writeTimesNs.append(clock.nsecsElapsed());
+    });
+
+    QProcess daemon;
+    if (parser.isSet(daemonOpt)) {
+        daemon.setProcessChannelMode(parser.isSet(verboseOpt) ? QProcess::ForwardedChannels
+                                                              : QProcess::SeparateChannels);
+        daemon.start(parser.value(daemonOpt), QStringList() << QStringLiteral("--no-hotkeys"));
+        if (!daemon.waitForStarted()) {
+            err << "Failed to start " << parser.value(daemonOpt) << ": " << daemon.errorString() << "\n";
+            return 3;
+        }
+    } else {
+        err << "Waiting for trimmeh-kde or trimmeh-kded on this bus...\n";
+        err.flush();
+    }
+
+    QDBusConnectionInterface *busIface = QDBusConnection::sessionBus().interface();
+    const bool ready = waitUntil([&]() {
+        return busIface->isServiceRegistered(QString::fromLatin1(kAppService)).value()
+            || (parser.isSet(daemonOpt) && daemon.state() == QProcess::NotRunning);
+    }, kReadyTimeoutMs);
+    if (!ready || !busIface->isServiceRegistered(QString::fromLatin1(kAppService)).value()) {
+        err << "trimmeh-kde did not come up on the bus\n";
+        if (parser.isSet(daemonOpt)) {
+            err << daemon.readAllStandardError();
+        }
+        return 4;
+    }
+
+    int copyIndex = 0;
+    // Copies one sample and waits for the app's write-back. Returns the
+    // copy-to-write latency, or -1 on timeout.
+    auto timedCopy = [&]() -> qint64 {
+        const int before = writeTimesNs.size();
+        const qint64 copiedNs = clock.nsecsElapsed();
+        klipper.userCopy(sample(copyIndex++));
+        if (!waitUntil([&]() { return writeTimesNs.size() > before; }, timeoutMs)) {
+            return -1;
+        }
+        return writeTimesNs.at(before) - copiedNs;
+    };
+
+    // The first copy also pays for compiling the trim engine.
+    const qint64 warmupNs = timedCopy();
+    if (warmupNs < 0) {
+        err << "No write-back for the warm-up copy within " << timeoutMs << " ms\n";
+        return 5;
+    }
+    pause(gapMs);
+
+    QVector<qint64> latencies;
+    int timeouts = 0;
+    for (int i = 0; i < iterations; ++i) {
+        const qint64 latencyNs = timedCopy();
+        if (latencyNs < 0) {
+            timeouts += 1;
+        } else {
+            latencies.append(latencyNs);
+        }
+        pause(gapMs);
+    }
+
+    // Bursts faster than the debounce window should coalesce into one
+    // write-back of the last copy.
+    int burstWrites = 0;
+    for (int b = 0; b < bursts; ++b) {
+        const int before = writeTimesNs.size();
+        for (int i = 0; i < burstSize; ++i) {
+            klipper.userCopy(sample(copyIndex++));
+            pause(burstIntervalMs);
+        }
+        waitUntil([&]() { return writeTimesNs.size() > before; }, timeoutMs);
+        pause(gapMs);
+        burstWrites += writeTimesNs.size() - before;
+    }
+
+    std::sort(latencies.begin(), latencies.end());
+    const qint64 p95 = percentile(latencies, 0.95);
+    out << "Fake Klipper latency: " << klipper.latencyMs() << " ms\n";
+    out << "Warm-up copy (includes engine load): " << formatMs(warmupNs) << " ms\n";
+    out << "Isolated copies: " << latencies.size() << "/" << iterations << " written back";
+    if (!latencies.isEmpty()) {
+        out << "; latency ms min " << formatMs(latencies.first())
+            << ", p50 " << formatMs(percentile(latencies, 0.5))
+            << ", p95 " << formatMs(p95)
+            << ", max " << formatMs(latencies.last());
+    }
+    out << "\n";
+    if (!latencies.isEmpty()) {
+        // Mean service time, copy to write-back; the --gap-ms pauses between
+        // copies are not part of it.
+        const double meanNs = static_cast<double>(std::accumulate(latencies.cbegin(), latencies.cend(), qint64(0)))
+            / static_cast<double>(latencies.size());
+        out << "  mean service time: " << formatMs(static_cast<qint64>(meanNs)) << " ms ("
+            << QString::number(1e9 / meanNs, 'f', 1) << " copies/s one at a time)\n";
+    }
+    out << "Bursts: " << bursts << " x " << burstSize << " copies every " << burstIntervalMs
+        << " ms -> " << burstWrites << " write-backs\n";
+    out.flush();
+
+    if (parser.isSet(daemonOpt)) {
+        daemon.terminate();
+        if (!daemon.waitForFinished(3000)) {
+            daemon.kill();
+            daemon.waitForFinished();
+        }
+    }
+
+    if (burstWrites != bursts) {
+        err << bursts << " bursts caused " << burstWrites << " write-backs; each should coalesce into one\n";
+        return 1;
+    }
+    if (timeouts > 0) {
+        err << timeouts << " copies were not written back within " << timeoutMs << " ms\n";
+        return 1;
+    }
+    if (parser.isSet(maxP95Opt) && p95 > static_cast<qint64>(parser.value(maxP95Opt).toInt()) * 1000000) {
+        err << "p95 latency " << formatMs(p95) << " ms exceeds --max-p95-ms " << parser.value(maxP95Opt) << "\n";
+        return 1;
+    }
+    return 0;
+}
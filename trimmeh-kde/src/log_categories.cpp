@@ -0,0 +1,8 @@
+#include "log_categories.h"
+
+Q_LOGGING_CATEGORY(lcApp, "trimmeh.app", QtInfoMsg)
+Q_LOGGING_CATEGORY(lcBridge, "trimmeh.bridge", QtInfoMsg)
+Q_LOGGING_CATEGORY(lcWatcher, "trimmeh.watcher", QtInfoMsg)
+Q_LOGGING_CATEGORY(lcCore, "trimmeh.core", QtInfoMsg)
+Q_LOGGING_CATEGORY(lcPortal, "trimmeh.portal", QtInfoMsg)
+Q_LOGGING_CATEGORY(lcSettings, "trimmeh.settings", QtInfoMsg)
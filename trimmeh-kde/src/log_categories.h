@@ -0,0 +1,12 @@
+#pragma once
+
+#include <QLoggingCategory>
+
+// Debug output is off by default; enable it per area with e.g.
+// QT_LOGGING_RULES="trimmeh.watcher.debug=true".
+Q_DECLARE_LOGGING_CATEGORY(lcApp)
+Q_DECLARE_LOGGING_CATEGORY(lcBridge)
+Q_DECLARE_LOGGING_CATEGORY(lcWatcher)
+Q_DECLARE_LOGGING_CATEGORY(lcCore)
+Q_DECLARE_LOGGING_CATEGORY(lcPortal)
+Q_DECLARE_LOGGING_CATEGORY(lcSettings)
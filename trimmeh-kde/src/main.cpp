@@ -6,8 +6,13 @@
 #include <QDBusError>
 #include <QDBusInterface>
 #include <QDBusReply>
+#include <QCryptographicHash>
 #include <QDebug>
+#include <QElapsedTimer>
+#include <QFile>
 #include <QIODevice>
+#include <QJsonDocument>
+#include <QJsonObject>
 #include <QTextStream>
 
 namespace {
@@ -31,6 +36,20 @@ public:
     {
     }
 
+    // Appends one JSON line per clipboardHistoryUpdated to `path`:
+    // {"t_ms": <monotonic ms since start>, "size": <utf-8 bytes>,
+    //  "sha256": "...", "text": "..."}. `text` is left out with hashOnly.
+    bool startRecording(const QString &path, bool hashOnly) {
+        m_trace.setFileName(path);
+        if (!m_trace.open(QIODevice::WriteOnly | QIODevice::Truncate | QIODevice::Text)) {
+            qCritical().noquote() << "[klipper] Failed to open trace file:" << path << m_trace.errorString();
+            return false;
+        }
+        m_traceHashOnly = hashOnly;
+        m_traceClock.start();
+        return true;
+    }
+
     bool isInterfaceValid() const {
         return m_iface.isValid();
     }
@@ -66,11 +85,44 @@ public:
 
 public slots:
     void onClipboardHistoryUpdated() {
+        if (m_trace.isOpen()) {
+            recordEvent();
+            return;
+        }
         printClipboard("signal");
     }
 
 private:
+    void recordEvent() {
+        // Timestamp the signal, not the reply, so traces keep the burst timing.
+        const double tMs = static_cast<double>(m_traceClock.nsecsElapsed()) / 1e6;
+        QDBusReply<QString> reply = m_iface.call(QString::fromLatin1(kMethodGet));
+        if (!reply.isValid()) {
+            qWarning() << "[klipper] getClipboardContents failed:" << reply.error().name()
+                       << reply.error().message();
+            return;
+        }
+        const QByteArray utf8 = reply.value().toUtf8();
+        QJsonObject event;
+        event.insert(QStringLiteral("t_ms"), tMs);
+        event.insert(QStringLiteral("size"), utf8.size());
+        event.insert(QStringLiteral("sha256"), QString::fromLatin1(
+            QCryptographicHash::hash(utf8, QCryptographicHash::Sha256).toHex()));
+        if (!m_traceHashOnly) {
+            event.insert(QStringLiteral("text"), reply.value());
+        }
+        m_trace.write(QJsonDocument(event).toJson(QJsonDocument::Compact));
+        m_trace.write("\n");
+        m_trace.flush();
+        m_traceEvents += 1;
+        qInfo().noquote() << "[klipper] recorded event" << m_traceEvents << "(" << utf8.size() << "bytes)";
+    }
+
     QDBusInterface m_iface;
+    QFile m_trace;
+    QElapsedTimer m_traceClock;
+    bool m_traceHashOnly = false;
+    int m_traceEvents = 0;
 };
 
 int main(int argc, char **argv) {
@@ -95,6 +147,12 @@ int main(int argc, char **argv) {
     QCommandLineOption setStdinOpt("set-stdin", "Read stdin and set clipboard via Klipper, then exit.");
     parser.addOption(setStdinOpt);
 
+    QCommandLineOption recordOpt("record", "Record clipboard events as a JSON-lines trace for trimmeh-kde-replay.", "file");
+    parser.addOption(recordOpt);
+
+    QCommandLineOption hashOnlyOpt("hash-only", "With --record, store sizes and hashes instead of clipboard text.");
+    parser.addOption(hashOnlyOpt);
+
     parser.process(app);
 
     if (parser.isSet(setOpt) && parser.isSet(setStdinOpt)) {
@@ -143,7 +201,11 @@ int main(int argc, char **argv) {
         return 0;
     }
 
-    if (!parser.isSet(noInitialOpt)) {
+    if (parser.isSet(recordOpt)) {
+        if (!probe.startRecording(parser.value(recordOpt), parser.isSet(hashOnlyOpt))) {
+            return 7;
+        }
+    } else if (!parser.isSet(noInitialOpt)) {
         probe.printClipboard("initial");
     }
 
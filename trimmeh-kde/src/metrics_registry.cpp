@@ -0,0 +1,106 @@
+#include "metrics_registry.h"
+
+#include <algorithm>
+
+void LatencyHistogram::record(qint64 ns) {
+    const qint64 us = std::max<qint64>(0, ns / 1000);
+    int bucket = 0;
+    while (bucket < kBuckets - 1 && us >= (qint64(1) << bucket)) {
+        bucket += 1;
+    }
+    m_buckets[bucket] += 1;
+    m_count += 1;
+    m_totalNs += ns;
+    m_maxNs = std::max(m_maxNs, ns);
+}
+
+void LatencyHistogram::reset() {
+    m_buckets.fill(0);
+    m_count = 0;
+    m_totalNs = 0;
+    m_maxNs = 0;
+}
+
+double LatencyHistogram::meanUs() const {
+    return m_count > 0 ? static_cast<double>(m_totalNs) / 1000.0 / static_cast<double>(m_count) : 0.0;
+}
+
+qint64 LatencyHistogram::percentileUs(double p) const {
+    if (m_count == 0) {
+        return 0;
+    }
+    const quint64 rank = static_cast<quint64>(p * static_cast<double>(m_count - 1)) + 1;
+    quint64 seen = 0;
+    for (int i = 0; i < kBuckets; ++i) {
+        seen += m_buckets[i];
+        if (seen >= rank) {
+            // The last bucket is open-ended; report the observed maximum.
+            return i == kBuckets - 1 ? m_maxNs / 1000 : std::min(qint64(1) << i, m_maxNs / 1000 + 1);
+        }
+    }
+    return m_maxNs / 1000;
+}
+
+QVariantMap LatencyHistogram::toVariantMap() const {
+    QVariantMap map;
+    map.insert(QStringLiteral("count"), static_cast<qulonglong>(m_count));
+    map.insert(QStringLiteral("mean_us"), meanUs());
+    map.insert(QStringLiteral("p50_us"), percentileUs(0.50));
+    map.insert(QStringLiteral("p95_us"), percentileUs(0.95));
+    map.insert(QStringLiteral("p99_us"), percentileUs(0.99));
+    map.insert(QStringLiteral("max_us"), m_maxNs / 1000);
+    return map;
+}
+
+void MetricsRegistry::recordLatency(Stage stage, qint64 ns) {
+    switch (stage) {
+    case Stage::Read:
+        m_read.record(ns);
+        break;
+    case Stage::Trim:
+        m_trim.record(ns);
+        break;
+    case Stage::Write:
+        m_write.record(ns);
+        break;
+    }
+}
+
+void MetricsRegistry::recordTrim(const QString &reason) {
+    m_trimsByReason[reason.isEmpty() ? QStringLiteral("unknown") : reason] += 1;
+}
+
+void MetricsRegistry::recordStall(const QString &stage, qint64 durationMs, qint64 payloadSize) {
+    m_stallCount += 1;
+    m_maxStallMs = std::max(m_maxStallMs, durationMs);
+    m_lastStallStage = stage;
+    m_lastStallMs = durationMs;
+    m_lastStallPayload = payloadSize;
+    m_stallsByStage[stage] += 1;
+}
+
+void MetricsRegistry::reset() {
+    m_read.reset();
+    m_trim.reset();
+    m_write.reset();
+    m_trimsByReason.clear();
+    m_skippedTooLarge = 0;
+    m_stallCount = 0;
+    m_maxStallMs = 0;
+    m_lastStallStage.clear();
+    m_lastStallMs = 0;
+    m_lastStallPayload = -1;
+    m_stallsByStage.clear();
+}
+
+const LatencyHistogram &MetricsRegistry::latency(Stage stage) const {
+    switch (stage) {
+    case Stage::Read:
+        return m_read;
+    case Stage::Trim:
+        return m_trim;
+    case Stage::Write:
+        break;
+    }
+    return m_write;
+}
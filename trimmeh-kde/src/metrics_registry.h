@@ -0,0 +1,72 @@
+#pragma once
+
+#include <QHash>
+#include <QString>
+#include <QVariantMap>
+
+#include <array>
+
+// Log2-bucketed latency histogram. Bucket i holds samples below 2^i us, so
+// percentiles are upper bounds within a factor of two; that is enough to
+// tell a 1 ms trim from a 100 ms one on a user's machine.
+class LatencyHistogram {
+public:
+    static constexpr int kBuckets = 24;
+
+    void record(qint64 ns);
+    void reset();
+
+    quint64 count() const { return m_count; }
+    qint64 maxNs() const { return m_maxNs; }
+    double meanUs() const;
+    // Upper bound of the bucket holding the p-th sample, in microseconds.
+    qint64 percentileUs(double p) const;
+    // {count, mean_us, p50_us, p95_us, p99_us, max_us}
+    QVariantMap toVariantMap() const;
+
+private:
+    std::array<quint64, kBuckets> m_buckets{};
+    quint64 m_count = 0;
+    qint64 m_totalNs = 0;
+    qint64 m_maxNs = 0;
+};
+
+// Pipeline metrics kept by ClipboardWatcher for D-Bus and the tray. Event
+// counts live in WatcherCounters; this adds what those cannot express.
+class MetricsRegistry {
+public:
+    enum class Stage {
+        Read,
+        Trim,
+        Write,
+    };
+
+    void recordLatency(Stage stage, qint64 ns);
+    void recordTrim(const QString &reason);
+    void recordSkippedTooLarge() { m_skippedTooLarge += 1; }
+    void recordStall(const QString &stage, qint64 durationMs, qint64 payloadSize);
+    void reset();
+
+    const LatencyHistogram &latency(Stage stage) const;
+    const QHash<QString, quint64> &trimsByReason() const { return m_trimsByReason; }
+    quint64 skippedTooLarge() const { return m_skippedTooLarge; }
+    quint64 stallCount() const { return m_stallCount; }
+    qint64 maxStallMs() const { return m_maxStallMs; }
+    QString lastStallStage() const { return m_lastStallStage; }
+    qint64 lastStallMs() const { return m_lastStallMs; }
+    qint64 lastStallPayload() const { return m_lastStallPayload; }
+    const QHash<QString, quint64> &stallsByStage() const { return m_stallsByStage; }
+
+private:
+    LatencyHistogram m_read;
+    LatencyHistogram m_trim;
+    LatencyHistogram m_write;
+    QHash<QString, quint64> m_trimsByReason;
+    quint64 m_skippedTooLarge = 0;
+    quint64 m_stallCount = 0;
+    qint64 m_maxStallMs = 0;
+    QString m_lastStallStage;
+    qint64 m_lastStallMs = 0;
+    qint64 m_lastStallPayload = -1;
+    QHash<QString, quint64> m_stallsByStage;
+};
@@ -0,0 +1,115 @@
+#include "metrics_service.h"
+
+#include "clipboard_watcher.h"
+#include "event_log.h"
+
+#include <QDBusConnection>
+#include <QDBusError>
+
+namespace {
+constexpr const char kPath[] = "/Metrics";
+}
+
+MetricsService::MetricsService(ClipboardWatcher *watcher, QObject *parent)
+    : QObject(parent)
+    , m_watcher(watcher) {
+}
+
+bool MetricsService::registerOnBus(QString *errorMessage) {
+    QDBusConnection bus = QDBusConnection::sessionBus();
+    if (!bus.isConnected()) {
+        if (errorMessage) {
+            *errorMessage = QStringLiteral("Failed to connect to session bus: %1")
+                                .arg(bus.lastError().message());
+        }
+        return false;
+    }
+
+    if (!bus.registerObject(QString::fromLatin1(kPath), this,
+                            QDBusConnection::ExportAllSlots | QDBusConnection::ExportAllProperties)) {
+        if (errorMessage) {
+            *errorMessage = QStringLiteral("Failed to export %1: %2")
+                                .arg(QString::fromLatin1(kPath), bus.lastError().message());
+        }
+        return false;
+    }
+    return true;
+}
+
+qulonglong MetricsService::events() const {
+    return m_watcher->counters().events;
+}
+
+qulonglong MetricsService::coalesced() const {
+    return m_watcher->counters().coalesced();
+}
+
+qulonglong MetricsService::selfWritesIgnored() const {
+    return m_watcher->counters().selfWritesIgnored;
+}
+
+qulonglong MetricsService::restoreGuardHits() const {
+    return m_watcher->counters().restoreGuardHits;
+}
+
+qulonglong MetricsService::skippedTooLarge() const {
+    return m_watcher->metrics().skippedTooLarge();
+}
+
+qulonglong MetricsService::trims() const {
+    return m_watcher->counters().trims;
+}
+
+qulonglong MetricsService::errors() const {
+    return m_watcher->counters().errors;
+}
+
+QVariantMap MetricsService::trimsByReason() const {
+    QVariantMap map;
+    const QHash<QString, quint64> &reasons = m_watcher->metrics().trimsByReason();
+    for (auto it = reasons.cbegin(); it != reasons.cend(); ++it) {
+        map.insert(it.key(), static_cast<qulonglong>(it.value()));
+    }
+    return map;
+}
+
+QVariantMap MetricsService::readLatency() const {
+    return m_watcher->metrics().latency(MetricsRegistry::Stage::Read).toVariantMap();
+}
+
+QVariantMap MetricsService::trimLatency() const {
+    return m_watcher->metrics().latency(MetricsRegistry::Stage::Trim).toVariantMap();
+}
+
+QVariantMap MetricsService::writeLatency() const {
+    return m_watcher->metrics().latency(MetricsRegistry::Stage::Write).toVariantMap();
+}
+
+qulonglong MetricsService::stallCount() const {
+    return m_watcher->metrics().stallCount();
+}
+
+QVariantMap MetricsService::stalls() const {
+    const MetricsRegistry &metrics = m_watcher->metrics();
+    QVariantMap byStage;
+    const QHash<QString, quint64> &stages = metrics.stallsByStage();
+    for (auto it = stages.cbegin(); it != stages.cend(); ++it) {
+        byStage.insert(it.key(), static_cast<qulonglong>(it.value()));
+    }
+    QVariantMap map;
+    map.insert(QStringLiteral("count"), static_cast<qulonglong>(metrics.stallCount()));
+    map.insert(QStringLiteral("max_ms"), metrics.maxStallMs());
+    map.insert(QStringLiteral("last_stage"), metrics.lastStallStage());
+    map.insert(QStringLiteral("last_ms"), metrics.lastStallMs());
+    map.insert(QStringLiteral("last_payload"), metrics.lastStallPayload());
+    map.insert(QStringLiteral("by_stage"), byStage);
+    return map;
+}
+
+void MetricsService::Reset() {
+    m_watcher->resetMetrics();
+}
+
+QStringList MetricsService::DumpEvents() {
+    return EventLog::dump();
+}
@@ -0,0 +1,57 @@
+#pragma once
+
+#include <QObject>
+#include <QStringList>
+#include <QVariantMap>
+
+class ClipboardWatcher;
+
+// Read-only view of the clipboard pipeline metrics on the session bus, next to
+// the trim service on the app's well-known name.
+//
+// Path: /Metrics, interface: dev.trimmeh.TrimmehKDE.Metrics
+class MetricsService : public QObject {
+    Q_OBJECT
+    Q_CLASSINFO("D-Bus Interface", "dev.trimmeh.TrimmehKDE.Metrics")
+    Q_PROPERTY(qulonglong Events READ events)
+    Q_PROPERTY(qulonglong Coalesced READ coalesced)
+    Q_PROPERTY(qulonglong SelfWritesIgnored READ selfWritesIgnored)
+    Q_PROPERTY(qulonglong RestoreGuardHits READ restoreGuardHits)
+    Q_PROPERTY(qulonglong SkippedTooLarge READ skippedTooLarge)
+    Q_PROPERTY(qulonglong Trims READ trims)
+    Q_PROPERTY(qulonglong Errors READ errors)
+    Q_PROPERTY(QVariantMap TrimsByReason READ trimsByReason)
+    Q_PROPERTY(QVariantMap ReadLatency READ readLatency)
+    Q_PROPERTY(QVariantMap TrimLatency READ trimLatency)
+    Q_PROPERTY(QVariantMap WriteLatency READ writeLatency)
+    Q_PROPERTY(qulonglong StallCount READ stallCount)
+    Q_PROPERTY(QVariantMap Stalls READ stalls)
+public:
+    explicit MetricsService(ClipboardWatcher *watcher, QObject *parent = nullptr);
+
+    bool registerOnBus(QString *errorMessage = nullptr);
+
+    qulonglong events() const;
+    qulonglong coalesced() const;
+    qulonglong selfWritesIgnored() const;
+    qulonglong restoreGuardHits() const;
+    qulonglong skippedTooLarge() const;
+    qulonglong trims() const;
+    qulonglong errors() const;
+    QVariantMap trimsByReason() const;
+    // {count, mean_us, p50_us, p95_us, p99_us, max_us}
+    QVariantMap readLatency() const;
+    QVariantMap trimLatency() const;
+    QVariantMap writeLatency() const;
+    qulonglong stallCount() const;
+    // {count, max_ms, last_stage, last_ms, last_payload, by_stage}
+    QVariantMap stalls() const;
+
+public slots:
+    void Reset();
+    // Recent pipeline events and trimmeh.* log lines, oldest first.
+    QStringList DumpEvents();
+
+private:
+    ClipboardWatcher *m_watcher = nullptr;
+};
@@ -1,6 +1,8 @@
 #include "portal_paste_injector.h"
 
 #include "app_identity.h"
+#include "log_categories.h"
+#include "stall_watchdog.h"
 
 #include <QDBusConnectionInterface>
 #include <QDBusObjectPath>
@@ -91,11 +93,15 @@ private:
 PortalPasteInjector::PortalPasteInjector(QObject *parent)
     : QObject(parent)
     , m_bus(QDBusConnection::sessionBus())
-    , m_iface(QString::fromLatin1(kPortalService),
-              QString::fromLatin1(kPortalPath),
-              QString::fromLatin1(kRemoteDesktopIface),
-              m_bus)
 {
+}
+
+void PortalPasteInjector::start() {
+    if (m_started) {
+        return;
+    }
+    m_started = true;
+
     if (!m_bus.isConnected()) {
         updateState(State::Unavailable,
                     QStringLiteral("Failed to connect to session bus: %1").arg(m_bus.lastError().message()));
@@ -109,9 +115,13 @@ PortalPasteInjector::PortalPasteInjector(QObject *parent)
         return;
     }
 
-    if (!m_iface.isValid()) {
+    m_iface = std::make_unique<QDBusInterface>(QString::fromLatin1(kPortalService),
+                                               QString::fromLatin1(kPortalPath),
+                                               QString::fromLatin1(kRemoteDesktopIface),
+                                               m_bus);
+    if (!m_iface->isValid()) {
         updateState(State::Unavailable,
-                    QStringLiteral("RemoteDesktop portal unavailable: %1").arg(m_iface.lastError().message()));
+                    QStringLiteral("RemoteDesktop portal unavailable: %1").arg(m_iface->lastError().message()));
         return;
     }
 
@@ -130,11 +140,11 @@ void PortalPasteInjector::requestPermission() {
     if (m_state == State::Requesting || m_state == State::Ready) {
         return;
     }
-    if (m_state == State::Unavailable) {
+    if (m_state == State::Unavailable || !m_iface) {
         return;
     }
 
-    qInfo() << "[trimmeh-kde] portal permission request started";
+    qCInfo(lcPortal) << "[trimmeh-kde] portal permission request started";
     updateState(State::Requesting);
     clearSession();
     createSession();
@@ -301,9 +311,9 @@ void PortalPasteInjector::updateState(State state, const QString &error) {
     m_lastError = error;
     if (changed) {
         if (m_state == State::Error && !m_lastError.isEmpty()) {
-            qWarning().noquote() << "[trimmeh-kde] portal error:" << m_lastError;
+            qCWarning(lcPortal).noquote() << "[trimmeh-kde] portal error:" << m_lastError;
         } else {
-            qInfo() << "[trimmeh-kde] portal state:" << static_cast<int>(m_state);
+            qCInfo(lcPortal) << "[trimmeh-kde] portal state:" << static_cast<int>(m_state);
         }
     }
     if (changed) {
@@ -342,6 +352,7 @@ void PortalPasteInjector::clearSession() {
                                     m_sessionHandle,
                                     QString::fromLatin1(kSessionIface),
                                     m_bus);
+        StallWatchdog::Scope stage(StallWatchdog::Stage::Portal);
         sessionIface.call(QStringLiteral("Close"));
     }
     m_sessionHandle.clear();
@@ -352,7 +363,7 @@ void PortalPasteInjector::createSession() {
     const QString sessionToken = makeToken(QStringLiteral("trimmeh_session"));
     const QString expectedHandle = makeRequestPath(handleToken);
 
-    qInfo().noquote() << "[trimmeh-kde] portal CreateSession handle" << expectedHandle;
+    qCDebug(lcPortal).noquote() << "[trimmeh-kde] portal CreateSession handle" << expectedHandle;
 
     auto callback = [this](uint response, const QVariantMap &results) {
         handleCreateSessionResponse(response, results);
@@ -369,7 +380,8 @@ void PortalPasteInjector::createSession() {
     options.insert(QStringLiteral("handle_token"), handleToken);
     options.insert(QStringLiteral("session_handle_token"), sessionToken);
 
-    QDBusReply<QDBusObjectPath> reply = m_iface.call(QStringLiteral("CreateSession"), options);
+    StallWatchdog::Scope stage(StallWatchdog::Stage::Portal);
+    QDBusReply<QDBusObjectPath> reply = m_iface->call(QStringLiteral("CreateSession"), options);
     if (!reply.isValid()) {
         watcher->stop();
         updateState(State::Error,
@@ -378,7 +390,7 @@ void PortalPasteInjector::createSession() {
     }
 
     const QString actualHandle = reply.value().path();
-    qInfo().noquote() << "[trimmeh-kde] portal CreateSession reply handle" << actualHandle;
+    qCDebug(lcPortal).noquote() << "[trimmeh-kde] portal CreateSession reply handle" << actualHandle;
     if (!actualHandle.isEmpty() && actualHandle != expectedHandle) {
         watcher->stop();
         watcher = new PortalRequestWatcher(m_bus, actualHandle, callback, this);
@@ -394,7 +406,7 @@ void PortalPasteInjector::selectDevices() {
     const QString handleToken = makeToken(QStringLiteral("trimmeh_select"));
     const QString expectedHandle = makeRequestPath(handleToken);
 
-    qInfo().noquote() << "[trimmeh-kde] portal SelectDevices handle" << expectedHandle;
+    qCDebug(lcPortal).noquote() << "[trimmeh-kde] portal SelectDevices handle" << expectedHandle;
 
     auto callback = [this](uint response, const QVariantMap &results) {
         handleSelectDevicesResponse(response, results);
@@ -416,7 +428,8 @@ void PortalPasteInjector::selectDevices() {
         options.insert(QStringLiteral("restore_token"), token);
     }
 
-    QDBusReply<QDBusObjectPath> reply = m_iface.call(QStringLiteral("SelectDevices"),
+    StallWatchdog::Scope stage(StallWatchdog::Stage::Portal);
+    QDBusReply<QDBusObjectPath> reply = m_iface->call(QStringLiteral("SelectDevices"),
                                                      QDBusObjectPath(m_sessionHandle),
                                                      options);
     if (!reply.isValid()) {
@@ -427,7 +440,7 @@ void PortalPasteInjector::selectDevices() {
     }
 
     const QString actualHandle = reply.value().path();
-    qInfo().noquote() << "[trimmeh-kde] portal SelectDevices reply handle" << actualHandle;
+    qCDebug(lcPortal).noquote() << "[trimmeh-kde] portal SelectDevices reply handle" << actualHandle;
     if (!actualHandle.isEmpty() && actualHandle != expectedHandle) {
         watcher->stop();
         watcher = new PortalRequestWatcher(m_bus, actualHandle, callback, this);
@@ -443,7 +456,7 @@ void PortalPasteInjector::startSession() {
     const QString handleToken = makeToken(QStringLiteral("trimmeh_start"));
     const QString expectedHandle = makeRequestPath(handleToken);
 
-    qInfo().noquote() << "[trimmeh-kde] portal Start handle" << expectedHandle;
+    qCDebug(lcPortal).noquote() << "[trimmeh-kde] portal Start handle" << expectedHandle;
 
     auto callback = [this](uint response, const QVariantMap &results) {
         handleStartResponse(response, results);
@@ -460,7 +473,8 @@ void PortalPasteInjector::startSession() {
     options.insert(QStringLiteral("handle_token"), handleToken);
 
     const QString parentWindow;
-    QDBusReply<QDBusObjectPath> reply = m_iface.call(QStringLiteral("Start"),
+    StallWatchdog::Scope stage(StallWatchdog::Stage::Portal);
+    QDBusReply<QDBusObjectPath> reply = m_iface->call(QStringLiteral("Start"),
                                                      QDBusObjectPath(m_sessionHandle),
                                                      parentWindow,
                                                      options);
@@ -472,7 +486,7 @@ void PortalPasteInjector::startSession() {
     }
 
     const QString actualHandle = reply.value().path();
-    qInfo().noquote() << "[trimmeh-kde] portal Start reply handle" << actualHandle;
+    qCDebug(lcPortal).noquote() << "[trimmeh-kde] portal Start reply handle" << actualHandle;
     if (!actualHandle.isEmpty() && actualHandle != expectedHandle) {
         watcher->stop();
         watcher = new PortalRequestWatcher(m_bus, actualHandle, callback, this);
@@ -485,7 +499,7 @@ void PortalPasteInjector::startSession() {
 }
 
 void PortalPasteInjector::handleCreateSessionResponse(uint response, const QVariantMap &results) {
-    qInfo().noquote() << "[trimmeh-kde] portal CreateSession response" << response;
+    qCInfo(lcPortal).noquote() << "[trimmeh-kde] portal CreateSession response" << response;
     if (response != 0) {
         updateState(State::Denied, QStringLiteral("Portal session request denied."));
         return;
@@ -509,7 +523,7 @@ void PortalPasteInjector::handleCreateSessionResponse(uint response, const QVari
 }
 
 void PortalPasteInjector::handleSelectDevicesResponse(uint response, const QVariantMap &results) {
-    qInfo().noquote() << "[trimmeh-kde] portal SelectDevices response" << response;
+    qCInfo(lcPortal).noquote() << "[trimmeh-kde] portal SelectDevices response" << response;
     if (response != 0) {
         updateState(State::Denied, QStringLiteral("Portal device selection denied."));
         return;
@@ -520,7 +534,7 @@ void PortalPasteInjector::handleSelectDevicesResponse(uint response, const QVari
 }
 
 void PortalPasteInjector::handleStartResponse(uint response, const QVariantMap &results) {
-    qInfo().noquote() << "[trimmeh-kde] portal Start response" << response;
+    qCInfo(lcPortal).noquote() << "[trimmeh-kde] portal Start response" << response;
     if (response != 0) {
         updateState(State::Denied, QStringLiteral("Portal start denied."));
         return;
@@ -547,18 +561,19 @@ void PortalPasteInjector::onSessionClosed(const QVariantMap &details) {
 }
 
 bool PortalPasteInjector::sendKeycode(int keycode, uint state) {
-    if (m_sessionHandle.isEmpty()) {
+    if (m_sessionHandle.isEmpty() || !m_iface) {
         return false;
     }
     QVariantMap options;
-    QDBusReply<void> reply = m_iface.call(QStringLiteral("NotifyKeyboardKeycode"),
+    StallWatchdog::Scope stage(StallWatchdog::Stage::Portal);
+    QDBusReply<void> reply = m_iface->call(QStringLiteral("NotifyKeyboardKeycode"),
                                           QDBusObjectPath(m_sessionHandle),
                                           options,
                                           keycode,
                                           state);
     if (!reply.isValid()) {
         m_lastError = reply.error().message();
-        qWarning().noquote() << "[trimmeh-kde] portal NotifyKeyboardKeycode failed:" << m_lastError;
+        qCWarning(lcPortal).noquote() << "[trimmeh-kde] portal NotifyKeyboardKeycode failed:" << m_lastError;
         return false;
     }
     return true;
@@ -5,6 +5,8 @@
 #include <QDBusInterface>
 #include <QVariantMap>
 
+#include <memory>
+
 class QProcess;
 
 class PortalPasteInjector : public QObject {
@@ -44,6 +46,11 @@ public:
 
     explicit PortalPasteInjector(QObject *parent = nullptr);
 
+    // Probes the portal and checks preauthorization. Kept out of the
+    // constructor because it blocks on D-Bus and spawns flatpak.
+    void start();
+    bool isStarted() const { return m_started; }
+
     State state() const { return m_state; }
     bool isReady() const { return m_state == State::Ready; }
     bool isAvailable() const { return m_state != State::Unavailable; }
@@ -95,7 +102,8 @@ private:
     void saveRestoreToken(const QString &token) const;
 
     QDBusConnection m_bus;
-    QDBusInterface m_iface;
+    std::unique_ptr<QDBusInterface> m_iface;
+    bool m_started = false;
     QString m_sessionHandle;
     State m_state = State::Idle;
     QString m_lastError;
@@ -17,11 +17,13 @@
 #include <QIcon>
 #include <QKeySequenceEdit>
 #include <QLabel>
+#include <QLineEdit>
 #include <QPlainTextEdit>
 #include <QPushButton>
 #include <QProcess>
 #include <QProcessEnvironment>
 #include <QRadioButton>
+#include <QRegularExpression>
 #include <QSignalBlocker>
 #include <QSpinBox>
 #include <QStandardPaths>
@@ -261,6 +263,40 @@ void PreferencesDialog::buildGeneralTab(QTabWidget *tabs) {
         updateAggressivenessPreview();
     });
 
+    auto *maxLinesRow = new QFormLayout();
+    m_maxLines = new QSpinBox(panel);
+    m_maxLines->setRange(1, 1000);
+    m_maxLines->setToolTip(QStringLiteral("Clipboard text with more lines than this is left alone."));
+    connect(m_maxLines, QOverload<int>::of(&QSpinBox::valueChanged), this, [this](int value) {
+        if (m_watcher) {
+            m_watcher->setMaxLines(value);
+        }
+        updateAggressivenessPreview();
+    });
+    maxLinesRow->addRow(QStringLiteral("Maximum lines to process"), m_maxLines);
+
+    m_largeSnippets = new QCheckBox(QStringLiteral("Flatten long continuation chains"), panel);
+    m_largeSnippets->setToolTip(QStringLiteral("Flatten commands whose every line ends in a backslash past 10 lines, up to Maximum lines to process."));
+    connect(m_largeSnippets, &QCheckBox::toggled, this, [this](bool enabled) {
+        if (m_watcher) {
+            m_watcher->setLargeSnippets(enabled);
+        }
+        updateAggressivenessPreview();
+    });
+
+    auto *prefixRow = new QFormLayout();
+    m_extraPrefixes = new QLineEdit(panel);
+    m_extraPrefixes->setPlaceholderText(QStringLiteral("helm terraform"));
+    m_extraPrefixes->setToolTip(QStringLiteral("First words that mark a line as a command, in addition to the built-in list (git, kubectl, ...)."));
+    connect(m_extraPrefixes, &QLineEdit::editingFinished, this, [this]() {
+        if (m_watcher) {
+            m_watcher->setExtraCommandPrefixes(
+                m_extraPrefixes->text().split(QRegularExpression(QStringLiteral("[\\s,]+")), Qt::SkipEmptyParts));
+        }
+        updateAggressivenessPreview();
+    });
+    prefixRow->addRow(QStringLiteral("Extra command words"), m_extraPrefixes);
+
     auto *timingGroup = new QGroupBox(QStringLiteral("Paste timing"), panel);
     auto *timingLayout = new QFormLayout(timingGroup);
     m_restoreDelay = new QSpinBox(timingGroup);
@@ -283,6 +319,14 @@ void PreferencesDialog::buildGeneralTab(QTabWidget *tabs) {
         }
     });
 
+    m_statisticsMenu = new QCheckBox(QStringLiteral("Show statistics in the tray menu"), panel);
+    m_statisticsMenu->setToolTip(QStringLiteral("Adds a Statistics submenu with event counts and pipeline latency."));
+    connect(m_statisticsMenu, &QCheckBox::toggled, this, [this](bool enabled) {
+        if (m_watcher) {
+            m_watcher->setShowStatisticsMenu(enabled);
+        }
+    });
+
     auto *cliGroup = new QGroupBox(QStringLiteral("Command-line tool"), panel);
     auto *cliLayout = new QVBoxLayout(cliGroup);
     auto *cliRow = new QHBoxLayout();
@@ -315,8 +359,12 @@ void PreferencesDialog::buildGeneralTab(QTabWidget *tabs) {
     layout->addWidget(m_keepBlank);
     layout->addWidget(m_stripBox);
     layout->addWidget(m_trimPrompts);
+    layout->addLayout(maxLinesRow);
+    layout->addWidget(m_largeSnippets);
+    layout->addLayout(prefixRow);
     layout->addWidget(timingGroup);
     layout->addWidget(m_clipboardFallbacks);
+    layout->addWidget(m_statisticsMenu);
     layout->addWidget(cliGroup);
     layout->addWidget(m_startAtLogin);
     layout->addStretch(1);
@@ -539,8 +587,15 @@ void PreferencesDialog::refreshFromWatcher() {
     if (m_keepBlank) m_keepBlank->setChecked(m_watcher->keepBlankLines());
     if (m_stripBox) m_stripBox->setChecked(m_watcher->stripBoxChars());
     if (m_trimPrompts) m_trimPrompts->setChecked(m_watcher->trimPrompts());
+    if (m_largeSnippets) m_largeSnippets->setChecked(m_watcher->largeSnippets());
+    if (m_extraPrefixes) m_extraPrefixes->setText(m_watcher->extraCommandPrefixes().join(QLatin1Char(' ')));
     if (m_clipboardFallbacks) m_clipboardFallbacks->setChecked(m_watcher->useClipboardFallbacks());
+    if (m_statisticsMenu) m_statisticsMenu->setChecked(m_watcher->showStatisticsMenu());
     if (m_startAtLogin) m_startAtLogin->setChecked(m_watcher->startAtLogin());
+    if (m_maxLines) {
+        const QSignalBlocker block(m_maxLines);
+        m_maxLines->setValue(m_watcher->maxLines());
+    }
     if (m_restoreDelay) {
         const QSignalBlocker block(m_restoreDelay);
         m_restoreDelay->setValue(m_watcher->pasteRestoreDelayMs());
@@ -845,16 +900,13 @@ QString PreferencesDialog::trimmedPreviewFor(const QString &level) const {
     if (!m_core) {
         return QString();
     }
-    TrimOptions options;
-    if (m_watcher) {
-        options.keepBlankLines = m_watcher->keepBlankLines();
-        options.stripBoxChars = m_watcher->stripBoxChars();
-        options.trimPrompts = m_watcher->trimPrompts();
-        options.maxLines = m_watcher->maxLines();
-    }
+    const TrimOptions options = m_watcher ? m_watcher->settingsSnapshot()->trimOptions : TrimOptions();
 
     QString error;
-    TrimResult result = m_core->trim(sampleForAggressiveness(level), level, options, &error);
+    TrimResult result = m_core->trim(sampleForAggressiveness(level),
+                                     trimAggressivenessFromString(level),
+                                     options,
+                                     &error);
     if (!error.isEmpty()) {
         return QStringLiteral("Error: %1").arg(error);
     }
@@ -11,6 +11,7 @@ class QPlainTextEdit;
 class QRadioButton;
 class QCheckBox;
 class QKeySequenceEdit;
+class QLineEdit;
 class QPushButton;
 class QGroupBox;
 class PortalPasteInjector;
@@ -55,12 +56,16 @@ private:
     QPushButton *m_permissionSettingsButton = nullptr;
     QLabel *m_permissionStatus = nullptr;
     QSpinBox *m_restoreDelay = nullptr;
+    QSpinBox *m_maxLines = nullptr;
 
     QCheckBox *m_autoTrim = nullptr;
     QCheckBox *m_keepBlank = nullptr;
     QCheckBox *m_stripBox = nullptr;
     QCheckBox *m_trimPrompts = nullptr;
+    QCheckBox *m_largeSnippets = nullptr;
+    QLineEdit *m_extraPrefixes = nullptr;
     QCheckBox *m_clipboardFallbacks = nullptr;
+    QCheckBox *m_statisticsMenu = nullptr;
     QCheckBox *m_startAtLogin = nullptr;
     QCheckBox *m_pasteTrimmedHotkeyEnabled = nullptr;
     QCheckBox *m_pasteOriginalHotkeyEnabled = nullptr;
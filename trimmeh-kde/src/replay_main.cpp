@@ -0,0 +1,380 @@
+#include "alloc_accounting.h"
+#include "clipboard_watcher.h"
+#include "klipper_bridge.h"
+#include "settings.h"
+#include "trim_core.h"
+
+#include <QCommandLineParser>
+#include <QCoreApplication>
+#include <QDir>
+#include <QElapsedTimer>
+#include <QFile>
+#include <QFileInfo>
+#include <QHash>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QLoggingCategory>
+#include <QTextStream>
+#include <QTimer>
+#include <QVector>
+
+#include <algorithm>
+#include <cmath>
+
+namespace {
+constexpr int kDefaultEchoMs = 5;
+constexpr int kSettleMs = 500;
+
+struct TraceEvent {
+    double tMs = 0;
+    QString text;
+};
+
+// Reads a trace written by `trimmeh-kde-probe --record`. Hash-only traces
+// carry no text; their events replay as placeholder text of the recorded
+// size, which exercises timing and coalescing but never trims.
+bool loadTrace(const QString &path, QVector<TraceEvent> *events, QString *errorMessage) {
+    QFile file(path);
+    if (!file.open(QIODevice::ReadOnly | QIODevice::Text)) {
+        *errorMessage = QStringLiteral("Failed to open trace: %1").arg(path);
+        return false;
+    }
+    int lineNumber = 0;
+    while (!file.atEnd()) {
+        const QByteArray line = file.readLine().trimmed();
+        lineNumber += 1;
+        if (line.isEmpty()) {
+            continue;
+        }
+        QJsonParseError parseError;
+        const QJsonDocument doc = QJsonDocument::fromJson(line, &parseError);
+        if (parseError.error != QJsonParseError::NoError || !doc.isObject()) {
+            *errorMessage = QStringLiteral("%1:%2: not a trace event").arg(path).arg(lineNumber);
+            return false;
+        }
+        const QJsonObject obj = doc.object();
+        TraceEvent event;
+        event.tMs = obj.value(QStringLiteral("t_ms")).toDouble();
+        if (obj.value(QStringLiteral("text")).isString()) {
+            event.text = obj.value(QStringLiteral("text")).toString();
+        } else {
+            event.text = QString(obj.value(QStringLiteral("size")).toInt(), QLatin1Char('x'));
+        }
+        events->append(event);
+    }
+    std::stable_sort(events->begin(), events->end(), [](const TraceEvent &a, const TraceEvent &b) {
+        return a.tMs < b.tMs;
+    });
+    return true;
+}
+
+// Stands in for Klipper: holds the current clipboard text and, like Klipper,
+// announces every write with clipboardHistoryUpdated after a short delay.
+class FakeKlipperBridge final : public KlipperBridge {
+public:
+    FakeKlipperBridge(const QElapsedTimer *clock, int echoMs)
+        : m_clock(clock)
+        , m_echoMs(echoMs) {
+    }
+
+    void setWatcher(ClipboardWatcher *watcher) { m_watcher = watcher; }
+
+    // A copy by the user: replaces the text and notifies immediately.
+    void userCopy(const QString &text) {
+        m_text = text;
+        m_lastUserCopyNs = m_clock->nsecsElapsed();
+        m_watcher->onClipboardHistoryUpdated();
+    }
+
+    QString getClipboardText(QString *errorMessage = nullptr) override {
+        Q_UNUSED(errorMessage);
+        m_reads += 1;
+        return m_text;
+    }
+
+    bool setClipboardText(const QString &text, QString *errorMessage = nullptr) override {
+        Q_UNUSED(errorMessage);
+        m_text = text;
+        m_writeLatenciesNs.append(m_clock->nsecsElapsed() - m_lastUserCopyNs);
+        QTimer::singleShot(m_echoMs, m_watcher, &ClipboardWatcher::onClipboardHistoryUpdated);
+        return true;
+    }
+
+    int reads() const { return m_reads; }
+    const QVector<qint64> &writeLatenciesNs() const { return m_writeLatenciesNs; }
+
+private:
+    const QElapsedTimer *m_clock = nullptr;
+    ClipboardWatcher *m_watcher = nullptr;
+    int m_echoMs = kDefaultEchoMs;
+    QString m_text;
+    qint64 m_lastUserCopyNs = 0;
+    int m_reads = 0;
+    QVector<qint64> m_writeLatenciesNs;
+};
+
+QString formatMs(qint64 ns) {
+    return QString::number(static_cast<double>(ns) / 1e6, 'f', 2);
+}
+
+// Budget lines are "<stage> <max allocations per processed event>"; '#'
+// starts a comment. Every stage needs a line, so a file that was never
+// measured fails instead of checking nothing.
+bool loadAllocBudget(const QString &path, QHash<QString, double> *budget, QString *errorMessage) {
+    QFile file(path);
+    if (!file.open(QIODevice::ReadOnly | QIODevice::Text)) {
+        *errorMessage = QStringLiteral("Failed to open allocation budget: %1").arg(path);
+        return false;
+    }
+    int lineNumber = 0;
+    while (!file.atEnd()) {
+        lineNumber += 1;
+        const QString line = QString::fromUtf8(file.readLine()).section(QLatin1Char('#'), 0, 0).simplified();
+        if (line.isEmpty()) {
+            continue;
+        }
+        const QStringList fields = line.split(QLatin1Char(' '));
+        bool ok = false;
+        const double limit = fields.size() == 2 ? fields.at(1).toDouble(&ok) : 0.0;
+        if (!ok) {
+            *errorMessage = QStringLiteral("%1:%2: expected '<stage> <allocations>'").arg(path).arg(lineNumber);
+            return false;
+        }
+        budget->insert(fields.at(0), limit);
+    }
+    for (int i = 0; i < static_cast<int>(AllocAccounting::Stage::Count); ++i) {
+        const QString name = QString::fromLatin1(AllocAccounting::stageName(static_cast<AllocAccounting::Stage>(i)));
+        if (!budget->contains(name)) {
+            *errorMessage = QStringLiteral("%1: no measured ceiling for stage '%2'; record one with "
+                                           "--write-alloc-budget").arg(path, name);
+            return false;
+        }
+    }
+    return true;
+}
+
+// Ceilings get this much headroom over the measured run so that small
+// differences between Qt builds do not fail the test.
+constexpr double kAllocBudgetHeadroom = 1.1;
+
+bool writeAllocBudget(const QString &path, const QString &tracePath, const QVector<double> &allocations,
+                      QString *errorMessage) {
+    QFile file(path);
+    if (!file.open(QIODevice::WriteOnly | QIODevice::Truncate | QIODevice::Text)) {
+        *errorMessage = QStringLiteral("Failed to write allocation budget: %1").arg(path);
+        return false;
+    }
+    QTextStream stream(&file);
+    stream << "# Heap allocations per processed clipboard event on the single-line fast path\n"
+           << "# (text is read, hashed, trimmed and left unchanged; nothing is written back).\n"
+           << "# Checked by the alloc_budget_single_line test in TRIMMEH_ALLOC_ACCOUNTING\n"
+           << "# builds. Written by trimmeh-kde-replay --write-alloc-budget from a replay of\n"
+           << "# " << QFileInfo(tracePath).fileName() << " with Qt " << qVersion()
+           << "; each ceiling is the measured value plus 10%.\n"
+           << "# Regenerate instead of editing, and only raise a ceiling with a reason in\n"
+           << "# the commit.\n"
+           << "#\n"
+           << "# stage  max allocations per event\n";
+    for (int i = 0; i < allocations.size(); ++i) {
+        const QString name = QString::fromLatin1(AllocAccounting::stageName(static_cast<AllocAccounting::Stage>(i)));
+        stream << name.leftJustified(8) << std::ceil(allocations.at(i) * kAllocBudgetHeadroom) << "\n";
+    }
+    return true;
+}
+
+qint64 percentile(QVector<qint64> sorted, double p) {
+    if (sorted.isEmpty()) {
+        return 0;
+    }
+    const int index = std::min(static_cast<int>(p * (sorted.size() - 1) + 0.5), static_cast<int>(sorted.size() - 1));
+    return sorted.at(index);
+}
+}
+
+int main(int argc, char **argv) {
+    QCoreApplication app(argc, argv);
+    QCoreApplication::setApplicationName(QStringLiteral("trimmeh-kde-replay"));
+    QCoreApplication::setApplicationVersion(QStringLiteral("0.0.1"));
+
+    QCommandLineParser parser;
+    parser.setApplicationDescription(QStringLiteral("Replays a recorded Klipper trace through ClipboardWatcher"));
+    parser.addHelpOption();
+    parser.addVersionOption();
+    parser.addPositionalArgument(QStringLiteral("trace"), QStringLiteral("Trace from trimmeh-kde-probe --record"));
+    QCommandLineOption coreOpt(QStringList() << QStringLiteral("c") << QStringLiteral("core"),
+                               QStringLiteral("Path to trimmeh-core.js"),
+                               QStringLiteral("path"));
+    QCommandLineOption speedOpt(QStringLiteral("speed"),
+                                QStringLiteral("Replay speed factor; 10 plays the trace ten times faster (default: 1)"),
+                                QStringLiteral("factor"));
+    QCommandLineOption graceOpt(QStringLiteral("grace-ms"),
+                                QStringLiteral("Debounce window to test (default: the app default)"),
+                                QStringLiteral("ms"));
+    QCommandLineOption echoOpt(QStringLiteral("echo-ms"),
+                               QStringLiteral("Delay before a write is echoed back as a clipboard event (default: 5)"),
+                               QStringLiteral("ms"));
+    QCommandLineOption aggressivenessOpt(QStringLiteral("aggressiveness"),
+                                         QStringLiteral("low, normal or high (default: normal)"),
+                                         QStringLiteral("level"));
+    QCommandLineOption quietOpt(QStringLiteral("quiet"), QStringLiteral("Suppress per-event watcher logging"));
+    QCommandLineOption budgetOpt(QStringLiteral("alloc-budget"),
+                                 QStringLiteral("Fail if allocations per processed event exceed this budget file "
+                                                "(needs TRIMMEH_ALLOC_ACCOUNTING)"),
+                                 QStringLiteral("file"));
+    QCommandLineOption writeBudgetOpt(QStringLiteral("write-alloc-budget"),
+                                      QStringLiteral("Write the measured allocations per processed event as a "
+                                                     "budget file (needs TRIMMEH_ALLOC_ACCOUNTING)"),
+                                      QStringLiteral("file"));
+    parser.addOption(coreOpt);
+    parser.addOption(speedOpt);
+    parser.addOption(graceOpt);
+    parser.addOption(echoOpt);
+    parser.addOption(aggressivenessOpt);
+    parser.addOption(quietOpt);
+    parser.addOption(budgetOpt);
+    parser.addOption(writeBudgetOpt);
+    parser.process(app);
+
+    QTextStream out(stdout);
+    QTextStream err(stderr);
+
+    if (parser.positionalArguments().size() != 1) {
+        parser.showHelp(1);
+    }
+    if (parser.isSet(quietOpt)) {
+        // The watcher logs through the trimmeh.* categories.
+        QLoggingCategory::setFilterRules(QStringLiteral("trimmeh.*.info=false\ntrimmeh.*.debug=false"));
+    }
+
+    const double speed = parser.isSet(speedOpt) ? parser.value(speedOpt).toDouble() : 1.0;
+    if (speed <= 0) {
+        err << "--speed must be positive\n";
+        return 1;
+    }
+
+    Settings settings;
+    settings.useClipboardFallbacks = false;
+    if (parser.isSet(graceOpt)) {
+        settings.graceDelayMs = parser.value(graceOpt).toInt();
+    }
+    if (parser.isSet(aggressivenessOpt)) {
+        settings.aggressiveness = parser.value(aggressivenessOpt);
+    }
+    const int echoMs = parser.isSet(echoOpt) ? parser.value(echoOpt).toInt() : kDefaultEchoMs;
+
+    QHash<QString, double> allocBudget;
+    QString error;
+    if ((parser.isSet(budgetOpt) || parser.isSet(writeBudgetOpt)) && !AllocAccounting::isEnabled()) {
+        err << "--alloc-budget and --write-alloc-budget need a build with -DTRIMMEH_ALLOC_ACCOUNTING=ON\n";
+        return 1;
+    }
+    if (parser.isSet(budgetOpt)) {
+        if (!loadAllocBudget(parser.value(budgetOpt), &allocBudget, &error)) {
+            err << error << "\n";
+            return 1;
+        }
+    }
+
+    QVector<TraceEvent> events;
+    if (!loadTrace(parser.positionalArguments().first(), &events, &error)) {
+        err << error << "\n";
+        return 3;
+    }
+    if (events.isEmpty()) {
+        err << "Trace has no events\n";
+        return 3;
+    }
+
+    const QString corePath = parser.value(coreOpt).isEmpty()
+        ? QDir(QCoreApplication::applicationDirPath()).filePath(QStringLiteral("trimmeh-core.js"))
+        : parser.value(coreOpt);
+    TrimCore core;
+    if (!core.load(corePath, &error)) {
+        err << "Failed to load core JS: " << error << "\n";
+        return 2;
+    }
+
+    QElapsedTimer clock;
+    FakeKlipperBridge bridge(&clock, echoMs);
+    ClipboardWatcher watcher(&bridge, &core, settings);
+    bridge.setWatcher(&watcher);
+
+    // Events are scheduled relative to the first one; the debounce runs in
+    // real time, so --speed compresses the user's gaps against it.
+    const double originMs = events.first().tMs;
+    for (const TraceEvent &event : events) {
+        const int delayMs = static_cast<int>((event.tMs - originMs) / speed);
+        const QString text = event.text;
+        QTimer::singleShot(delayMs, &app, [&bridge, text]() { bridge.userCopy(text); });
+    }
+    const int lastMs = static_cast<int>((events.last().tMs - originMs) / speed);
+    QTimer::singleShot(lastMs + settings.graceDelayMs * 2 + echoMs + kSettleMs, &app, &QCoreApplication::quit);
+
+    // Engine compilation is not part of the per-event cost.
+    AllocAccounting::reset();
+    clock.start();
+    app.exec();
+    const qint64 wallNs = clock.nsecsElapsed();
+
+    const WatcherCounters &c = watcher.counters();
+    QVector<qint64> latencies = bridge.writeLatenciesNs();
+    std::sort(latencies.begin(), latencies.end());
+
+    out << "Replayed " << events.size() << " events in " << formatMs(wallNs) << " ms (speed "
+        << speed << ", grace " << settings.graceDelayMs << " ms)\n";
+    out << "  watcher events:       " << c.events << " (" << events.size() << " copies + "
+        << c.events - static_cast<quint64>(events.size()) << " echoes of own writes)\n";
+    out << "  processed:            " << c.processed << "\n";
+    out << "  coalesced:            " << c.coalesced() << "\n";
+    out << "  trims written:        " << c.trims << "\n";
+    out << "  unchanged:            " << c.unchanged << "\n";
+    out << "  self-writes ignored:  " << c.selfWritesIgnored << "\n";
+    out << "  restore-guard hits:   " << c.restoreGuardHits << "\n";
+    out << "  stale writes avoided: " << c.staleWritesAvoided << "\n";
+    out << "  errors:               " << c.errors << "\n";
+    out << "  klipper reads:        " << bridge.reads() << "\n";
+    if (!latencies.isEmpty()) {
+        out << "  copy-to-write latency (ms): min " << formatMs(latencies.first())
+            << ", p50 " << formatMs(percentile(latencies, 0.5))
+            << ", p95 " << formatMs(percentile(latencies, 0.95))
+            << ", max " << formatMs(latencies.last()) << "\n";
+    }
+
+    bool overBudget = false;
+    QVector<double> measuredAllocations;
+    if (AllocAccounting::isEnabled()) {
+        const double perEvent = c.processed > 0 ? static_cast<double>(c.processed) : 1.0;
+        out << "  allocations per processed event:\n";
+        for (int i = 0; i < static_cast<int>(AllocAccounting::Stage::Count); ++i) {
+            const auto stage = static_cast<AllocAccounting::Stage>(i);
+            const QString name = QString::fromLatin1(AllocAccounting::stageName(stage));
+            const AllocAccounting::StageCounts counts = AllocAccounting::counts(stage);
+            const double allocations = static_cast<double>(counts.allocations) / perEvent;
+            measuredAllocations.append(allocations);
+            out << "    " << name.leftJustified(6) << " " << QString::number(allocations, 'f', 1)
+                << " (" << QString::number(static_cast<double>(counts.bytes) / perEvent, 'f', 0) << " bytes)";
+            if (allocBudget.contains(name)) {
+                const double limit = allocBudget.value(name);
+                out << " budget " << limit;
+                if (allocations > limit) {
+                    out << "  OVER";
+                    overBudget = true;
+                }
+            }
+            out << "\n";
+        }
+    }
+    if (parser.isSet(writeBudgetOpt)) {
+        if (!writeAllocBudget(parser.value(writeBudgetOpt), parser.positionalArguments().first(),
+                              measuredAllocations, &error)) {
+            err << error << "\n";
+            return 1;
+        }
+        out << "Wrote " << parser.value(writeBudgetOpt) << "\n";
+    }
+    if (overBudget) {
+        err << "Allocation budget exceeded\n";
+        return 1;
+    }
+    return c.errors == 0 ? 0 : 1;
+}
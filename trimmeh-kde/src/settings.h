@@ -1,6 +1,7 @@
 #pragma once
 
 #include <QString>
+#include <QStringList>
 
 struct Settings {
     bool autoTrimEnabled = true;
@@ -9,6 +10,8 @@ struct Settings {
     bool trimPrompts = true;
     bool useClipboardFallbacks = false;
     int maxLines = 10;
+    bool largeSnippets = false;
+    QStringList extraCommandPrefixes;
     QString aggressiveness = QStringLiteral("normal");
     int graceDelayMs = 80;
     int pasteRestoreDelayMs = 1200;
@@ -20,4 +23,5 @@ struct Settings {
     QString pasteTrimmedHotkey;
     QString pasteOriginalHotkey;
     QString toggleAutoTrimHotkey;
+    bool showStatisticsMenu = false;
 };
@@ -0,0 +1,40 @@
+#include "settings_snapshot.h"
+
+#include <atomic>
+
+namespace {
+TrimOptions trimOptionsFor(const Settings &settings) {
+    TrimOptions options;
+    options.keepBlankLines = settings.keepBlankLines;
+    options.stripBoxChars = settings.stripBoxChars;
+    options.trimPrompts = settings.trimPrompts;
+    options.maxLines = settings.maxLines;
+    options.largeSnippets = settings.largeSnippets;
+    options.extraPrefixes = settings.extraCommandPrefixes;
+    return options;
+}
+}
+
+SettingsSnapshot::SettingsSnapshot(const Settings &settings, quint64 version)
+    : settings(settings)
+    , trimOptions(trimOptionsFor(settings))
+    , aggressiveness(trimAggressivenessFromString(settings.aggressiveness))
+    , version(version)
+{
+}
+
+SettingsPublisher::SettingsPublisher(const Settings &initial)
+    : m_current(std::make_shared<const SettingsSnapshot>(initial, 1))
+{
+}
+
+SettingsSnapshotPtr SettingsPublisher::current() const {
+    return std::atomic_load(&m_current);
+}
+
+SettingsSnapshotPtr SettingsPublisher::publish(const Settings &settings) {
+    const quint64 version = current()->version + 1;
+    auto next = std::make_shared<const SettingsSnapshot>(settings, version);
+    std::atomic_store(&m_current, SettingsSnapshotPtr(next));
+    return next;
+}
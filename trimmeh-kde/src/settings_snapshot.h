@@ -0,0 +1,32 @@
+#pragma once
+
+#include "settings.h"
+#include "trim_core.h"
+
+#include <memory>
+
+// Immutable view of the settings at one point in time. Trim options and the
+// aggressiveness level are resolved once here instead of on every trim.
+struct SettingsSnapshot {
+    SettingsSnapshot(const Settings &settings, quint64 version);
+
+    const Settings settings;
+    const TrimOptions trimOptions;
+    const TrimAggressiveness aggressiveness;
+    const quint64 version;
+};
+
+using SettingsSnapshotPtr = std::shared_ptr<const SettingsSnapshot>;
+
+// Single writer (the GUI thread), any number of readers on any thread.
+// Readers get a snapshot that stays valid for as long as they hold it.
+class SettingsPublisher {
+public:
+    explicit SettingsPublisher(const Settings &initial);
+
+    SettingsSnapshotPtr current() const;
+    SettingsSnapshotPtr publish(const Settings &settings);
+
+private:
+    SettingsSnapshotPtr m_current;
+};
@@ -1,5 +1,8 @@
 #include "settings_store.h"
 
+#include "stall_watchdog.h"
+
+#include <QCoreApplication>
 #include <QSettings>
 
 namespace {
@@ -9,6 +12,8 @@ constexpr const char kStripBoxChars[] = "stripBoxChars";
 constexpr const char kTrimPrompts[] = "trimPrompts";
 constexpr const char kUseClipboardFallbacks[] = "useClipboardFallbacks";
 constexpr const char kMaxLines[] = "maxLines";
+constexpr const char kLargeSnippets[] = "largeSnippets";
+constexpr const char kExtraCommandPrefixes[] = "extraCommandPrefixes";
 constexpr const char kAggressiveness[] = "aggressiveness";
 constexpr const char kStartAtLogin[] = "startAtLogin";
 constexpr const char kPasteRestoreDelayMs[] = "pasteRestoreDelayMs";
@@ -19,9 +24,51 @@ constexpr const char kToggleAutoTrimHotkeyEnabled[] = "toggleAutoTrimHotkeyEnabl
 constexpr const char kPasteTrimmedHotkey[] = "pasteTrimmedHotkey";
 constexpr const char kPasteOriginalHotkey[] = "pasteOriginalHotkey";
 constexpr const char kToggleAutoTrimHotkey[] = "toggleAutoTrimHotkey";
+constexpr const char kShowStatisticsMenu[] = "showStatisticsMenu";
+
+constexpr int kWriteBehindMs = 500;
+
+QVariantMap toValues(const Settings &settings) {
+    QVariantMap values;
+    values.insert(kAutoTrimEnabled, settings.autoTrimEnabled);
+    values.insert(kKeepBlankLines, settings.keepBlankLines);
+    values.insert(kStripBoxChars, settings.stripBoxChars);
+    values.insert(kTrimPrompts, settings.trimPrompts);
+    values.insert(kUseClipboardFallbacks, settings.useClipboardFallbacks);
+    values.insert(kMaxLines, settings.maxLines);
+    values.insert(kLargeSnippets, settings.largeSnippets);
+    values.insert(kExtraCommandPrefixes, settings.extraCommandPrefixes);
+    values.insert(kAggressiveness, settings.aggressiveness);
+    values.insert(kStartAtLogin, settings.startAtLogin);
+    values.insert(kPasteRestoreDelayMs, settings.pasteRestoreDelayMs);
+    values.insert(kPasteInjectDelayMs, settings.pasteInjectDelayMs);
+    values.insert(kPasteTrimmedHotkeyEnabled, settings.pasteTrimmedHotkeyEnabled);
+    values.insert(kPasteOriginalHotkeyEnabled, settings.pasteOriginalHotkeyEnabled);
+    values.insert(kToggleAutoTrimHotkeyEnabled, settings.toggleAutoTrimHotkeyEnabled);
+    values.insert(kPasteTrimmedHotkey, settings.pasteTrimmedHotkey);
+    values.insert(kPasteOriginalHotkey, settings.pasteOriginalHotkey);
+    values.insert(kToggleAutoTrimHotkey, settings.toggleAutoTrimHotkey);
+    values.insert(kShowStatisticsMenu, settings.showStatisticsMenu);
+    return values;
+}
 }
 
-Settings SettingsStore::load() const {
+SettingsStore::SettingsStore(QObject *parent)
+    : QObject(parent)
+{
+    m_flushTimer.setSingleShot(true);
+    m_flushTimer.setInterval(kWriteBehindMs);
+    connect(&m_flushTimer, &QTimer::timeout, this, &SettingsStore::flush);
+    if (QCoreApplication *app = QCoreApplication::instance()) {
+        connect(app, &QCoreApplication::aboutToQuit, this, &SettingsStore::flush);
+    }
+}
+
+SettingsStore::~SettingsStore() {
+    flush();
+}
+
+Settings SettingsStore::load() {
     Settings settings;
     QSettings store;
     settings.autoTrimEnabled = store.value(kAutoTrimEnabled, settings.autoTrimEnabled).toBool();
@@ -30,6 +77,8 @@ Settings SettingsStore::load() const {
     settings.trimPrompts = store.value(kTrimPrompts, settings.trimPrompts).toBool();
     settings.useClipboardFallbacks = store.value(kUseClipboardFallbacks, settings.useClipboardFallbacks).toBool();
     settings.maxLines = store.value(kMaxLines, settings.maxLines).toInt();
+    settings.largeSnippets = store.value(kLargeSnippets, settings.largeSnippets).toBool();
+    settings.extraCommandPrefixes = store.value(kExtraCommandPrefixes, settings.extraCommandPrefixes).toStringList();
     settings.aggressiveness = store.value(kAggressiveness, settings.aggressiveness).toString();
     settings.startAtLogin = store.value(kStartAtLogin, settings.startAtLogin).toBool();
     settings.pasteRestoreDelayMs = store.value(kPasteRestoreDelayMs, settings.pasteRestoreDelayMs).toInt();
@@ -40,26 +89,48 @@ Settings SettingsStore::load() const {
     settings.pasteTrimmedHotkey = store.value(kPasteTrimmedHotkey, settings.pasteTrimmedHotkey).toString();
     settings.pasteOriginalHotkey = store.value(kPasteOriginalHotkey, settings.pasteOriginalHotkey).toString();
     settings.toggleAutoTrimHotkey = store.value(kToggleAutoTrimHotkey, settings.toggleAutoTrimHotkey).toString();
+    settings.showStatisticsMenu = store.value(kShowStatisticsMenu, settings.showStatisticsMenu).toBool();
+    m_persisted = toValues(settings);
+    m_pending.clear();
     return settings;
 }
 
-void SettingsStore::save(const Settings &settings) const {
+void SettingsStore::save(const Settings &settings) {
+    m_saveRequests += 1;
+
+    // Rebuild the dirty set against disk so a value changed and changed back
+    // inside one window costs nothing.
+    const QVariantMap values = toValues(settings);
+    m_pending.clear();
+    for (auto it = values.cbegin(); it != values.cend(); ++it) {
+        const auto persisted = m_persisted.constFind(it.key());
+        if (persisted == m_persisted.cend() || persisted.value() != it.value()) {
+            m_pending.insert(it.key(), it.value());
+        }
+    }
+
+    if (m_pending.isEmpty()) {
+        m_flushTimer.stop();
+        return;
+    }
+    if (!m_flushTimer.isActive()) {
+        m_flushTimer.start();
+    }
+}
+
+void SettingsStore::flush() {
+    m_flushTimer.stop();
+    if (m_pending.isEmpty()) {
+        return;
+    }
+
+    StallWatchdog::Scope stage(StallWatchdog::Stage::SettingsSync, m_pending.size());
     QSettings store;
-    store.setValue(kAutoTrimEnabled, settings.autoTrimEnabled);
-    store.setValue(kKeepBlankLines, settings.keepBlankLines);
-    store.setValue(kStripBoxChars, settings.stripBoxChars);
-    store.setValue(kTrimPrompts, settings.trimPrompts);
-    store.setValue(kUseClipboardFallbacks, settings.useClipboardFallbacks);
-    store.setValue(kMaxLines, settings.maxLines);
-    store.setValue(kAggressiveness, settings.aggressiveness);
-    store.setValue(kStartAtLogin, settings.startAtLogin);
-    store.setValue(kPasteRestoreDelayMs, settings.pasteRestoreDelayMs);
-    store.setValue(kPasteInjectDelayMs, settings.pasteInjectDelayMs);
-    store.setValue(kPasteTrimmedHotkeyEnabled, settings.pasteTrimmedHotkeyEnabled);
-    store.setValue(kPasteOriginalHotkeyEnabled, settings.pasteOriginalHotkeyEnabled);
-    store.setValue(kToggleAutoTrimHotkeyEnabled, settings.toggleAutoTrimHotkeyEnabled);
-    store.setValue(kPasteTrimmedHotkey, settings.pasteTrimmedHotkey);
-    store.setValue(kPasteOriginalHotkey, settings.pasteOriginalHotkey);
-    store.setValue(kToggleAutoTrimHotkey, settings.toggleAutoTrimHotkey);
+    for (auto it = m_pending.cbegin(); it != m_pending.cend(); ++it) {
+        store.setValue(it.key(), it.value());
+        m_persisted.insert(it.key(), it.value());
+    }
     store.sync();
+    m_pending.clear();
+    m_diskWrites += 1;
 }
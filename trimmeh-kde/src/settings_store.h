@@ -2,8 +2,33 @@
 
 #include "settings.h"
 
-class SettingsStore {
+#include <QObject>
+#include <QTimer>
+#include <QVariantMap>
+
+// Write-behind persistence: save() only records which keys differ from what
+// is on disk; the changed keys are written in one batch after a short window,
+// on flush(), or when the application quits.
+class SettingsStore : public QObject {
+    Q_OBJECT
 public:
-    Settings load() const;
-    void save(const Settings &settings) const;
+    explicit SettingsStore(QObject *parent = nullptr);
+    ~SettingsStore() override;
+
+    Settings load();
+    void save(const Settings &settings);
+
+    bool hasPendingWrites() const { return !m_pending.isEmpty(); }
+    quint64 diskWrites() const { return m_diskWrites; }
+    quint64 writesAvoided() const { return m_saveRequests - m_diskWrites; }
+
+public slots:
+    void flush();
+
+private:
+    QVariantMap m_persisted;
+    QVariantMap m_pending;
+    QTimer m_flushTimer;
+    quint64 m_saveRequests = 0;
+    quint64 m_diskWrites = 0;
 };
@@ -0,0 +1,178 @@
+#include "stall_watchdog.h"
+
+#include "event_log.h"
+#include "log_categories.h"
+
+#include <QDebug>
+#include <QElapsedTimer>
+#include <QMutexLocker>
+#include <QThread>
+
+#include <algorithm>
+
+namespace {
+constexpr int kMinIntervalMs = 10;
+
+std::atomic<QThread *> g_mainThread{nullptr};
+std::atomic<int> g_stage{0};
+std::atomic<qint64> g_payload{-1};
+std::atomic<qint64> g_stageStartNs{0};
+
+// Monotonic and readable from any thread; started before the watchdog thread.
+QElapsedTimer &clock() {
+    static QElapsedTimer timer;
+    return timer;
+}
+
+qint64 nowNs() {
+    return clock().nsecsElapsed();
+}
+}
+
+const char *StallWatchdog::stageName(Stage stage) {
+    switch (stage) {
+    case Stage::Idle:
+        return "unmarked";
+    case Stage::KlipperRead:
+        return "klipper-read";
+    case Stage::KlipperWrite:
+        return "klipper-write";
+    case Stage::Trim:
+        return "trim";
+    case Stage::EngineLoad:
+        return "engine-load";
+    case Stage::RichText:
+        return "rich-text";
+    case Stage::SettingsSync:
+        return "settings-sync";
+    case Stage::Portal:
+        return "portal";
+    }
+    return "unknown";
+}
+
+StallWatchdog::Scope::Scope(Stage stage, qint64 payloadSize) {
+    QThread *mainThread = g_mainThread.load(std::memory_order_relaxed);
+    if (!mainThread || QThread::currentThread() != mainThread) {
+        return;
+    }
+    m_active = true;
+    m_previousStage = g_stage.load(std::memory_order_relaxed);
+    m_previousPayload = g_payload.load(std::memory_order_relaxed);
+    m_previousStartNs = g_stageStartNs.load(std::memory_order_relaxed);
+    g_payload.store(payloadSize, std::memory_order_relaxed);
+    g_stageStartNs.store(nowNs(), std::memory_order_relaxed);
+    g_stage.store(static_cast<int>(stage), std::memory_order_release);
+}
+
+StallWatchdog::Scope::~Scope() {
+    if (!m_active) {
+        return;
+    }
+    g_payload.store(m_previousPayload, std::memory_order_relaxed);
+    g_stageStartNs.store(m_previousStartNs, std::memory_order_relaxed);
+    g_stage.store(m_previousStage, std::memory_order_release);
+}
+
+StallWatchdog::StallWatchdog(int thresholdMs, QObject *parent)
+    : QObject(parent)
+    , m_thresholdMs(thresholdMs)
+    , m_intervalMs(std::max(kMinIntervalMs, thresholdMs / 4))
+{
+    qRegisterMetaType<StallRecord>();
+    m_heartbeat.setInterval(m_intervalMs);
+    connect(&m_heartbeat, &QTimer::timeout, this, &StallWatchdog::beat);
+}
+
+StallWatchdog::~StallWatchdog() {
+    stop();
+}
+
+void StallWatchdog::start() {
+    if (m_thread) {
+        return;
+    }
+    if (!clock().isValid()) {
+        clock().start();
+    }
+    g_mainThread.store(QThread::currentThread(), std::memory_order_relaxed);
+    m_lastBeatNs.store(nowNs(), std::memory_order_relaxed);
+    m_stopping = false;
+    m_heartbeat.start();
+    m_thread.reset(QThread::create([this]() { monitor(); }));
+    m_thread->setObjectName(QStringLiteral("stall-watchdog"));
+    m_thread->start(QThread::LowPriority);
+}
+
+void StallWatchdog::stop() {
+    if (!m_thread) {
+        return;
+    }
+    {
+        QMutexLocker lock(&m_mutex);
+        m_stopping = true;
+        m_wake.wakeAll();
+    }
+    m_thread->wait();
+    m_thread.reset();
+    m_heartbeat.stop();
+    g_mainThread.store(nullptr, std::memory_order_relaxed);
+}
+
+void StallWatchdog::beat() {
+    const qint64 now = nowNs();
+    const qint64 previous = m_lastBeatNs.exchange(now, std::memory_order_relaxed);
+    if (!m_stalled.exchange(false, std::memory_order_acq_rel)) {
+        return;
+    }
+
+    StallRecord record;
+    record.stage = QString::fromLatin1(stageName(static_cast<Stage>(m_stallStage.load(std::memory_order_relaxed))));
+    record.durationMs = std::max<qint64>(0, (now - previous) / 1000000 - m_intervalMs);
+    record.payloadSize = m_stallPayload.load(std::memory_order_relaxed);
+    if (record.durationMs < m_thresholdMs) {
+        // The loop resumed just as the monitor flagged it.
+        return;
+    }
+    m_stallCount += 1;
+    EventLog::record(EventLog::Kind::Stall, record.durationMs, record.payloadSize);
+    qCWarning(lcApp).noquote() << "[trimmeh-kde] event loop stalled" << record.durationMs << "ms in" << record.stage
+                         << "(payload" << record.payloadSize << ")";
+    emit stallEnded(record);
+}
+
+void StallWatchdog::monitor() {
+    const qint64 thresholdNs = static_cast<qint64>(m_thresholdMs) * 1000000;
+    QMutexLocker lock(&m_mutex);
+    while (!m_stopping) {
+        m_wake.wait(&m_mutex, static_cast<unsigned long>(m_intervalMs));
+        if (m_stopping) {
+            break;
+        }
+
+        const qint64 now = nowNs();
+        const qint64 lag = now - m_lastBeatNs.load(std::memory_order_relaxed) - qint64(m_intervalMs) * 1000000;
+        if (lag < thresholdNs) {
+            continue;
+        }
+
+        // Keep sampling while the stall lasts: the stage that is active last
+        // is the one that is still blocking the loop.
+        const int stage = g_stage.load(std::memory_order_acquire);
+        const qint64 payload = g_payload.load(std::memory_order_relaxed);
+        const bool first = !m_stalled.load(std::memory_order_relaxed);
+        if (first || stage != static_cast<int>(Stage::Idle)) {
+            m_stallStage.store(stage, std::memory_order_relaxed);
+            m_stallPayload.store(payload, std::memory_order_relaxed);
+        }
+        if (first) {
+            m_stalled.store(true, std::memory_order_release);
+            const qint64 stageMs = stage == static_cast<int>(Stage::Idle)
+                ? -1
+                : (now - g_stageStartNs.load(std::memory_order_relaxed)) / 1000000;
+            qCWarning(lcApp).noquote() << "[trimmeh-kde] event loop blocked for" << lag / 1000000 << "ms in"
+                                 << stageName(static_cast<Stage>(stage)) << "(stage active" << stageMs
+                                 << "ms, payload" << payload << ")";
+        }
+    }
+}
@@ -0,0 +1,91 @@
+#pragma once
+
+#include <QMetaType>
+#include <QMutex>
+#include <QObject>
+#include <QString>
+#include <QTimer>
+#include <QWaitCondition>
+
+#include <atomic>
+#include <memory>
+
+class QThread;
+
+struct StallRecord {
+    QString stage;
+    qint64 durationMs = 0;
+    // Size of the payload the stage was working on (characters or bytes), or
+    // -1 when the stage has none.
+    qint64 payloadSize = -1;
+};
+
+Q_DECLARE_METATYPE(StallRecord)
+
+// Detects GUI event-loop stalls. The main thread bumps a heartbeat from a
+// timer; a separate thread checks it and, once it is older than the
+// threshold, samples the pipeline stage the main thread marked with Scope.
+// The stall is reported again, with its full length, when the loop resumes.
+class StallWatchdog : public QObject {
+    Q_OBJECT
+public:
+    enum class Stage : int {
+        Idle,
+        KlipperRead,
+        KlipperWrite,
+        Trim,
+        EngineLoad,
+        RichText,
+        SettingsSync,
+        Portal,
+    };
+
+    static const char *stageName(Stage stage);
+
+    // Marks the current main-thread stage for the duration of a synchronous
+    // call. Nested scopes restore the outer stage. A no-op off the main
+    // thread and while no watchdog is running.
+    class Scope {
+    public:
+        explicit Scope(Stage stage, qint64 payloadSize = -1);
+        ~Scope();
+        Scope(const Scope &) = delete;
+        Scope &operator=(const Scope &) = delete;
+
+    private:
+        bool m_active = false;
+        int m_previousStage = 0;
+        qint64 m_previousPayload = -1;
+        qint64 m_previousStartNs = 0;
+    };
+
+    explicit StallWatchdog(int thresholdMs, QObject *parent = nullptr);
+    ~StallWatchdog() override;
+
+    // Must be called on the main thread.
+    void start();
+    void stop();
+
+    quint64 stallCount() const { return m_stallCount; }
+
+signals:
+    // Emitted on the main thread once a stall is over.
+    void stallEnded(const StallRecord &record);
+
+private:
+    void beat();
+    void monitor();
+
+    const int m_thresholdMs;
+    const int m_intervalMs;
+    QTimer m_heartbeat;
+    std::unique_ptr<QThread> m_thread;
+    QMutex m_mutex;
+    QWaitCondition m_wake;
+    bool m_stopping = false;
+    std::atomic<qint64> m_lastBeatNs{0};
+    std::atomic<bool> m_stalled{false};
+    std::atomic<int> m_stallStage{0};
+    std::atomic<qint64> m_stallPayload{-1};
+    quint64 m_stallCount = 0;
+};
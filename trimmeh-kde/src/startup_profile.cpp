@@ -0,0 +1,105 @@
+#include "startup_profile.h"
+
+#include <QCoreApplication>
+#include <QFile>
+#include <QMutexLocker>
+#include <QTextStream>
+#include <QThread>
+
+#include <algorithm>
+
+namespace {
+QString currentThreadLabel() {
+    const QCoreApplication *app = QCoreApplication::instance();
+    if (!app || QThread::currentThread() == app->thread()) {
+        return QStringLiteral("main");
+    }
+    return QStringLiteral("worker");
+}
+
+QString formatMs(qint64 ns) {
+    return QString::number(static_cast<double>(ns) / 1000000.0, 'f', 2);
+}
+
+// Linux-only; returns an empty string where /proc is unavailable.
+QString procStatusField(const QByteArray &key) {
+    QFile file(QStringLiteral("/proc/self/status"));
+    if (!file.open(QIODevice::ReadOnly | QIODevice::Text)) {
+        return QString();
+    }
+    const QByteArray prefix = key + ':';
+    while (!file.atEnd()) {
+        const QByteArray line = file.readLine();
+        if (line.startsWith(prefix)) {
+            return QString::fromLatin1(line.mid(prefix.size()).simplified());
+        }
+    }
+    return QString();
+}
+}
+
+StartupProfile::StartupProfile() {
+    m_clock.start();
+}
+
+void StartupProfile::record(const QString &phase, qint64 startNs, qint64 endNs) {
+    Entry entry;
+    entry.phase = phase;
+    entry.thread = currentThreadLabel();
+    entry.startNs = startNs;
+    entry.endNs = endNs;
+    QMutexLocker lock(&m_mutex);
+    m_entries.append(entry);
+}
+
+void StartupProfile::mark(const QString &milestone) {
+    const qint64 now = elapsedNs();
+    record(milestone, now, -1);
+}
+
+void StartupProfile::print() const {
+    QVector<Entry> entries;
+    {
+        QMutexLocker lock(&m_mutex);
+        entries = m_entries;
+    }
+    std::stable_sort(entries.begin(), entries.end(), [](const Entry &a, const Entry &b) {
+        return a.startNs < b.startNs;
+    });
+
+    QTextStream out(stdout);
+    out << "Startup profile (ms since process start):\n";
+    out << QStringLiteral("  %1 %2 %3 %4\n")
+               .arg(QStringLiteral("phase"), -28)
+               .arg(QStringLiteral("thread"), -7)
+               .arg(QStringLiteral("start"), 9)
+               .arg(QStringLiteral("duration"), 9);
+    for (const Entry &entry : entries) {
+        const QString duration = entry.endNs < 0
+            ? QStringLiteral("-")
+            : formatMs(entry.endNs - entry.startNs);
+        out << QStringLiteral("  %1 %2 %3 %4\n")
+                   .arg(entry.phase, -28)
+                   .arg(entry.thread, -7)
+                   .arg(formatMs(entry.startNs), 9)
+                   .arg(duration, 9);
+    }
+    const QString rss = procStatusField("VmRSS");
+    if (!rss.isEmpty()) {
+        out << "Memory: rss " << rss << ", peak " << procStatusField("VmHWM") << "\n";
+    }
+    out.flush();
+}
+
+StartupProfile::Phase::Phase(StartupProfile *profile, const QString &name)
+    : m_profile(profile)
+    , m_name(name)
+    , m_startNs(profile ? profile->elapsedNs() : 0)
+{
+}
+
+StartupProfile::Phase::~Phase() {
+    if (m_profile) {
+        m_profile->record(m_name, m_startNs, m_profile->elapsedNs());
+    }
+}
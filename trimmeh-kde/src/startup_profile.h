@@ -0,0 +1,44 @@
+#pragma once
+
+#include <QElapsedTimer>
+#include <QMutex>
+#include <QString>
+#include <QVector>
+
+class StartupProfile {
+public:
+    StartupProfile();
+
+    void setEnabled(bool enabled) { m_enabled = enabled; }
+    bool isEnabled() const { return m_enabled; }
+    qint64 elapsedNs() const { return m_clock.nsecsElapsed(); }
+
+    // Thread-safe; phases may be recorded from startup worker threads.
+    void record(const QString &phase, qint64 startNs, qint64 endNs);
+    void mark(const QString &milestone);
+    void print() const;
+
+    class Phase {
+    public:
+        Phase(StartupProfile *profile, const QString &name);
+        ~Phase();
+
+    private:
+        StartupProfile *m_profile = nullptr;
+        QString m_name;
+        qint64 m_startNs = 0;
+    };
+
+private:
+    struct Entry {
+        QString phase;
+        QString thread;
+        qint64 startNs = 0;
+        qint64 endNs = -1;
+    };
+
+    QElapsedTimer m_clock;
+    mutable QMutex m_mutex;
+    QVector<Entry> m_entries;
+    bool m_enabled = false;
+};
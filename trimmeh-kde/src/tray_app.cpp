@@ -60,6 +60,17 @@ QString prettyBadge(int count, int limit, bool showTruncations) {
 
     return QStringLiteral(" \u00b7 %1 \u00b7 %2 trimmed").arg(chars).arg(truncations);
 }
+
+QString latencyLine(const QString &label, const LatencyHistogram &histogram) {
+    if (histogram.count() == 0) {
+        return QStringLiteral("%1: no samples").arg(label);
+    }
+    return QStringLiteral("%1: p50 %2 \u00b7 p95 %3 \u00b7 max %4 ms")
+        .arg(label)
+        .arg(QString::number(histogram.percentileUs(0.50) / 1000.0, 'f', 1))
+        .arg(QString::number(histogram.percentileUs(0.95) / 1000.0, 'f', 1))
+        .arg(QString::number(histogram.maxNs() / 1000000.0, 'f', 1));
+}
 }
 
 TrayApp::TrayApp(ClipboardWatcher *watcher,
@@ -139,6 +150,11 @@ TrayApp::TrayApp(ClipboardWatcher *watcher,
         updateState();
     });
 
+    m_statisticsMenu = new QMenu(QStringLiteral("Statistics"), m_menu);
+    connect(m_statisticsMenu, &QMenu::aboutToShow, this, &TrayApp::updateStatistics);
+    m_statistics = m_menu->addMenu(m_statisticsMenu);
+    m_statistics->setVisible(false);
+
     m_menu->addSeparator();
 
     auto *settings = m_menu->addAction(QStringLiteral("Settings..."));
@@ -206,11 +222,55 @@ void TrayApp::updateState() {
     if (m_restoreLast) {
         m_restoreLast->setEnabled(m_watcher->hasLastOriginal());
     }
+    if (m_statistics) {
+        m_statistics->setVisible(m_watcher->showStatisticsMenu());
+    }
     updatePreviews();
     updateShortcuts();
     updatePasteStats();
 }
 
+void TrayApp::updateStatistics() {
+    if (!m_watcher || !m_statisticsMenu) {
+        return;
+    }
+
+    // Rebuilt on open so the numbers are fresh without a refresh timer.
+    m_statisticsMenu->clear();
+    const auto addLine = [this](const QString &text) {
+        m_statisticsMenu->addAction(text)->setEnabled(false);
+    };
+    const WatcherCounters &counters = m_watcher->counters();
+    const MetricsRegistry &metrics = m_watcher->metrics();
+    addLine(QStringLiteral("Clipboard events: %1").arg(counters.events));
+    addLine(QStringLiteral("Coalesced: %1").arg(counters.coalesced()));
+    addLine(QStringLiteral("Trimmed: %1").arg(counters.trims));
+    const QHash<QString, quint64> &reasons = metrics.trimsByReason();
+    for (auto it = reasons.cbegin(); it != reasons.cend(); ++it) {
+        addLine(QStringLiteral("    %1: %2").arg(it.key()).arg(it.value()));
+    }
+    addLine(QStringLiteral("Skipped (too large): %1").arg(metrics.skippedTooLarge()));
+    addLine(QStringLiteral("Own writes ignored: %1").arg(counters.selfWritesIgnored));
+    addLine(QStringLiteral("Restore guard hits: %1").arg(counters.restoreGuardHits));
+    m_statisticsMenu->addSeparator();
+    addLine(latencyLine(QStringLiteral("Read"), metrics.latency(MetricsRegistry::Stage::Read)));
+    addLine(latencyLine(QStringLiteral("Trim"), metrics.latency(MetricsRegistry::Stage::Trim)));
+    addLine(latencyLine(QStringLiteral("Write"), metrics.latency(MetricsRegistry::Stage::Write)));
+    if (metrics.stallCount() > 0) {
+        addLine(QStringLiteral("Event-loop stalls: %1 \u00b7 worst %2 ms")
+                    .arg(metrics.stallCount())
+                    .arg(metrics.maxStallMs()));
+        addLine(QStringLiteral("    last: %1 ms in %2").arg(metrics.lastStallMs()).arg(metrics.lastStallStage()));
+    }
+    m_statisticsMenu->addSeparator();
+    auto *reset = m_statisticsMenu->addAction(QStringLiteral("Reset Statistics"));
+    connect(reset, &QAction::triggered, this, [this]() {
+        if (m_watcher) {
+            m_watcher->resetMetrics();
+        }
+    });
+}
+
 void TrayApp::updatePasteStats() {
     if (!m_watcher || !m_pasteTrimmed || !m_pasteOriginal) {
         return;
@@ -22,6 +22,7 @@ private slots:
     void updateSummary(const QString &summary);
     void updateState();
     void updatePermissionState();
+    void updateStatistics();
 
 private:
     void updatePasteStats();
@@ -44,6 +45,8 @@ private:
     QAction *m_restoreLast = nullptr;
     QAction *m_lastSummary = nullptr;
     QAction *m_autoTrimToggle = nullptr;
+    QMenu *m_statisticsMenu = nullptr;
+    QAction *m_statistics = nullptr;
     QAction *m_about = nullptr;
     QAction *m_updateReady = nullptr;
     PreferencesDialog *m_prefs = nullptr;
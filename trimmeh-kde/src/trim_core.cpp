@@ -1,7 +1,12 @@
 #include "trim_core.h"
 
+#include "stall_watchdog.h"
+
 #include <QFile>
 #include <QJSValueList>
+#include <QStringView>
+
+#include <string_view>
 
 namespace {
 QString formatJsError(const QJSValue &error, const QString &sourcePath) {
@@ -23,16 +28,154 @@ constexpr const char kPolyfills[] = R"JS(
   }
 })();
 )JS";
+
+// Must match BOX_CHARS in trimmeh-core-js/src/charclass.ts. All of them are
+// in the BMP, so a surrogate half is never mistaken for one.
+constexpr std::u16string_view kBoxChars =
+    u"\u2502\u2503\u254e\u254f\u2506\u2507\u250a\u250b\u257d\u257f\uffe8\uff5c";
+
+bool isBoxChar(char16_t c) {
+    return c >= 0x2502 && kBoxChars.find(c) != std::u16string_view::npos;
+}
+
+// RegExp \s, which is what the core's trim() and ^\s* skip.
+bool isScriptSpace(char16_t c) {
+    if (c < 0x80) {
+        return c == u' ' || (c >= u'\t' && c <= u'\r');
+    }
+    return c == 0xa0 || c == 0x1680 || (c >= 0x2000 && c <= 0x200a) || c == 0x2028 ||
+           c == 0x2029 || c == 0x202f || c == 0x205f || c == 0x3000 || c == 0xfeff;
+}
+
+struct Prescan {
+    // Lines after "\r\n" and "\r" are normalized to "\n".
+    qsizetype lines = 1;
+    bool boxChars = false;
+    bool hasContent = false;
+    // First code unit that is not RegExp \s.
+    char16_t first = 0;
+};
+
+Prescan prescan(QStringView text) {
+    Prescan scan;
+    const char16_t *units = text.utf16();
+    const qsizetype size = text.size();
+    for (qsizetype i = 0; i < size; ++i) {
+        const char16_t c = units[i];
+        if (c == u'\n') {
+            scan.lines += 1;
+        } else if (c == u'\r') {
+            scan.lines += 1;
+            if (i + 1 < size && units[i + 1] == u'\n') {
+                ++i;
+            }
+        } else if (!scan.hasContent && !isScriptSpace(c)) {
+            scan.hasContent = true;
+            scan.first = c;
+        }
+        if (!scan.boxChars && isBoxChar(c)) {
+            scan.boxChars = true;
+        }
+    }
+    return scan;
+}
+
+// Answers the trims the core would leave unchanged straight from the UTF-16
+// code units, without converting the text into and out of the engine: text
+// over the line limit, and single lines that no pass can touch (box strip
+// needs a box character, prompt strip a leading '$' or '#', URL repair a
+// leading scheme, and command flattening a line break).
+bool trimWithoutEngine(const QString &input, const TrimOptions &options, TrimResult *result) {
+    const Prescan scan = prescan(input);
+    if (scan.lines > options.maxLines) {
+        result->reason = QStringLiteral("skipped_too_large");
+        return true;
+    }
+    if (scan.lines > 1 || (options.stripBoxChars && scan.boxChars)) {
+        return false;
+    }
+    if (!scan.hasContent) {
+        return true;
+    }
+    const char16_t first = scan.first;
+    if (options.trimPrompts && (first == u'$' || first == u'#')) {
+        return false;
+    }
+    return first != u'h' && first != u'H';
+}
+}
+
+TrimAggressiveness trimAggressivenessFromString(const QString &level) {
+    if (level == QLatin1String("low")) {
+        return TrimAggressiveness::Low;
+    }
+    if (level == QLatin1String("high")) {
+        return TrimAggressiveness::High;
+    }
+    return TrimAggressiveness::Normal;
+}
+
+QString trimAggressivenessName(TrimAggressiveness level) {
+    switch (level) {
+    case TrimAggressiveness::Low:
+        return QStringLiteral("low");
+    case TrimAggressiveness::High:
+        return QStringLiteral("high");
+    case TrimAggressiveness::Normal:
+        break;
+    }
+    return QStringLiteral("normal");
 }
 
 bool TrimCore::load(const QString &jsPath, QString *errorMessage) {
-    QJSValue global = m_engine.globalObject();
+    m_bundlePath = jsPath;
+    return ensureLoaded(errorMessage);
+}
+
+bool TrimCore::ensureLoaded(QString *errorMessage) {
+    if (m_ready) {
+        return true;
+    }
+    // A broken bundle stays broken; do not recompile it on every clipboard event.
+    if (!m_loadError.isEmpty()) {
+        if (errorMessage) {
+            *errorMessage = m_loadError;
+        }
+        return false;
+    }
+    if (m_bundlePath.isEmpty()) {
+        if (errorMessage) {
+            *errorMessage = QStringLiteral("TrimCore not initialized");
+        }
+        return false;
+    }
+
+    QString error;
+    StallWatchdog::Scope stage(StallWatchdog::Stage::EngineLoad);
+    if (!compile(&error)) {
+        m_loadError = error;
+        m_trimFunc = QJSValue();
+        m_trimmer = QJSValue();
+        m_trimmerTrimFunc = QJSValue();
+        m_engine.reset();
+        if (errorMessage) {
+            *errorMessage = error;
+        }
+        return false;
+    }
+    m_ready = true;
+    return true;
+}
+
+bool TrimCore::compile(QString *errorMessage) {
+    m_engine = std::make_unique<QJSEngine>();
+    QJSValue global = m_engine->globalObject();
     if (global.property(QStringLiteral("globalThis")).isUndefined()) {
         global.setProperty(QStringLiteral("globalThis"), global);
     }
 
-    QJSValue polyfills = m_engine.evaluate(QString::fromLatin1(kPolyfills),
-                                           QStringLiteral("trimmeh-kde-polyfills.js"));
+    QJSValue polyfills = m_engine->evaluate(QString::fromLatin1(kPolyfills),
+                                            QStringLiteral("trimmeh-kde-polyfills.js"));
     if (polyfills.isError()) {
         if (errorMessage) {
             *errorMessage = formatJsError(polyfills, QStringLiteral("trimmeh-kde-polyfills.js"));
@@ -40,10 +183,10 @@ bool TrimCore::load(const QString &jsPath, QString *errorMessage) {
         return false;
     }
 
-    QFile file(jsPath);
+    QFile file(m_bundlePath);
     if (!file.open(QIODevice::ReadOnly)) {
         if (errorMessage) {
-            *errorMessage = QStringLiteral("Failed to open JS bundle: %1").arg(jsPath);
+            *errorMessage = QStringLiteral("Failed to open JS bundle: %1").arg(m_bundlePath);
         }
         return false;
     }
@@ -51,15 +194,15 @@ bool TrimCore::load(const QString &jsPath, QString *errorMessage) {
     const QString script = QString::fromUtf8(file.readAll());
     file.close();
 
-    QJSValue eval = m_engine.evaluate(script, jsPath);
+    QJSValue eval = m_engine->evaluate(script, m_bundlePath);
     if (eval.isError()) {
         if (errorMessage) {
-            *errorMessage = formatJsError(eval, jsPath);
+            *errorMessage = formatJsError(eval, m_bundlePath);
         }
         return false;
     }
 
-    const QJSValue core = m_engine.globalObject().property(QStringLiteral("TrimmehCore"));
+    const QJSValue core = m_engine->globalObject().property(QStringLiteral("TrimmehCore"));
     if (!core.isObject()) {
         if (errorMessage) {
             *errorMessage = QStringLiteral("TrimmehCore global not found in JS bundle");
@@ -75,36 +218,84 @@ bool TrimCore::load(const QString &jsPath, QString *errorMessage) {
         return false;
     }
 
+    const QJSValue trimmerClass = core.property(QStringLiteral("IncrementalTrimmer"));
+    if (!trimmerClass.isCallable()) {
+        if (errorMessage) {
+            *errorMessage = QStringLiteral("TrimmehCore.IncrementalTrimmer is not a constructor");
+        }
+        return false;
+    }
+    const QJSValue trimmer = trimmerClass.callAsConstructor();
+    if (trimmer.isError()) {
+        if (errorMessage) {
+            *errorMessage = formatJsError(trimmer, QString());
+        }
+        return false;
+    }
+
     m_trimFunc = trimFunc;
-    m_ready = true;
+    m_trimmer = trimmer;
+    m_trimmerTrimFunc = trimmer.property(QStringLiteral("trim"));
     return true;
 }
 
+QJSValue TrimCore::extraPrefixesValue(const QStringList &prefixes) {
+    // Lists copied from one settings snapshot share data, so this is a
+    // pointer compare on the hot path.
+    if (m_extraPrefixesValue.isUndefined() || prefixes != m_extraPrefixes) {
+        m_extraPrefixes = prefixes;
+        m_extraPrefixesValue = m_engine->toScriptValue(prefixes);
+    }
+    return m_extraPrefixesValue;
+}
+
+TrimResult TrimCore::trim(const QString &input,
+                          TrimAggressiveness aggressiveness,
+                          const TrimOptions &options,
+                          QString *errorMessage) {
+    return trimWith(input, m_aggressivenessValues[static_cast<int>(aggressiveness)], options, errorMessage);
+}
+
 TrimResult TrimCore::trim(const QString &input,
                           const QString &aggressiveness,
                           const TrimOptions &options,
                           QString *errorMessage) {
+    return trimWith(input, QJSValue(aggressiveness), options, errorMessage);
+}
+
+TrimResult TrimCore::trimWith(const QString &input,
+                              const QJSValue &aggressiveness,
+                              const TrimOptions &options,
+                              QString *errorMessage) {
     TrimResult result;
     result.output = input;
     result.changed = false;
 
-    if (!m_ready) {
-        if (errorMessage) {
-            *errorMessage = QStringLiteral("TrimCore not initialized");
-        }
+    // Before ensureLoaded(), so copies that never need the engine never load it.
+    if (trimWithoutEngine(input, options, &result)) {
         return result;
     }
 
-    QJSValue opts = m_engine.newObject();
+    if (!ensureLoaded(errorMessage)) {
+        return result;
+    }
+
+    StallWatchdog::Scope stage(StallWatchdog::Stage::Trim, input.size());
+    QJSValue opts = m_engine->newObject();
     opts.setProperty(QStringLiteral("keep_blank_lines"), options.keepBlankLines);
     opts.setProperty(QStringLiteral("strip_box_chars"), options.stripBoxChars);
     opts.setProperty(QStringLiteral("trim_prompts"), options.trimPrompts);
     opts.setProperty(QStringLiteral("max_lines"), options.maxLines);
+    opts.setProperty(QStringLiteral("large_snippets"), options.largeSnippets);
+    if (!options.extraPrefixes.isEmpty()) {
+        opts.setProperty(QStringLiteral("extra_prefixes"), extraPrefixesValue(options.extraPrefixes));
+    }
 
     QJSValueList args;
-    args << QJSValue(input) << QJSValue(aggressiveness) << opts;
+    args << QJSValue(input) << aggressiveness << opts;
 
-    QJSValue res = m_trimFunc.call(args);
+    QJSValue res = m_incremental ? m_trimmerTrimFunc.callWithInstance(m_trimmer, args)
+                                 : m_trimFunc.call(args);
     if (res.isError()) {
         if (errorMessage) {
             *errorMessage = formatJsError(res, QString());
@@ -3,12 +3,28 @@
 #include <QJSEngine>
 #include <QJSValue>
 #include <QString>
+#include <QStringList>
+
+#include <memory>
+
+enum class TrimAggressiveness {
+    Low,
+    Normal,
+    High,
+};
+
+TrimAggressiveness trimAggressivenessFromString(const QString &level);
+QString trimAggressivenessName(TrimAggressiveness level);
 
 struct TrimOptions {
     bool keepBlankLines = false;
     bool stripBoxChars = true;
     bool trimPrompts = true;
     int maxLines = 10;
+    // Flatten backslash continuation chains of any length up to maxLines.
+    bool largeSnippets = false;
+    // First words treated as commands on top of the core's built-in list.
+    QStringList extraPrefixes;
 };
 
 struct TrimResult {
@@ -19,15 +35,58 @@ struct TrimResult {
 
 class TrimCore {
 public:
+    // Deferred loading: the engine is only created by ensureLoaded(), or by
+    // the first trim() call, so sessions that never trim never pay for it.
+    void setBundlePath(const QString &jsPath) { m_bundlePath = jsPath; }
+    QString bundlePath() const { return m_bundlePath; }
+    bool ensureLoaded(QString *errorMessage = nullptr);
+
     bool load(const QString &jsPath, QString *errorMessage = nullptr);
     bool isReady() const { return m_ready; }
+    bool hasEngine() const { return m_engine != nullptr; }
+    bool loadFailed() const { return !m_loadError.isEmpty(); }
+    // On by default: trims go through one TrimmehCore.IncrementalTrimmer,
+    // which reuses the line analysis of the previous text when the next one
+    // extends it (a growing selection). Results are the same either way.
+    // Only the clipboard watcher's trims benefit; the pool workers and the
+    // D-Bus service turn it off.
+    void setIncremental(bool incremental) { m_incremental = incremental; }
+    bool isIncremental() const { return m_incremental; }
     TrimResult trim(const QString &input,
                     const QString &aggressiveness,
                     const TrimOptions &options,
                     QString *errorMessage = nullptr);
+    TrimResult trim(const QString &input,
+                    TrimAggressiveness aggressiveness,
+                    const TrimOptions &options,
+                    QString *errorMessage = nullptr);
 
 private:
-    QJSEngine m_engine;
+    bool compile(QString *errorMessage);
+    QJSValue extraPrefixesValue(const QStringList &prefixes);
+    TrimResult trimWith(const QString &input,
+                        const QJSValue &aggressiveness,
+                        const TrimOptions &options,
+                        QString *errorMessage);
+
+    std::unique_ptr<QJSEngine> m_engine;
     QJSValue m_trimFunc;
+    QJSValue m_trimmer;
+    QJSValue m_trimmerTrimFunc;
+    // Indexed by TrimAggressiveness, so the enum overload hands the core a
+    // level without building a string per call. Primitive strings are not
+    // tied to an engine, so these survive a reload.
+    QJSValue m_aggressivenessValues[3] = {
+        QJSValue(QStringLiteral("low")),
+        QJSValue(QStringLiteral("normal")),
+        QJSValue(QStringLiteral("high")),
+    };
+    // The core caches its prefix trie per JS array, so the same array is
+    // handed back for as long as the list does not change.
+    QStringList m_extraPrefixes;
+    QJSValue m_extraPrefixesValue;
+    QString m_bundlePath;
+    QString m_loadError;
     bool m_ready = false;
+    bool m_incremental = true;
 };
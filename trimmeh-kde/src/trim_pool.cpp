@@ -0,0 +1,154 @@
+#include "trim_pool.h"
+
+#include "alloc_accounting.h"
+
+#include <QCoreApplication>
+#include <QElapsedTimer>
+#include <QMetaObject>
+#include <QMutexLocker>
+
+#include <algorithm>
+#include <utility>
+
+namespace {
+constexpr const char kStoppedError[] = "Trim pool stopped before the job ran";
+}
+
+TrimPool::TrimPool(const QString &bundlePath, int workers, QObject *parent)
+    : QObject(parent)
+    , m_bundlePath(bundlePath)
+    , m_workerCount(std::max(1, workers)) {
+    qRegisterMetaType<TrimJobResult>();
+}
+
+TrimPool::~TrimPool() {
+    stop();
+}
+
+bool TrimPool::start(QString *errorMessage) {
+    if (!m_threads.empty()) {
+        return true;
+    }
+
+    for (int i = 0; i < m_workerCount; ++i) {
+        std::unique_ptr<QThread> thread(QThread::create([this, i]() { runWorker(i); }));
+        thread->setObjectName(QStringLiteral("trim-worker-%1").arg(i));
+        thread->start();
+        m_threads.push_back(std::move(thread));
+    }
+
+    QMutexLocker lock(&m_mutex);
+    while (m_loadedCount < m_workerCount) {
+        m_loaded.wait(&m_mutex);
+    }
+    if (!m_loadErrors.isEmpty()) {
+        const QString error = m_loadErrors.first();
+        lock.unlock();
+        stop();
+        if (errorMessage) {
+            *errorMessage = error;
+        }
+        return false;
+    }
+    return true;
+}
+
+void TrimPool::stop() {
+    QQueue<TrimJob> cancelled;
+    {
+        QMutexLocker lock(&m_mutex);
+        m_stopping = true;
+        cancelled.swap(m_queue);
+        m_wake.wakeAll();
+    }
+    for (const auto &thread : m_threads) {
+        thread->wait();
+    }
+    m_threads.clear();
+
+    // Results of the jobs the workers were running are already posted to
+    // this thread, so the cancelled jobs fail after them. A finished()
+    // handler may submit again; those jobs fail the same way, so drain until
+    // nothing is left in flight.
+    for (const TrimJob &job : std::as_const(cancelled)) {
+        postStopped(job.ticket);
+    }
+    while (m_inFlight > 0) {
+        QCoreApplication::sendPostedEvents(this, QEvent::MetaCall);
+    }
+}
+
+quint64 TrimPool::submit(TrimJob job) {
+    const quint64 ticket = m_nextTicket++;
+    job.ticket = ticket;
+    m_inFlight += 1;
+    QMutexLocker lock(&m_mutex);
+    if (m_stopping) {
+        // No worker is left to take the job. The failure is posted rather
+        // than emitted so the caller has the ticket before finished().
+        postStopped(ticket);
+        return ticket;
+    }
+    m_queue.enqueue(std::move(job));
+    m_wake.wakeOne();
+    return ticket;
+}
+
+void TrimPool::runWorker(int index) {
+    TrimCore core;
+    // Jobs are unrelated texts; reusing the previous job's analysis never
+    // applies, so the incremental trimmer would only add a prefix check.
+    core.setIncremental(false);
+    {
+        QString error;
+        const bool ok = core.load(m_bundlePath, &error);
+        QMutexLocker lock(&m_mutex);
+        if (!ok) {
+            m_loadErrors.append(error);
+        }
+        m_loadedCount += 1;
+        m_loaded.wakeAll();
+        if (!ok) {
+            return;
+        }
+    }
+
+    QElapsedTimer timer;
+    for (;;) {
+        TrimJob job;
+        {
+            QMutexLocker lock(&m_mutex);
+            while (m_queue.isEmpty() && !m_stopping) {
+                m_wake.wait(&m_mutex);
+            }
+            if (m_stopping) {
+                return;
+            }
+            job = m_queue.dequeue();
+        }
+
+        TrimJobResult result;
+        result.ticket = job.ticket;
+        result.worker = index;
+        timer.start();
+        {
+            AllocAccounting::Scope stage(AllocAccounting::Stage::Trim);
+            result.result = core.trim(job.input, job.aggressiveness, job.options, &result.error);
+        }
+        result.latencyNs = timer.nsecsElapsed();
+
+        QMetaObject::invokeMethod(this, [this, result]() { deliver(result); }, Qt::QueuedConnection);
+    }
+}
+
+void TrimPool::postStopped(quint64 ticket) {
+    TrimJobResult result;
+    result.ticket = ticket;
+    result.error = QString::fromLatin1(kStoppedError);
+    QMetaObject::invokeMethod(this, [this, result]() { deliver(result); }, Qt::QueuedConnection);
+}
+
+void TrimPool::deliver(const TrimJobResult &result) {
+    m_inFlight -= 1;
+    emit finished(result);
+}
@@ -0,0 +1,82 @@
+#pragma once
+
+#include "trim_core.h"
+
+#include <QMutex>
+#include <QObject>
+#include <QQueue>
+#include <QString>
+#include <QThread>
+#include <QVector>
+#include <QWaitCondition>
+
+#include <memory>
+#include <vector>
+
+struct TrimJob {
+    quint64 ticket = 0;
+    QString input;
+    QString aggressiveness = QStringLiteral("normal");
+    TrimOptions options;
+};
+
+struct TrimJobResult {
+    quint64 ticket = 0;
+    TrimResult result;
+    QString error;
+    int worker = -1;
+    qint64 latencyNs = 0;
+};
+
+Q_DECLARE_METATYPE(TrimJobResult)
+
+// A fixed set of worker threads, each owning its own TrimCore. QJSEngine is
+// thread-affine, so every engine is created and used on its worker only.
+//
+// submit() and the finished() signal belong to the thread that created the
+// pool. Results are delivered as they complete; callers that need input
+// order reorder by ticket.
+class TrimPool : public QObject {
+    Q_OBJECT
+public:
+    TrimPool(const QString &bundlePath, int workers, QObject *parent = nullptr);
+    ~TrimPool() override;
+
+    // Starts the workers and blocks until every engine has loaded.
+    bool start(QString *errorMessage = nullptr);
+    // Waits for the running jobs and cancels the queued ones. Before it
+    // returns, every submitted job has had its finished(); cancelled jobs
+    // carry an error.
+    void stop();
+
+    int workerCount() const { return m_workerCount; }
+    int inFlight() const { return m_inFlight; }
+
+    // Returns the job's ticket (assigned here; job.ticket is ignored). Once
+    // stop() has begun the job is failed at once: its finished() carries an
+    // error and arrives within stop(), or from the event loop afterwards.
+    quint64 submit(TrimJob job);
+
+signals:
+    void finished(const TrimJobResult &result);
+
+private:
+    void runWorker(int index);
+    void postStopped(quint64 ticket);
+    void deliver(const TrimJobResult &result);
+
+    QString m_bundlePath;
+    int m_workerCount = 1;
+    std::vector<std::unique_ptr<QThread>> m_threads;
+
+    QMutex m_mutex;
+    QWaitCondition m_wake;
+    QWaitCondition m_loaded;
+    QQueue<TrimJob> m_queue;
+    QStringList m_loadErrors;
+    int m_loadedCount = 0;
+    bool m_stopping = false;
+
+    quint64 m_nextTicket = 0;
+    int m_inFlight = 0;
+};
@@ -0,0 +1,390 @@
+#include "trim_server.h"
+
+#include <QCoreApplication>
+#include <QFile>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QLocalServer>
+#include <QSocketNotifier>
+#include <QTextStream>
+#include <QThread>
+
+#include <algorithm>
+#include <cerrno>
+#include <cstdio>
+#include <functional>
+#include <utility>
+
+#include <fcntl.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+namespace {
+constexpr qsizetype kReadChunk = 64 * 1024;
+
+// Hands accepted connections over as descriptors. QLocalSocket closes the
+// whole connection as soon as the peer shuts down its write side, which
+// would lose the responses a half-closing client is still waiting for.
+class DescriptorServer final : public QLocalServer {
+public:
+    std::function<void(qintptr)> onConnection;
+
+protected:
+    void incomingConnection(quintptr socketDescriptor) override {
+        onConnection(static_cast<qintptr>(socketDescriptor));
+    }
+};
+
+bool getBool(const QJsonObject &obj, const QString &key, bool fallback) {
+    const QJsonValue value = obj.value(key);
+    return value.isBool() ? value.toBool() : fallback;
+}
+
+int getInt(const QJsonObject &obj, const QString &key, int fallback) {
+    const QJsonValue value = obj.value(key);
+    return value.isDouble() ? value.toInt() : fallback;
+}
+
+QStringList getStringList(const QJsonObject &obj, const QString &key, const QStringList &fallback) {
+    const QJsonValue value = obj.value(key);
+    if (!value.isArray()) {
+        return fallback;
+    }
+    QStringList list;
+    for (const QJsonValue &item : value.toArray()) {
+        if (item.isString()) {
+            list.append(item.toString());
+        }
+    }
+    return list;
+}
+
+QByteArray encode(const QJsonObject &obj) {
+    QByteArray line = QJsonDocument(obj).toJson(QJsonDocument::Compact);
+    line.append('\n');
+    return line;
+}
+
+QByteArray errorLine(const QJsonValue &id, const QString &message) {
+    QJsonObject obj;
+    obj.insert(QStringLiteral("id"), id);
+    obj.insert(QStringLiteral("error"), message);
+    return encode(obj);
+}
+}
+
+TrimServer::TrimServer(TrimPool *pool, int window, QObject *parent)
+    : QObject(parent)
+    , m_pool(pool)
+    , m_window(std::max(1, window)) {
+    connect(m_pool, &TrimPool::finished, this, &TrimServer::onPoolFinished);
+    m_clock.start();
+}
+
+TrimServer::~TrimServer() {
+    for (const auto &stream : m_streams) {
+        if (stream->fd >= 0) {
+            ::close(stream->fd);
+        }
+    }
+    if (m_stdinReader && m_stdinReader->isRunning()) {
+        // Still blocked in read(); unblock the window so it exits at EOF and
+        // do not join it on the way out.
+        m_stdinWindow.release(m_window);
+        if (!m_stdinReader->wait(100)) {
+            m_stdinReader.release();
+        }
+    }
+}
+
+void TrimServer::serveStdio() {
+    auto stream = std::make_unique<Stream>();
+    auto *out = new QFile(this);
+    out->open(stdout, QIODevice::WriteOnly | QIODevice::Unbuffered);
+    stream->out = out;
+    m_stdio = stream.get();
+    m_streams.push_back(std::move(stream));
+
+    m_stdinWindow.release(m_window);
+    m_stdinReader.reset(QThread::create([this]() {
+        QFile in;
+        if (in.open(stdin, QIODevice::ReadOnly)) {
+            for (;;) {
+                m_stdinWindow.acquire();
+                const QByteArray line = in.readLine();
+                if (line.isEmpty()) {
+                    break;
+                }
+                QMetaObject::invokeMethod(this, [this, line]() { handleLine(m_stdio, line); },
+                                          Qt::QueuedConnection);
+            }
+        }
+        QMetaObject::invokeMethod(this, [this]() {
+            m_stdinDone = true;
+            m_stdio->inputClosed = true;
+            maybeQuit();
+        }, Qt::QueuedConnection);
+    }));
+    m_stdinReader->start();
+}
+
+bool TrimServer::listen(const QString &socketPath, QString *errorMessage) {
+    auto server = std::make_unique<DescriptorServer>();
+    server->onConnection = [this](qintptr fd) { acceptClient(fd); };
+    QLocalServer::removeServer(socketPath);
+    if (!server->listen(socketPath)) {
+        if (errorMessage) {
+            *errorMessage = QStringLiteral("Failed to listen on %1: %2")
+                                .arg(socketPath, server->errorString());
+        }
+        return false;
+    }
+    m_server = std::move(server);
+    return true;
+}
+
+void TrimServer::acceptClient(qintptr fd) {
+    const int flags = ::fcntl(fd, F_GETFL);
+    if (flags < 0 || ::fcntl(fd, F_SETFL, flags | O_NONBLOCK) < 0) {
+        ::close(fd);
+        return;
+    }
+    auto stream = std::make_unique<Stream>();
+    Stream *raw = stream.get();
+    stream->fd = fd;
+    stream->readNotifier = new QSocketNotifier(fd, QSocketNotifier::Read, this);
+    connect(stream->readNotifier, &QSocketNotifier::activated, this, [this, raw]() { readSocket(raw); });
+    stream->writeNotifier = new QSocketNotifier(fd, QSocketNotifier::Write, this);
+    stream->writeNotifier->setEnabled(false);
+    connect(stream->writeNotifier, &QSocketNotifier::activated, this, [this, raw]() {
+        flushOutput(raw);
+        closeStream(raw);
+    });
+    m_streams.push_back(std::move(stream));
+}
+
+void TrimServer::readSocket(Stream *stream) {
+    const qsizetype buffered = stream->input.size();
+    stream->input.resize(buffered + kReadChunk);
+    const ssize_t n = ::read(stream->fd, stream->input.data() + buffered, static_cast<size_t>(kReadChunk));
+    stream->input.truncate(buffered + std::max<ssize_t>(n, 0));
+    if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR)) {
+        return;
+    }
+    if (n <= 0) {
+        // End of requests, not of the connection: the client may only have
+        // shut down its write side and still be reading responses.
+        stream->inputClosed = true;
+        stream->readNotifier->setEnabled(false);
+    }
+    handleBuffered(stream);
+}
+
+void TrimServer::handleBuffered(Stream *stream) {
+    // respond() comes back here for requests that fail before reaching the
+    // pool; the outer call keeps going instead.
+    if (stream->draining) {
+        return;
+    }
+    stream->draining = true;
+    while (stream->inFlight < m_window) {
+        const qsizetype newline = stream->input.indexOf('\n');
+        if (newline >= 0) {
+            const QByteArray line = stream->input.left(newline + 1);
+            stream->input.remove(0, newline + 1);
+            handleLine(stream, line);
+        } else if (stream->inputClosed && !stream->input.isEmpty()) {
+            // A last request without a newline still counts at end of input.
+            handleLine(stream, std::exchange(stream->input, QByteArray()));
+        } else {
+            break;
+        }
+    }
+    stream->draining = false;
+    if (!stream->inputClosed) {
+        stream->readNotifier->setEnabled(stream->inFlight < m_window);
+    }
+    closeStream(stream);
+}
+
+void TrimServer::flushOutput(Stream *stream) {
+    while (!stream->output.isEmpty() && !stream->outputClosed) {
+        const ssize_t n = ::send(stream->fd, stream->output.constData(),
+                                 static_cast<size_t>(stream->output.size()), MSG_NOSIGNAL);
+        if (n > 0) {
+            stream->output.remove(0, n);
+        } else if (n < 0 && errno == EINTR) {
+            continue;
+        } else if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+            break;
+        } else {
+            // The client is gone for good; the rest of its responses are
+            // dropped and nothing more is read from it.
+            stream->outputClosed = true;
+            stream->output.clear();
+            stream->inputClosed = true;
+            stream->readNotifier->setEnabled(false);
+        }
+    }
+    stream->writeNotifier->setEnabled(!stream->output.isEmpty());
+}
+
+void TrimServer::handleLine(Stream *stream, const QByteArray &line) {
+    const QByteArray trimmed = line.trimmed();
+    if (trimmed.isEmpty()) {
+        if (stream == m_stdio) {
+            m_stdinWindow.release();
+        }
+        return;
+    }
+
+    m_requests += 1;
+    m_inputBytes += static_cast<quint64>(line.size());
+    const quint64 seq = stream->nextSeq++;
+    stream->inFlight += 1;
+
+    QJsonParseError parseError;
+    const QJsonDocument doc = QJsonDocument::fromJson(trimmed, &parseError);
+    if (parseError.error != QJsonParseError::NoError || !doc.isObject()) {
+        const QString message = parseError.error != QJsonParseError::NoError
+            ? QStringLiteral("Invalid JSON: %1").arg(parseError.errorString())
+            : QStringLiteral("Request is not an object");
+        respond(stream, seq, errorLine(QJsonValue(), message), true);
+        return;
+    }
+
+    const QJsonObject obj = doc.object();
+    const QJsonValue id = obj.value(QStringLiteral("id"));
+    if (!obj.value(QStringLiteral("input")).isString()) {
+        respond(stream, seq, errorLine(id, QStringLiteral("Missing string field: input")), true);
+        return;
+    }
+
+    TrimJob job;
+    job.input = obj.value(QStringLiteral("input")).toString();
+    job.aggressiveness = obj.value(QStringLiteral("aggressiveness")).toString(QStringLiteral("normal"));
+    if (obj.value(QStringLiteral("options")).isObject()) {
+        const QJsonObject opts = obj.value(QStringLiteral("options")).toObject();
+        job.options.keepBlankLines = getBool(opts, QStringLiteral("keep_blank_lines"), job.options.keepBlankLines);
+        job.options.stripBoxChars = getBool(opts, QStringLiteral("strip_box_chars"), job.options.stripBoxChars);
+        job.options.trimPrompts = getBool(opts, QStringLiteral("trim_prompts"), job.options.trimPrompts);
+        job.options.maxLines = getInt(opts, QStringLiteral("max_lines"), job.options.maxLines);
+        job.options.largeSnippets = getBool(opts, QStringLiteral("large_snippets"), job.options.largeSnippets);
+        job.options.extraPrefixes = getStringList(opts, QStringLiteral("extra_prefixes"), job.options.extraPrefixes);
+    }
+
+    Pending pending;
+    pending.stream = stream;
+    pending.seq = seq;
+    pending.id = id;
+    const quint64 ticket = m_pool->submit(std::move(job));
+    m_pending.insert(ticket, pending);
+}
+
+void TrimServer::onPoolFinished(const TrimJobResult &result) {
+    const auto it = m_pending.find(result.ticket);
+    if (it == m_pending.end()) {
+        return;
+    }
+    const Pending pending = it.value();
+    m_pending.erase(it);
+    m_workNs += result.latencyNs;
+    m_trimmed += 1;
+
+    if (!result.error.isEmpty()) {
+        respond(pending.stream, pending.seq, errorLine(pending.id, result.error), true);
+        return;
+    }
+
+    QJsonObject obj;
+    obj.insert(QStringLiteral("id"), pending.id);
+    obj.insert(QStringLiteral("output"), result.result.output);
+    obj.insert(QStringLiteral("changed"), result.result.changed);
+    if (!result.result.reason.isEmpty()) {
+        obj.insert(QStringLiteral("reason"), result.result.reason);
+    }
+    respond(pending.stream, pending.seq, encode(obj), false);
+}
+
+void TrimServer::respond(Stream *stream, quint64 seq, const QByteArray &line, bool isError) {
+    if (isError) {
+        m_errors += 1;
+    }
+    stream->ready.insert(seq, line);
+
+    // Everything that is now contiguous goes out in one write.
+    QByteArray batch;
+    int written = 0;
+    while (!stream->ready.isEmpty() && stream->ready.firstKey() == stream->nextToWrite) {
+        batch.append(stream->ready.take(stream->nextToWrite));
+        stream->nextToWrite += 1;
+        stream->inFlight -= 1;
+        written += 1;
+    }
+    if (!batch.isEmpty()) {
+        m_outputBytes += static_cast<quint64>(batch.size());
+        if (stream->out) {
+            stream->out->write(batch);
+        } else if (!stream->outputClosed) {
+            stream->output.append(batch);
+            flushOutput(stream);
+        }
+    }
+
+    if (stream == m_stdio) {
+        if (written > 0) {
+            m_stdinWindow.release(written);
+        }
+        maybeQuit();
+        return;
+    }
+    handleBuffered(stream);
+}
+
+void TrimServer::closeStream(Stream *stream) {
+    // A client stays open until it can send no more requests, every request
+    // it sent has been answered and the answers have left the buffer.
+    if (stream->draining || !stream->inputClosed || stream->inFlight > 0
+        || (!stream->output.isEmpty() && !stream->outputClosed)) {
+        return;
+    }
+    // This can run inside a notifier's own activated() signal.
+    stream->readNotifier->setEnabled(false);
+    stream->writeNotifier->setEnabled(false);
+    stream->readNotifier->deleteLater();
+    stream->writeNotifier->deleteLater();
+    ::close(stream->fd);
+    for (auto it = m_streams.begin(); it != m_streams.end(); ++it) {
+        if (it->get() == stream) {
+            m_streams.erase(it);
+            break;
+        }
+    }
+}
+
+void TrimServer::maybeQuit() {
+    if (!m_stdio || !m_stdinDone || m_stdio->inFlight > 0) {
+        return;
+    }
+    QCoreApplication::quit();
+}
+
+void TrimServer::printStats() const {
+    const double seconds = static_cast<double>(m_clock.nsecsElapsed()) / 1e9;
+    const double perSecond = seconds > 0 ? static_cast<double>(m_requests) / seconds : 0.0;
+    const double mbPerSecond = seconds > 0
+        ? static_cast<double>(m_inputBytes) / (1024.0 * 1024.0) / seconds
+        : 0.0;
+    const double meanUs = m_trimmed > 0
+        ? static_cast<double>(m_workNs) / 1000.0 / static_cast<double>(m_trimmed)
+        : 0.0;
+
+    QTextStream err(stderr);
+    err << "Served " << m_requests << " requests (" << m_errors << " errors) in "
+        << QString::number(seconds, 'f', 3) << " s with " << m_pool->workerCount() << " workers\n";
+    err << "  throughput: " << QString::number(perSecond, 'f', 1) << " req/s, "
+        << QString::number(mbPerSecond, 'f', 2) << " MiB/s in, "
+        << m_outputBytes << " bytes out\n";
+    err << "  engine time: " << QString::number(meanUs, 'f', 1) << " us/request (mean)\n";
+}
@@ -0,0 +1,100 @@
+#pragma once
+
+#include "trim_pool.h"
+
+#include <QByteArray>
+#include <QElapsedTimer>
+#include <QHash>
+#include <QJsonValue>
+#include <QMap>
+#include <QObject>
+#include <QSemaphore>
+#include <QString>
+
+#include <memory>
+#include <vector>
+
+class QIODevice;
+class QLocalServer;
+class QSocketNotifier;
+class QThread;
+
+// Newline-delimited JSON trim server on top of TrimPool.
+//
+// Request:  {"id": <any>, "input": "...", "aggressiveness": "normal",
+//            "options": {"keep_blank_lines": false, ...}}
+// Response: {"id": <same>, "output": "...", "changed": true, "reason": "..."}
+//        or {"id": <same>, "error": "..."}
+//
+// Responses on a stream are written in request order. Each stream has a
+// bounded window of requests in flight; reading pauses while it is full.
+// End of input only ends the requests: a socket client that shuts down its
+// write side (nc -N, socat) still gets every response before the server
+// closes the connection.
+class TrimServer : public QObject {
+    Q_OBJECT
+public:
+    TrimServer(TrimPool *pool, int window, QObject *parent = nullptr);
+    ~TrimServer() override;
+
+    // Serves stdin/stdout and quits the application once stdin is exhausted
+    // and every response has been written.
+    void serveStdio();
+    // Serves clients of a Unix socket until the application quits.
+    bool listen(const QString &socketPath, QString *errorMessage = nullptr);
+
+    // Throughput summary, written to stderr.
+    void printStats() const;
+
+private:
+    struct Stream {
+        // stdout for stdio; socket clients use fd and the notifiers.
+        QIODevice *out = nullptr;
+        int fd = -1;
+        QSocketNotifier *readNotifier = nullptr;
+        QSocketNotifier *writeNotifier = nullptr;
+        QByteArray input;
+        QByteArray output;
+        quint64 nextSeq = 0;
+        quint64 nextToWrite = 0;
+        QMap<quint64, QByteArray> ready;
+        int inFlight = 0;
+        bool inputClosed = false;
+        bool outputClosed = false;
+        bool draining = false;
+    };
+    struct Pending {
+        Stream *stream = nullptr;
+        quint64 seq = 0;
+        QJsonValue id;
+    };
+
+    void acceptClient(qintptr fd);
+    void handleLine(Stream *stream, const QByteArray &line);
+    void readSocket(Stream *stream);
+    void handleBuffered(Stream *stream);
+    void flushOutput(Stream *stream);
+    void onPoolFinished(const TrimJobResult &result);
+    void respond(Stream *stream, quint64 seq, const QByteArray &line, bool isError);
+    void closeStream(Stream *stream);
+    void maybeQuit();
+
+    TrimPool *m_pool = nullptr;
+    int m_window = 1;
+    std::unique_ptr<QLocalServer> m_server;
+    QHash<quint64, Pending> m_pending;
+    std::vector<std::unique_ptr<Stream>> m_streams;
+
+    Stream *m_stdio = nullptr;
+    std::unique_ptr<QThread> m_stdinReader;
+    QSemaphore m_stdinWindow;
+    bool m_stdinDone = false;
+
+    QElapsedTimer m_clock;
+    quint64 m_requests = 0;
+    quint64 m_errors = 0;
+    quint64 m_trimmed = 0;
+    quint64 m_inputBytes = 0;
+    quint64 m_outputBytes = 0;
+    qint64 m_workNs = 0;
+};
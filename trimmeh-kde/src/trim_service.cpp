@@ -0,0 +1,200 @@
+#include "trim_service.h"
+
+#include "app_identity.h"
+#include "clipboard_watcher.h"
+
+#include <QDBusConnection>
+#include <QDBusConnectionInterface>
+#include <QDBusError>
+
+#include <algorithm>
+
+namespace {
+constexpr const char kPath[] = "/Trim";
+constexpr const char kErrorName[] = "dev.trimmeh.TrimmehKDE.Error.TrimFailed";
+
+// Callers send unrelated texts, so the incremental trimmer would discard its
+// analysis on every call, and would also evict the clipboard watcher's,
+// which shares this core. Service trims take the one-shot path instead.
+class OneShotTrims {
+public:
+    explicit OneShotTrims(TrimCore *core)
+        : m_core(core)
+        , m_wasIncremental(core->isIncremental()) {
+        m_core->setIncremental(false);
+    }
+    ~OneShotTrims() { m_core->setIncremental(m_wasIncremental); }
+
+private:
+    TrimCore *m_core;
+    bool m_wasIncremental;
+};
+}
+
+TrimService::TrimService(ClipboardWatcher *watcher, TrimCore *core, QObject *parent)
+    : QObject(parent)
+    , m_watcher(watcher)
+    , m_core(core) {
+    m_clock.start();
+}
+
+bool TrimService::registerOnBus(QString *errorMessage) {
+    QDBusConnection bus = QDBusConnection::sessionBus();
+    if (!bus.isConnected()) {
+        if (errorMessage) {
+            *errorMessage = QStringLiteral("Failed to connect to session bus: %1")
+                                .arg(bus.lastError().message());
+        }
+        return false;
+    }
+
+    if (!bus.registerObject(QString::fromLatin1(kPath), this,
+                            QDBusConnection::ExportAllSlots | QDBusConnection::ExportAllProperties)) {
+        if (errorMessage) {
+            *errorMessage = QStringLiteral("Failed to export %1: %2")
+                                .arg(QString::fromLatin1(kPath), bus.lastError().message());
+        }
+        return false;
+    }
+
+    // A second instance (tray app and daemon side by side) keeps the object on
+    // its unique name only.
+    if (!bus.registerService(AppIdentity::appId())) {
+        if (errorMessage) {
+            *errorMessage = QStringLiteral("Trim service exported on %1 only; %2 is taken: %3")
+                                .arg(bus.baseService(), AppIdentity::appId(), bus.lastError().message());
+        }
+        return false;
+    }
+    return true;
+}
+
+QString TrimService::Trim(const QString &text,
+                          const QString &aggressiveness,
+                          const QVariantMap &options,
+                          bool &changed,
+                          QString &reason) {
+    const qint64 startNs = m_clock.nsecsElapsed();
+    changed = false;
+    QString level;
+    TrimOptions trimOptions;
+    if (!prepare(aggressiveness, options, &level, &trimOptions)) {
+        finishRequest(startNs, m_clock.nsecsElapsed(), true);
+        return QString();
+    }
+
+    QString error;
+    OneShotTrims oneShot(m_core);
+    const TrimResult result = m_core->trim(text, level, trimOptions, &error);
+    if (!error.isEmpty()) {
+        fail(error);
+        finishRequest(startNs, m_clock.nsecsElapsed(), true);
+        return QString();
+    }
+    m_trims += 1;
+
+    changed = result.changed;
+    reason = result.reason;
+    finishRequest(startNs, m_clock.nsecsElapsed(), false);
+    return result.output;
+}
+
+QStringList TrimService::TrimMany(const QStringList &texts,
+                                  const QString &aggressiveness,
+                                  const QVariantMap &options) {
+    const qint64 startNs = m_clock.nsecsElapsed();
+    QString level;
+    TrimOptions trimOptions;
+    if (!prepare(aggressiveness, options, &level, &trimOptions)) {
+        finishRequest(startNs, m_clock.nsecsElapsed(), true);
+        return QStringList();
+    }
+
+    QStringList outputs;
+    outputs.reserve(texts.size());
+    OneShotTrims oneShot(m_core);
+    for (const QString &text : texts) {
+        QString error;
+        const TrimResult result = m_core->trim(text, level, trimOptions, &error);
+        if (!error.isEmpty()) {
+            fail(QStringLiteral("Item %1: %2").arg(outputs.size()).arg(error));
+            finishRequest(startNs, m_clock.nsecsElapsed(), true);
+            return QStringList();
+        }
+        m_trims += 1;
+        outputs.append(result.output);
+    }
+
+    finishRequest(startNs, m_clock.nsecsElapsed(), false);
+    return outputs;
+}
+
+void TrimService::ResetCounters() {
+    m_requests = 0;
+    m_trims = 0;
+    m_errors = 0;
+    m_totalLatencyNs = 0;
+    m_maxLatencyNs = 0;
+}
+
+bool TrimService::prepare(const QString &aggressiveness,
+                          const QVariantMap &options,
+                          QString *level,
+                          TrimOptions *trimOptions) {
+    const SettingsSnapshotPtr snapshot = m_watcher->settingsSnapshot();
+    *trimOptions = snapshot->trimOptions;
+    *level = aggressiveness.isEmpty() ? snapshot->settings.aggressiveness : aggressiveness;
+    if (*level != QLatin1String("low") && *level != QLatin1String("normal")
+        && *level != QLatin1String("high")) {
+        fail(QStringLiteral("Unknown aggressiveness '%1' (expected low, normal or high)").arg(*level));
+        return false;
+    }
+
+    if (options.contains(QStringLiteral("keepBlankLines"))) {
+        trimOptions->keepBlankLines = options.value(QStringLiteral("keepBlankLines")).toBool();
+    }
+    if (options.contains(QStringLiteral("stripBoxChars"))) {
+        trimOptions->stripBoxChars = options.value(QStringLiteral("stripBoxChars")).toBool();
+    }
+    if (options.contains(QStringLiteral("trimPrompts"))) {
+        trimOptions->trimPrompts = options.value(QStringLiteral("trimPrompts")).toBool();
+    }
+    if (options.contains(QStringLiteral("maxLines"))) {
+        bool ok = false;
+        const int maxLines = options.value(QStringLiteral("maxLines")).toInt(&ok);
+        if (!ok || maxLines < 1) {
+            fail(QStringLiteral("maxLines must be a positive integer"));
+            return false;
+        }
+        trimOptions->maxLines = maxLines;
+    }
+    if (options.contains(QStringLiteral("largeSnippets"))) {
+        trimOptions->largeSnippets = options.value(QStringLiteral("largeSnippets")).toBool();
+    }
+    if (options.contains(QStringLiteral("extraPrefixes"))) {
+        trimOptions->extraPrefixes = options.value(QStringLiteral("extraPrefixes")).toStringList();
+    }
+
+    QString error;
+    if (!m_core->ensureLoaded(&error)) {
+        fail(error);
+        return false;
+    }
+    return true;
+}
+
+void TrimService::finishRequest(qint64 startNs, qint64 endNs, bool failed) {
+    const qulonglong latencyNs = static_cast<qulonglong>(std::max<qint64>(0, endNs - startNs));
+    m_requests += 1;
+    if (failed) {
+        m_errors += 1;
+    }
+    m_totalLatencyNs += latencyNs;
+    m_maxLatencyNs = std::max(m_maxLatencyNs, latencyNs);
+}
+
+void TrimService::fail(const QString &message) {
+    if (calledFromDBus()) {
+        sendErrorReply(QString::fromLatin1(kErrorName), message);
+    }
+}
@@ -0,0 +1,71 @@
+#pragma once
+
+#include "trim_core.h"
+
+#include <QDBusContext>
+#include <QElapsedTimer>
+#include <QObject>
+#include <QString>
+#include <QStringList>
+#include <QVariantMap>
+
+class ClipboardWatcher;
+
+// Exports the warm TrimCore on the session bus so scripts and editors can trim
+// through the running app instead of starting a process per snippet.
+//
+// Service: dev.trimmeh.TrimmehKDE, path: /Trim,
+// interface: dev.trimmeh.TrimmehKDE.Trim
+class TrimService : public QObject, protected QDBusContext {
+    Q_OBJECT
+    Q_CLASSINFO("D-Bus Interface", "dev.trimmeh.TrimmehKDE.Trim")
+    Q_PROPERTY(qulonglong RequestCount READ requestCount)
+    Q_PROPERTY(qulonglong TrimCount READ trimCount)
+    Q_PROPERTY(qulonglong ErrorCount READ errorCount)
+    Q_PROPERTY(qulonglong TotalLatencyUsec READ totalLatencyUsec)
+    Q_PROPERTY(qulonglong MaxLatencyUsec READ maxLatencyUsec)
+public:
+    TrimService(ClipboardWatcher *watcher, TrimCore *core, QObject *parent = nullptr);
+
+    bool registerOnBus(QString *errorMessage = nullptr);
+
+    qulonglong requestCount() const { return m_requests; }
+    qulonglong trimCount() const { return m_trims; }
+    qulonglong errorCount() const { return m_errors; }
+    qulonglong totalLatencyUsec() const { return m_totalLatencyNs / 1000; }
+    qulonglong maxLatencyUsec() const { return m_maxLatencyNs / 1000; }
+
+public slots:
+    // An empty aggressiveness and any option missing from the map fall back
+    // to the user's current settings. Recognised option keys: keepBlankLines,
+    // stripBoxChars, trimPrompts, largeSnippets (b), maxLines (i) and
+    // extraPrefixes (as).
+    QString Trim(const QString &text,
+                 const QString &aggressiveness,
+                 const QVariantMap &options,
+                 bool &changed,
+                 QString &reason);
+    // One call, one options parse and one engine check for the whole batch.
+    // Outputs are returned in input order.
+    QStringList TrimMany(const QStringList &texts,
+                         const QString &aggressiveness,
+                         const QVariantMap &options);
+    void ResetCounters();
+
+private:
+    bool prepare(const QString &aggressiveness,
+                 const QVariantMap &options,
+                 QString *level,
+                 TrimOptions *trimOptions);
+    void finishRequest(qint64 startNs, qint64 endNs, bool failed);
+    void fail(const QString &message);
+
+    ClipboardWatcher *m_watcher = nullptr;
+    TrimCore *m_core = nullptr;
+    QElapsedTimer m_clock;
+    qulonglong m_requests = 0;
+    qulonglong m_trims = 0;
+    qulonglong m_errors = 0;
+    qulonglong m_totalLatencyNs = 0;
+    qulonglong m_maxLatencyNs = 0;
+};
@@ -1,15 +1,84 @@
+#include "alloc_accounting.h"
 #include "trim_core.h"
+#include "trim_pool.h"
+#include "trim_server.h"
 
 #include <QCommandLineParser>
 #include <QCoreApplication>
 #include <QDir>
+#include <QElapsedTimer>
+#include <QEventLoop>
 #include <QFile>
+#include <QHash>
 #include <QJsonArray>
 #include <QJsonDocument>
 #include <QJsonObject>
+#include <QMap>
+#include <QRegularExpression>
+#include <QSocketNotifier>
 #include <QTextStream>
+#include <QThread>
+
+#include <csignal>
+#include <cstring>
+#include <functional>
+#include <memory>
+#include <sys/socket.h>
+#include <unistd.h>
 
 namespace {
+int g_signalFds[2] = {-1, -1};
+
+void onQuitSignal(int) {
+    const char byte = 1;
+    const ssize_t ignored = ::write(g_signalFds[0], &byte, 1);
+    (void)ignored;
+}
+
+// SIGINT/SIGTERM end the event loop normally so the server can print stats.
+void installQuitSignalHandlers(QCoreApplication *app) {
+    if (::socketpair(AF_UNIX, SOCK_STREAM, 0, g_signalFds) != 0) {
+        return;
+    }
+    auto *notifier = new QSocketNotifier(g_signalFds[1], QSocketNotifier::Read, app);
+    QObject::connect(notifier, &QSocketNotifier::activated, app, []() {
+        char byte = 0;
+        const ssize_t ignored = ::read(g_signalFds[1], &byte, 1);
+        (void)ignored;
+        QCoreApplication::quit();
+    });
+    std::signal(SIGINT, onQuitSignal);
+    std::signal(SIGTERM, onQuitSignal);
+}
+
+int runServer(QCoreApplication &app, const QString &corePath, int workers, const QString &socketPath) {
+    QTextStream err(stderr);
+
+    TrimPool pool(corePath, workers);
+    QString error;
+    if (!pool.start(&error)) {
+        err << "Failed to load core JS: " << error << "\n";
+        err << "Path: " << corePath << "\n";
+        return 2;
+    }
+
+    TrimServer server(&pool, workers * 4);
+    if (socketPath.isEmpty()) {
+        server.serveStdio();
+    } else if (!server.listen(socketPath, &error)) {
+        err << error << "\n";
+        return 3;
+    } else {
+        err << "Listening on " << socketPath << "\n";
+        err.flush();
+        installQuitSignalHandlers(&app);
+    }
+
+    const int rc = app.exec();
+    server.printStats();
+    return rc;
+}
+
 QString defaultCorePath() {
     return QDir(QCoreApplication::applicationDirPath())
         .filePath(QStringLiteral("trimmeh-core.js"));
@@ -37,6 +106,352 @@ int getInt(const QJsonObject &obj, const QString &key, int fallback) {
     const QJsonValue value = obj.value(key);
     return value.isDouble() ? value.toInt() : fallback;
 }
+
+QStringList getStringList(const QJsonObject &obj, const QString &key, const QStringList &fallback) {
+    const QJsonValue value = obj.value(key);
+    if (!value.isArray()) {
+        return fallback;
+    }
+    QStringList list;
+    for (const QJsonValue &item : value.toArray()) {
+        if (item.isString()) {
+            list.append(item.toString());
+        }
+    }
+    return list;
+}
+
+bool parsePositive(const QString &text, int *value) {
+    bool ok = false;
+    const int parsed = text.toInt(&ok);
+    if (!ok || parsed < 1) {
+        return false;
+    }
+    *value = parsed;
+    return true;
+}
+
+// .jsonl/.ndjson, or anything that does not start with a JSON array.
+bool isJsonLines(const QString &path) {
+    if (path.endsWith(QLatin1String(".jsonl")) || path.endsWith(QLatin1String(".ndjson"))) {
+        return true;
+    }
+    QFile file(path);
+    if (!file.open(QIODevice::ReadOnly)) {
+        return false;
+    }
+    const QByteArray head = file.peek(4096).trimmed();
+    return !head.isEmpty() && !head.startsWith('[');
+}
+
+struct VectorCase {
+    QString name;
+    TrimJob job;
+    QString expectedOutput;
+    bool expectedChanged = false;
+    QString expectedReason;
+    // Set when the case itself is malformed; the case then counts as failed
+    // without being trimmed.
+    QString invalid;
+};
+
+VectorCase parseCase(const QJsonValue &value, int index) {
+    VectorCase vc;
+    vc.name = QStringLiteral("case_%1").arg(index);
+    if (!value.isObject()) {
+        vc.invalid = QStringLiteral("Case %1 is not an object").arg(index);
+        return vc;
+    }
+    const QJsonObject obj = value.toObject();
+    bool ok = true;
+    vc.name = obj.value(QStringLiteral("name")).toString(vc.name);
+    vc.job.input = requiredString(obj, QStringLiteral("input"), &ok);
+    vc.job.aggressiveness = obj.value(QStringLiteral("aggressiveness"))
+        .toString(QStringLiteral("normal"));
+    if (!ok) {
+        vc.invalid = vc.name + QStringLiteral(": missing required fields");
+        return vc;
+    }
+
+    TrimOptions &options = vc.job.options;
+    if (obj.contains(QStringLiteral("options")) && obj.value(QStringLiteral("options")).isObject()) {
+        const QJsonObject opts = obj.value(QStringLiteral("options")).toObject();
+        options.keepBlankLines = getBool(opts, QStringLiteral("keep_blank_lines"), options.keepBlankLines);
+        options.stripBoxChars = getBool(opts, QStringLiteral("strip_box_chars"), options.stripBoxChars);
+        options.trimPrompts = getBool(opts, QStringLiteral("trim_prompts"), options.trimPrompts);
+        options.maxLines = getInt(opts, QStringLiteral("max_lines"), options.maxLines);
+        options.largeSnippets = getBool(opts, QStringLiteral("large_snippets"), options.largeSnippets);
+        options.extraPrefixes = getStringList(opts, QStringLiteral("extra_prefixes"), options.extraPrefixes);
+    }
+
+    if (!obj.contains(QStringLiteral("expected")) || !obj.value(QStringLiteral("expected")).isObject()) {
+        vc.invalid = vc.name + QStringLiteral(": missing expected");
+        return vc;
+    }
+    const QJsonObject expected = obj.value(QStringLiteral("expected")).toObject();
+    vc.expectedOutput = expected.value(QStringLiteral("output")).toString();
+    vc.expectedChanged = expected.value(QStringLiteral("changed")).toBool();
+    vc.expectedReason = expected.value(QStringLiteral("reason")).toString();
+    return vc;
+}
+
+bool checkCase(const VectorCase &vc, const TrimResult &result, const QString &error, QTextStream &err) {
+    if (!error.isEmpty()) {
+        err << vc.name << ": trim error: " << error << "\n";
+        return false;
+    }
+
+    bool pass = true;
+    if (result.output != vc.expectedOutput) {
+        err << vc.name << ": output mismatch\n";
+        err << "  expected: " << vc.expectedOutput << "\n";
+        err << "  actual:   " << result.output << "\n";
+        pass = false;
+    }
+    if (result.changed != vc.expectedChanged) {
+        err << vc.name << ": changed mismatch (expected "
+            << (vc.expectedChanged ? "true" : "false")
+            << ", got " << (result.changed ? "true" : "false") << ")\n";
+        pass = false;
+    }
+    if (!vc.expectedReason.isEmpty() && result.reason != vc.expectedReason) {
+        err << vc.name << ": reason mismatch (expected "
+            << vc.expectedReason << ", got " << result.reason << ")\n";
+        pass = false;
+    }
+    return pass;
+}
+
+// Yields cases one at a time and returns false once exhausted, so runners
+// never need the whole corpus in memory.
+using CaseSource = std::function<bool(VectorCase *)>;
+
+class JsonArraySource {
+public:
+    explicit JsonArraySource(QJsonArray cases) : m_cases(std::move(cases)) {}
+
+    bool next(VectorCase *vc) {
+        if (m_index >= m_cases.size()) {
+            return false;
+        }
+        *vc = parseCase(m_cases.at(m_index), m_index);
+        m_index += 1;
+        return true;
+    }
+
+private:
+    QJsonArray m_cases;
+    int m_index = 0;
+};
+
+// One JSON case per line, read straight out of a read-only mapping; only the
+// current line is ever parsed. Blank lines are skipped.
+class JsonlSource {
+public:
+    bool open(const QString &path, QString *errorMessage) {
+        m_file.setFileName(path);
+        if (!m_file.open(QIODevice::ReadOnly)) {
+            *errorMessage = QStringLiteral("Failed to open vectors: %1").arg(path);
+            return false;
+        }
+        m_size = m_file.size();
+        if (m_size == 0) {
+            return true;
+        }
+        m_data = reinterpret_cast<const char *>(m_file.map(0, m_size));
+        if (!m_data) {
+            *errorMessage = QStringLiteral("Failed to map vectors: %1").arg(m_file.errorString());
+            return false;
+        }
+        return true;
+    }
+
+    bool next(VectorCase *vc) {
+        while (m_offset < m_size) {
+            const char *begin = m_data + m_offset;
+            const auto *newline = static_cast<const char *>(
+                std::memchr(begin, '\n', static_cast<size_t>(m_size - m_offset)));
+            const qint64 length = newline ? newline - begin : m_size - m_offset;
+            m_offset += length + 1;
+            m_line += 1;
+
+            const QByteArray line = QByteArray::fromRawData(begin, static_cast<int>(length)).trimmed();
+            if (line.isEmpty()) {
+                continue;
+            }
+            QJsonParseError parseError;
+            const QJsonDocument doc = QJsonDocument::fromJson(line, &parseError);
+            if (parseError.error != QJsonParseError::NoError) {
+                *vc = VectorCase();
+                vc->name = QStringLiteral("line_%1").arg(m_line);
+                vc->invalid = QStringLiteral("Line %1: %2").arg(m_line).arg(parseError.errorString());
+                return true;
+            }
+            if (!doc.isObject()) {
+                *vc = VectorCase();
+                vc->name = QStringLiteral("line_%1").arg(m_line);
+                vc->invalid = QStringLiteral("Line %1 is not an object").arg(m_line);
+                return true;
+            }
+            *vc = parseCase(doc.object(), m_line);
+            return true;
+        }
+        return false;
+    }
+
+private:
+    QFile m_file;
+    const char *m_data = nullptr;
+    qint64 m_size = 0;
+    qint64 m_offset = 0;
+    int m_line = 0;
+};
+
+struct RunStats {
+    int cases = 0;
+    int total = 0;
+    int failures = 0;
+};
+
+RunStats runSequential(const CaseSource &source, TrimCore *core, QTextStream &err) {
+    RunStats stats;
+    VectorCase vc;
+    while (source(&vc)) {
+        stats.cases += 1;
+        if (!vc.invalid.isEmpty()) {
+            err << vc.invalid << "\n";
+            stats.failures += 1;
+            continue;
+        }
+        QString error;
+        TrimResult result;
+        {
+            AllocAccounting::Scope stage(AllocAccounting::Stage::Trim);
+            result = core->trim(vc.job.input, vc.job.aggressiveness, vc.job.options, &error);
+        }
+        stats.total += 1;
+        if (!checkCase(vc, result, error, err)) {
+            stats.failures += 1;
+        }
+    }
+    return stats;
+}
+
+// Checks each case like runSequential(), then replays its input as a
+// selection growing one code unit at a time: every prefix goes through the
+// incremental core, which keeps the previous prefix's line analysis, and
+// must trim exactly like a fresh core.
+RunStats runIncremental(const CaseSource &source, TrimCore *core, TrimCore *fresh, QTextStream &err) {
+    RunStats stats;
+    VectorCase vc;
+    while (source(&vc)) {
+        stats.cases += 1;
+        if (!vc.invalid.isEmpty()) {
+            err << vc.invalid << "\n";
+            stats.failures += 1;
+            continue;
+        }
+        bool pass = true;
+        const QString &input = vc.job.input;
+        for (qsizetype end = 1; end < input.size() && pass; ++end) {
+            const QString prefix = input.left(end);
+            QString error;
+            QString freshError;
+            const TrimResult result = core->trim(prefix, vc.job.aggressiveness, vc.job.options, &error);
+            const TrimResult expected = fresh->trim(prefix, vc.job.aggressiveness, vc.job.options, &freshError);
+            if (error != freshError || result.output != expected.output ||
+                result.changed != expected.changed || result.reason != expected.reason) {
+                err << vc.name << ": incremental trim differs at prefix " << end << "\n";
+                err << "  fresh:       " << expected.output << " (" << expected.reason << ")\n";
+                err << "  incremental: " << result.output << " (" << result.reason << ")\n";
+                pass = false;
+            }
+        }
+        QString error;
+        const TrimResult result = core->trim(input, vc.job.aggressiveness, vc.job.options, &error);
+        stats.total += 1;
+        if (!checkCase(vc, result, error, err) || !pass) {
+            stats.failures += 1;
+        }
+    }
+    return stats;
+}
+
+// Shards cases across the pool's engines. Results are reported in case
+// order regardless of which worker finishes first, so output is identical
+// to a sequential run. Only the cases inside the window are held.
+RunStats runParallel(const CaseSource &source, TrimPool *pool, QTextStream &err) {
+    struct Slot {
+        VectorCase vc;
+        TrimJobResult result;
+        bool done = false;
+    };
+
+    RunStats stats;
+    QEventLoop loop;
+    QHash<quint64, int> seqForTicket;
+    QMap<int, Slot> slots;
+    const int window = pool->workerCount() * 8;
+    int nextSeq = 0;
+    bool exhausted = false;
+
+    // Reports every finished case at the head of the window, then tops the
+    // window back up from the source.
+    auto pump = [&]() {
+        for (;;) {
+            while (!slots.isEmpty() && slots.first().done) {
+                const Slot &slot = slots.first();
+                stats.cases += 1;
+                if (!slot.vc.invalid.isEmpty()) {
+                    err << slot.vc.invalid << "\n";
+                    stats.failures += 1;
+                } else {
+                    stats.total += 1;
+                    if (!checkCase(slot.vc, slot.result.result, slot.result.error, err)) {
+                        stats.failures += 1;
+                    }
+                }
+                slots.erase(slots.begin());
+            }
+
+            bool headDone = false;
+            while (!exhausted && slots.size() < window) {
+                Slot slot;
+                if (!source(&slot.vc)) {
+                    exhausted = true;
+                    break;
+                }
+                if (slot.vc.invalid.isEmpty()) {
+                    seqForTicket.insert(pool->submit(slot.vc.job), nextSeq);
+                } else {
+                    slot.done = true;
+                }
+                slots.insert(nextSeq, std::move(slot));
+                nextSeq += 1;
+            }
+            headDone = !slots.isEmpty() && slots.first().done;
+            if (!headDone) {
+                break;
+            }
+        }
+        if (exhausted && slots.isEmpty()) {
+            loop.quit();
+        }
+    };
+
+    QObject::connect(pool, &TrimPool::finished, &loop, [&](const TrimJobResult &result) {
+        Slot &slot = slots[seqForTicket.take(result.ticket)];
+        slot.result = result;
+        slot.done = true;
+        pump();
+    });
+    pump();
+    if (!exhausted || !slots.isEmpty()) {
+        loop.exec();
+    }
+    return stats;
+}
+
 }
 
 int main(int argc, char **argv) {
@@ -54,123 +469,182 @@ int main(int argc, char **argv) {
     QCommandLineOption vectorsOpt(QStringList() << QStringLiteral("t") << QStringLiteral("vectors"),
                                   QStringLiteral("Path to trim-vectors.json"),
                                   QStringLiteral("path"));
+    QCommandLineOption jobsOpt(QStringList() << QStringLiteral("j") << QStringLiteral("jobs"),
+                               QStringLiteral("Number of trim engines to shard cases across (default: 1)"),
+                               QStringLiteral("n"));
+    QCommandLineOption filterOpt(QStringLiteral("filter"),
+                                 QStringLiteral("Only run cases whose name matches this regular expression"),
+                                 QStringLiteral("name-regex"));
+    QCommandLineOption limitOpt(QStringLiteral("limit"),
+                                QStringLiteral("Stop after this many cases (after --filter)"),
+                                QStringLiteral("n"));
+    QCommandLineOption incrementalOpt(QStringLiteral("incremental"),
+                                      QStringLiteral("Also trim every prefix of each input as a growing selection and "
+                                                     "check the incremental engine against a fresh one"));
+    QCommandLineOption serveOpt(QStringLiteral("serve"),
+                                QStringLiteral("Serve JSON-lines trim requests on stdin/stdout instead of running vectors"));
+    QCommandLineOption socketOpt(QStringLiteral("socket"),
+                                 QStringLiteral("With --serve, listen on a Unix socket instead of stdin"),
+                                 QStringLiteral("path"));
+    QCommandLineOption workersOpt(QStringLiteral("workers"),
+                                  QStringLiteral("With --serve, number of trim engines (default: CPU count)"),
+                                  QStringLiteral("n"));
     parser.addOption(coreOpt);
     parser.addOption(vectorsOpt);
+    parser.addOption(jobsOpt);
+    parser.addOption(filterOpt);
+    parser.addOption(limitOpt);
+    parser.addOption(incrementalOpt);
+    parser.addOption(serveOpt);
+    parser.addOption(socketOpt);
+    parser.addOption(workersOpt);
     parser.process(app);
 
     const QString corePath = parser.value(coreOpt).isEmpty()
         ? defaultCorePath()
         : parser.value(coreOpt);
-    const QString vectorsPath = parser.value(vectorsOpt).isEmpty()
-        ? defaultVectorsPath()
-        : parser.value(vectorsOpt);
 
     QTextStream out(stdout);
     QTextStream err(stderr);
 
-    TrimCore core;
-    QString loadError;
-    if (!core.load(corePath, &loadError)) {
-        err << "Failed to load core JS: " << loadError << "\n";
-        err << "Path: " << corePath << "\n";
-        return 2;
+    if (parser.isSet(serveOpt)) {
+        int workers = QThread::idealThreadCount();
+        if (parser.isSet(workersOpt) && !parsePositive(parser.value(workersOpt), &workers)) {
+            err << "--workers must be a positive integer\n";
+            return 1;
+        }
+        return runServer(app, corePath, workers, parser.value(socketOpt));
     }
 
-    QFile file(vectorsPath);
-    if (!file.open(QIODevice::ReadOnly)) {
-        err << "Failed to open vectors: " << vectorsPath << "\n";
-        return 3;
+    int jobs = 1;
+    if (parser.isSet(jobsOpt) && !parsePositive(parser.value(jobsOpt), &jobs)) {
+        err << "--jobs must be a positive integer\n";
+        return 1;
     }
-    const QByteArray bytes = file.readAll();
-    file.close();
-
-    QJsonParseError parseError;
-    QJsonDocument doc = QJsonDocument::fromJson(bytes, &parseError);
-    if (doc.isNull() || parseError.error != QJsonParseError::NoError) {
-        err << "Failed to parse vectors JSON: " << parseError.errorString() << "\n";
-        return 4;
+    const bool incremental = parser.isSet(incrementalOpt);
+    if (incremental && jobs > 1) {
+        err << "--incremental runs on a single engine and cannot be combined with --jobs\n";
+        return 1;
     }
-    if (!doc.isArray()) {
-        err << "Vectors JSON is not an array\n";
-        return 5;
+    int limit = 0;
+    if (parser.isSet(limitOpt) && !parsePositive(parser.value(limitOpt), &limit)) {
+        err << "--limit must be a positive integer\n";
+        return 1;
+    }
+    const QRegularExpression filter(parser.value(filterOpt));
+    if (!filter.isValid()) {
+        err << "Invalid --filter: " << filter.errorString() << "\n";
+        return 1;
     }
 
-    const QJsonArray cases = doc.array();
-    int total = 0;
-    int failures = 0;
+    const QString vectorsPath = parser.value(vectorsOpt).isEmpty()
+        ? defaultVectorsPath()
+        : parser.value(vectorsOpt);
 
-    for (int i = 0; i < cases.size(); ++i) {
-        const QJsonValue value = cases.at(i);
-        if (!value.isObject()) {
-            err << "Case " << i << " is not an object\n";
-            failures += 1;
-            continue;
-        }
-        const QJsonObject obj = value.toObject();
-        bool ok = true;
-        const QString name = obj.value(QStringLiteral("name")).toString(QStringLiteral("case_%1").arg(i));
-        const QString input = requiredString(obj, QStringLiteral("input"), &ok);
-        const QString aggressiveness = obj.value(QStringLiteral("aggressiveness"))
-            .toString(QStringLiteral("normal"));
-        if (!ok) {
-            err << name << ": missing required fields\n";
-            failures += 1;
-            continue;
-        }
+    QElapsedTimer clock;
+    clock.start();
 
-        TrimOptions options;
-        if (obj.contains(QStringLiteral("options")) && obj.value(QStringLiteral("options")).isObject()) {
-            const QJsonObject opts = obj.value(QStringLiteral("options")).toObject();
-            options.keepBlankLines = getBool(opts, QStringLiteral("keep_blank_lines"), options.keepBlankLines);
-            options.stripBoxChars = getBool(opts, QStringLiteral("strip_box_chars"), options.stripBoxChars);
-            options.trimPrompts = getBool(opts, QStringLiteral("trim_prompts"), options.trimPrompts);
-            options.maxLines = getInt(opts, QStringLiteral("max_lines"), options.maxLines);
-        }
+    TrimCore core;
+    std::unique_ptr<TrimPool> pool;
+    QString loadError;
+    bool loaded = false;
+    if (jobs > 1) {
+        pool = std::make_unique<TrimPool>(corePath, jobs);
+        loaded = pool->start(&loadError);
+    } else {
+        loaded = core.load(corePath, &loadError);
+    }
+    TrimCore fresh;
+    fresh.setIncremental(false);
+    if (loaded && incremental) {
+        loaded = fresh.load(corePath, &loadError);
+    }
+    if (!loaded) {
+        err << "Failed to load core JS: " << loadError << "\n";
+        err << "Path: " << corePath << "\n";
+        return 2;
+    }
+    const qint64 loadNs = clock.nsecsElapsed();
 
-        if (!obj.contains(QStringLiteral("expected")) || !obj.value(QStringLiteral("expected")).isObject()) {
-            err << name << ": missing expected\n";
-            failures += 1;
-            continue;
+    // JSON Lines is streamed from a mapping; the original JSON array format
+    // is still parsed in one go.
+    std::unique_ptr<JsonlSource> jsonl;
+    std::unique_ptr<JsonArraySource> jsonArray;
+    CaseSource source;
+    if (isJsonLines(vectorsPath)) {
+        jsonl = std::make_unique<JsonlSource>();
+        QString openError;
+        if (!jsonl->open(vectorsPath, &openError)) {
+            err << openError << "\n";
+            return 3;
         }
-        const QJsonObject expected = obj.value(QStringLiteral("expected")).toObject();
-        const QString expectedOutput = expected.value(QStringLiteral("output")).toString();
-        const bool expectedChanged = expected.value(QStringLiteral("changed")).toBool();
-        const QString expectedReason = expected.value(QStringLiteral("reason")).toString();
-
-        QString error;
-        const TrimResult result = core.trim(input, aggressiveness, options, &error);
-        if (!error.isEmpty()) {
-            err << name << ": trim error: " << error << "\n";
-            failures += 1;
-            continue;
+        source = [&jsonl](VectorCase *vc) { return jsonl->next(vc); };
+    } else {
+        QFile file(vectorsPath);
+        if (!file.open(QIODevice::ReadOnly)) {
+            err << "Failed to open vectors: " << vectorsPath << "\n";
+            return 3;
         }
+        const QByteArray bytes = file.readAll();
+        file.close();
 
-        bool pass = true;
-        if (result.output != expectedOutput) {
-            err << name << ": output mismatch\n";
-            err << "  expected: " << expectedOutput << "\n";
-            err << "  actual:   " << result.output << "\n";
-            pass = false;
-        }
-        if (result.changed != expectedChanged) {
-            err << name << ": changed mismatch (expected "
-                << (expectedChanged ? "true" : "false")
-                << ", got " << (result.changed ? "true" : "false") << ")\n";
-            pass = false;
+        QJsonParseError parseError;
+        QJsonDocument doc = QJsonDocument::fromJson(bytes, &parseError);
+        if (doc.isNull() || parseError.error != QJsonParseError::NoError) {
+            err << "Failed to parse vectors JSON: " << parseError.errorString() << "\n";
+            return 4;
         }
-        if (!expectedReason.isEmpty() && result.reason != expectedReason) {
-            err << name << ": reason mismatch (expected "
-                << expectedReason << ", got " << result.reason << ")\n";
-            pass = false;
+        if (!doc.isArray()) {
+            err << "Vectors JSON is not an array\n";
+            return 5;
         }
+        jsonArray = std::make_unique<JsonArraySource>(doc.array());
+        source = [&jsonArray](VectorCase *vc) { return jsonArray->next(vc); };
+    }
 
-        total += 1;
-        if (!pass) {
-            failures += 1;
-        }
+    if (!filter.pattern().isEmpty()) {
+        source = [inner = std::move(source), &filter](VectorCase *vc) {
+            while (inner(vc)) {
+                if (filter.match(vc->name).hasMatch()) {
+                    return true;
+                }
+            }
+            return false;
+        };
     }
+    if (limit > 0) {
+        source = [inner = std::move(source), limit, taken = 0](VectorCase *vc) mutable {
+            if (taken >= limit || !inner(vc)) {
+                return false;
+            }
+            taken += 1;
+            return true;
+        };
+    }
+
+    const qint64 runStartNs = clock.nsecsElapsed();
+    RunStats stats;
+    if (pool) {
+        stats = runParallel(source, pool.get(), err);
+    } else if (incremental) {
+        stats = runIncremental(source, &core, &fresh, err);
+    } else {
+        stats = runSequential(source, &core, err);
+    }
+    const qint64 runNs = clock.nsecsElapsed() - runStartNs;
 
-    const int passed = total - failures;
-    out << "Vectors: " << passed << " passed, " << failures << " failed.\n";
-    return failures == 0 ? 0 : 1;
+    const int passed = stats.total - stats.failures;
+    out << "Vectors: " << passed << " passed, " << stats.failures << " failed.\n";
+    const double runMs = static_cast<double>(runNs) / 1e6;
+    out << "Time: " << QString::number(runMs, 'f', 1) << " ms for " << stats.cases << " cases with "
+        << jobs << (jobs == 1 ? " job" : " jobs") << " ("
+        << QString::number(runMs > 0 ? stats.cases / (runMs / 1000.0) : 0.0, 'f', 0) << " cases/s; engine load "
+        << QString::number(static_cast<double>(loadNs) / 1e6, 'f', 1) << " ms)\n";
+    if (AllocAccounting::isEnabled() && stats.total > 0) {
+        const AllocAccounting::StageCounts trimCounts = AllocAccounting::counts(AllocAccounting::Stage::Trim);
+        out << "Allocations: " << QString::number(static_cast<double>(trimCounts.allocations) / stats.total, 'f', 1)
+            << " per case (" << QString::number(static_cast<double>(trimCounts.bytes) / stats.total, 'f', 0)
+            << " bytes)\n";
+    }
+    return stats.failures == 0 ? 0 : 1;
 }
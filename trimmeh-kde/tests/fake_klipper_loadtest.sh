@@ -0,0 +1,26 @@
+#!/bin/sh
+# Runs trimmeh-kde-loadtest against trimmeh-kded on a private session bus with
+# throwaway config/data directories. Exits 77 (skip) without dbus-run-session.
+set -eu
+
+loadtest="$1"
+daemon="$2"
+shift 2
+
+if ! command -v dbus-run-session >/dev/null 2>&1; then
+    echo "dbus-run-session not found; skipping"
+    exit 77
+fi
+
+scratch="$(mktemp -d)"
+trap 'rm -rf "$scratch"' EXIT INT TERM
+
+# The daemon needs a QGuiApplication; offscreen avoids needing a display.
+export QT_QPA_PLATFORM=offscreen
+export XDG_CONFIG_HOME="$scratch/config"
+export XDG_DATA_HOME="$scratch/data"
+export XDG_RUNTIME_DIR="$scratch/runtime"
+mkdir -p "$XDG_CONFIG_HOME" "$XDG_DATA_HOME" "$XDG_RUNTIME_DIR"
+chmod 700 "$XDG_RUNTIME_DIR"
+
+exec dbus-run-session -- "$loadtest" --daemon "$daemon" "$@"
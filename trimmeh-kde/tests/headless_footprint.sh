@@ -0,0 +1,51 @@
+#!/bin/sh
+# Compares the settled resident set of trimmeh-kded against trimmeh-kde.
+# Both binaries are started with the same flags, --startup-profile
+# --exit-after-startup, so both register hotkeys and the portal injector and
+# the difference is the tray and QtWidgets alone. The "Memory: rss ..." lines
+# are compared; the startup-complete times are printed alongside. Exits 77
+# (skip) when no Klipper is reachable on the session bus.
+set -eu
+
+tray="$1"
+daemon="$2"
+
+if ! command -v dbus-send >/dev/null 2>&1; then
+    echo "dbus-send not found; skipping"
+    exit 77
+fi
+if ! dbus-send --session --print-reply --dest=org.kde.klipper /klipper \
+        org.kde.klipper.klipper.getClipboardContents >/dev/null 2>&1; then
+    echo "Klipper not reachable on the session bus; skipping"
+    exit 77
+fi
+
+profile() {
+    "$1" --startup-profile --exit-after-startup 2>/dev/null
+}
+
+rss_kb() {
+    printf '%s\n' "$1" | sed -n 's/^Memory: rss \([0-9]*\) kB.*/\1/p'
+}
+
+startup_ms() {
+    printf '%s\n' "$1" | awk '$1 == "startup-complete" { print $3 }'
+}
+
+tray_profile="$(profile "$tray")"
+daemon_profile="$(profile "$daemon")"
+tray_rss="$(rss_kb "$tray_profile")"
+daemon_rss="$(rss_kb "$daemon_profile")"
+
+if [ -z "$tray_rss" ] || [ -z "$daemon_rss" ]; then
+    echo "could not read VmRSS from the startup profile; skipping"
+    exit 77
+fi
+
+echo "trimmeh-kde:  ${tray_rss} kB, startup-complete at $(startup_ms "$tray_profile") ms"
+echo "trimmeh-kded: ${daemon_rss} kB, startup-complete at $(startup_ms "$daemon_profile") ms"
+
+if [ "$daemon_rss" -ge "$tray_rss" ]; then
+    echo "headless daemon is not smaller than the tray app" >&2
+    exit 1
+fi